@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -8,6 +10,7 @@
 #include <wlr/backend/headless.h>
 #include <wlr/backend/interface.h>
 #include <wlr/backend/multi.h>
+#include <wlr/backend/replay.h>
 #include <wlr/backend/wayland.h>
 #include <wlr/config.h>
 #include <wlr/render/wlr_renderer.h>
@@ -240,6 +243,33 @@ static struct wlr_backend *attempt_headless_backend(struct wl_event_loop *loop)
 	return backend;
 }
 
+static struct wlr_backend *attempt_replay_backend(struct wl_event_loop *loop) {
+	const char *path = getenv("WLR_REPLAY_FILE");
+	if (path == NULL) {
+		wlr_log(WLR_ERROR, "WLR_REPLAY_FILE is required by the replay backend");
+		return NULL;
+	}
+
+	double speed = 1;
+	const char *speed_str = getenv("WLR_REPLAY_SPEED");
+	if (speed_str != NULL) {
+		char *end;
+		speed = strtod(speed_str, &end);
+		if (*end || !(speed > 0) || !isfinite(speed)) {
+			wlr_log(WLR_ERROR, "WLR_REPLAY_SPEED specified with invalid number, ignoring");
+			speed = 1;
+		}
+	}
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to open %s", path);
+		return NULL;
+	}
+
+	return wlr_replay_backend_create(loop, fd, speed);
+}
+
 static struct wlr_backend *attempt_drm_backend(struct wlr_backend *backend, struct wlr_session *session) {
 #if WLR_HAS_DRM_BACKEND
 	struct wlr_device *gpus[8];
@@ -305,6 +335,8 @@ static bool attempt_backend_by_name(struct wl_event_loop *loop,
 		backend = attempt_x11_backend(loop, NULL);
 	} else if (strcmp(name, "headless") == 0) {
 		backend = attempt_headless_backend(loop);
+	} else if (strcmp(name, "replay") == 0) {
+		backend = attempt_replay_backend(loop);
 	} else if (strcmp(name, "drm") == 0 || strcmp(name, "libinput") == 0) {
 		// DRM and libinput need a session
 		if (*session_ptr == NULL) {
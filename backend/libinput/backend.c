@@ -7,6 +7,7 @@
 #include <wlr/util/log.h>
 #include "backend/libinput.h"
 #include "util/env.h"
+#include "util/time.h"
 
 static struct wlr_libinput_backend *get_libinput_backend_from_backend(
 		struct wlr_backend *wlr_backend) {
@@ -15,9 +16,8 @@ static struct wlr_libinput_backend *get_libinput_backend_from_backend(
 	return backend;
 }
 
-static int libinput_open_restricted(const char *path,
-		int flags, void *_backend) {
-	struct wlr_libinput_backend *backend = _backend;
+int libinput_backend_open_file(struct wlr_libinput_backend *backend,
+		const char *path) {
 	struct wlr_device *dev = wlr_session_open_file(backend->session, path);
 	if (dev == NULL) {
 		return -1;
@@ -25,9 +25,7 @@ static int libinput_open_restricted(const char *path,
 	return dev->fd;
 }
 
-static void libinput_close_restricted(int fd, void *_backend) {
-	struct wlr_libinput_backend *backend = _backend;
-
+void libinput_backend_close_file(struct wlr_libinput_backend *backend, int fd) {
 	struct wlr_device *dev;
 	bool found = false;
 	wl_list_for_each(dev, &backend->session->devices, link) {
@@ -41,11 +39,72 @@ static void libinput_close_restricted(int fd, void *_backend) {
 	}
 }
 
+static int libinput_open_restricted(const char *path,
+		int flags, void *_backend) {
+	struct wlr_libinput_backend *backend = _backend;
+	// The session can only be used from the main thread
+	if (input_thread_is_current(backend)) {
+		return input_thread_request_file(backend, path, -1);
+	}
+	return libinput_backend_open_file(backend, path);
+}
+
+static void libinput_close_restricted(int fd, void *_backend) {
+	struct wlr_libinput_backend *backend = _backend;
+	if (input_thread_is_current(backend)) {
+		input_thread_request_file(backend, NULL, fd);
+		return;
+	}
+	libinput_backend_close_file(backend, fd);
+}
+
 static const struct libinput_interface libinput_impl = {
 	.open_restricted = libinput_open_restricted,
 	.close_restricted = libinput_close_restricted
 };
 
+static uint64_t get_current_time_usec(void) {
+	// libinput timestamps use CLOCK_MONOTONIC
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now) / 1000;
+}
+
+void process_libinput_event(struct wlr_libinput_backend *backend,
+		struct libinput_event *event, uint64_t read_usec) {
+	struct wlr_libinput_backend_stats *stats = &backend->stats;
+	uint64_t now_usec = get_current_time_usec();
+
+	uint64_t time_usec;
+	if (get_libinput_event_time_usec(event, &time_usec)) {
+		uint64_t latency_usec = now_usec > time_usec ? now_usec - time_usec : 0;
+		stats->timed_events++;
+		stats->total_latency_usec += latency_usec;
+		if (latency_usec > stats->max_latency_usec) {
+			stats->max_latency_usec = latency_usec;
+		}
+	}
+
+	uint64_t queue_latency_usec = now_usec > read_usec ? now_usec - read_usec : 0;
+	stats->total_queue_latency_usec += queue_latency_usec;
+	if (queue_latency_usec > stats->max_queue_latency_usec) {
+		stats->max_queue_latency_usec = queue_latency_usec;
+	}
+
+	handle_libinput_event(backend, event);
+	libinput_event_destroy(event);
+}
+
+void record_libinput_dispatch(struct wlr_libinput_backend *backend,
+		size_t depth) {
+	struct wlr_libinput_backend_stats *stats = &backend->stats;
+	stats->dispatches++;
+	stats->events += depth;
+	if (depth > stats->max_queue_depth) {
+		stats->max_queue_depth = depth;
+	}
+}
+
 static int handle_libinput_readable(int fd, uint32_t mask, void *_backend) {
 	struct wlr_libinput_backend *backend = _backend;
 	int ret = libinput_dispatch(backend->libinput_context);
@@ -54,11 +113,15 @@ static int handle_libinput_readable(int fd, uint32_t mask, void *_backend) {
 		wlr_backend_destroy(&backend->backend);
 		return 0;
 	}
+
+	size_t depth = 0;
 	struct libinput_event *event;
 	while ((event = libinput_get_event(backend->libinput_context))) {
-		handle_libinput_event(backend, event);
-		libinput_event_destroy(event);
+		process_libinput_event(backend, event, get_current_time_usec());
+		depth++;
 	}
+
+	record_libinput_dispatch(backend, depth);
 	return 0;
 }
 
@@ -113,6 +176,16 @@ static bool backend_start(struct wlr_backend *wlr_backend) {
 		return false;
 	}
 
+	if (backend->use_input_thread) {
+		if (input_thread_start(backend)) {
+			wlr_log(WLR_DEBUG, "libinput successfully initialized, "
+				"reading input on a dedicated thread");
+			return true;
+		}
+		wlr_log(WLR_ERROR, "Failed to start input thread, "
+			"falling back to reading input on the event loop");
+	}
+
 	if (backend->input_event) {
 		wl_event_source_remove(backend->input_event);
 	}
@@ -133,6 +206,8 @@ static void backend_destroy(struct wlr_backend *wlr_backend) {
 	struct wlr_libinput_backend *backend =
 		get_libinput_backend_from_backend(wlr_backend);
 
+	input_thread_stop(backend);
+
 	struct wlr_libinput_input_device *dev, *tmp;
 	wl_list_for_each_safe(dev, tmp, &backend->devices, link) {
 		destroy_libinput_input_device(dev);
@@ -168,11 +243,13 @@ static void session_signal(struct wl_listener *listener, void *data) {
 		return;
 	}
 
+	libinput_backend_lock(backend);
 	if (session->active) {
 		libinput_resume(backend->libinput_context);
 	} else {
 		libinput_suspend(backend->libinput_context);
 	}
+	libinput_backend_unlock(backend);
 }
 
 static void handle_session_destroy(struct wl_listener *listener, void *data) {
@@ -202,6 +279,26 @@ struct wlr_backend *wlr_libinput_backend_create(struct wlr_session *session) {
 	return &backend->backend;
 }
 
+void wlr_libinput_backend_get_stats(struct wlr_backend *wlr_backend,
+		struct wlr_libinput_backend_stats *stats) {
+	struct wlr_libinput_backend *backend =
+		get_libinput_backend_from_backend(wlr_backend);
+	*stats = backend->stats;
+}
+
+void wlr_libinput_backend_reset_stats(struct wlr_backend *wlr_backend) {
+	struct wlr_libinput_backend *backend =
+		get_libinput_backend_from_backend(wlr_backend);
+	backend->stats = (struct wlr_libinput_backend_stats){0};
+}
+
+void wlr_libinput_backend_enable_input_thread(struct wlr_backend *wlr_backend) {
+	struct wlr_libinput_backend *backend =
+		get_libinput_backend_from_backend(wlr_backend);
+	assert(backend->libinput_context == NULL);
+	backend->use_input_thread = true;
+}
+
 struct libinput_device *wlr_libinput_get_device_handle(
 		struct wlr_input_device *wlr_dev) {
 	struct wlr_libinput_input_device *dev = NULL;
@@ -230,6 +327,15 @@ struct libinput_device *wlr_libinput_get_device_handle(
 	return dev->handle;
 }
 
+void wlr_libinput_device_configure(struct wlr_input_device *wlr_dev,
+		void (*configure)(struct libinput_device *handle, void *data), void *data) {
+	struct libinput_device *handle = wlr_libinput_get_device_handle(wlr_dev);
+	struct wlr_libinput_input_device *dev = libinput_device_get_user_data(handle);
+	libinput_backend_lock(dev->backend);
+	configure(handle, data);
+	libinput_backend_unlock(dev->backend);
+}
+
 uint32_t usec_to_msec(uint64_t usec) {
 	return (uint32_t)(usec / 1000);
 }
@@ -36,6 +36,67 @@ void destroy_libinput_input_device(struct wlr_libinput_input_device *dev) {
 	free(dev);
 }
 
+bool get_libinput_event_time_usec(struct libinput_event *event, uint64_t *usec) {
+	switch (libinput_event_get_type(event)) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		*usec = libinput_event_keyboard_get_time_usec(
+			libinput_event_get_keyboard_event(event));
+		return true;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+#if HAVE_LIBINPUT_SCROLL_VALUE120
+	case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
+	case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
+	case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
+#endif
+		*usec = libinput_event_pointer_get_time_usec(
+			libinput_event_get_pointer_event(event));
+		return true;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		*usec = libinput_event_touch_get_time_usec(
+			libinput_event_get_touch_event(event));
+		return true;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		*usec = libinput_event_tablet_tool_get_time_usec(
+			libinput_event_get_tablet_tool_event(event));
+		return true;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+		*usec = libinput_event_tablet_pad_get_time_usec(
+			libinput_event_get_tablet_pad_event(event));
+		return true;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		*usec = libinput_event_switch_get_time_usec(
+			libinput_event_get_switch_event(event));
+		return true;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+#if HAVE_LIBINPUT_HOLD_GESTURES
+	case LIBINPUT_EVENT_GESTURE_HOLD_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_HOLD_END:
+#endif
+		*usec = libinput_event_gesture_get_time_usec(
+			libinput_event_get_gesture_event(event));
+		return true;
+	default:
+		return false;
+	}
+}
+
 bool wlr_input_device_is_libinput(struct wlr_input_device *wlr_dev) {
 	switch (wlr_dev->type) {
 	case WLR_INPUT_DEVICE_KEYBOARD:
@@ -74,6 +135,7 @@ static void handle_device_added(struct wlr_libinput_backend *backend,
 		return;
 	}
 
+	dev->backend = backend;
 	dev->handle = libinput_dev;
 	libinput_device_ref(libinput_dev);
 	libinput_device_set_user_data(libinput_dev, dev);
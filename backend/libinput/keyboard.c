@@ -14,7 +14,9 @@ struct wlr_libinput_input_device *device_from_keyboard(
 
 static void keyboard_set_leds(struct wlr_keyboard *wlr_kb, uint32_t leds) {
 	struct wlr_libinput_input_device *dev = device_from_keyboard(wlr_kb);
+	libinput_backend_lock(dev->backend);
 	libinput_device_led_update(dev->handle, leds);
+	libinput_backend_unlock(dev->backend);
 }
 
 const struct wlr_keyboard_impl libinput_keyboard_impl = {
@@ -0,0 +1,403 @@
+#include <assert.h>
+#include <errno.h>
+#include <libinput.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "backend/libinput.h"
+#include "util/time.h"
+
+#ifdef __STDC_NO_ATOMICS__
+#error "C11 atomics are required"
+#endif
+
+/*
+ * libinput isn't thread-safe. The input thread dispatches the context and
+ * pulls events out of it as soon as they're available, which keeps the kernel
+ * buffers and libinput timers serviced while the event loop is busy. Events are
+ * handed to the main thread through a lock-free single-producer
+ * single-consumer queue.
+ *
+ * Handling events and configuring devices still needs the libinput context:
+ * the main thread takes exclusive ownership of it for that, see
+ * libinput_backend_lock(). The session isn't thread-safe either, so the input
+ * thread forwards device file requests to the main thread.
+ */
+
+#define INPUT_QUEUE_SIZE 1024
+
+struct input_queue_entry {
+	struct libinput_event *event;
+	uint64_t read_usec;
+};
+
+struct wlr_libinput_input_thread {
+	struct wlr_libinput_backend *backend;
+	pthread_t thread;
+	pthread_t main_thread;
+
+	// Pushed by the input thread at tail, popped by the main thread at head.
+	// Indices wrap around, the queue is full when tail - head equals its size.
+	struct input_queue_entry queue[INPUT_QUEUE_SIZE];
+	atomic_size_t head, tail;
+	// Set by the input thread when it waits for the queue to be drained
+	atomic_bool queue_full;
+
+	int main_wake_fd; // written by the input thread
+	int thread_wake_fd; // written by the main thread
+	struct wl_event_source *main_wake_source;
+
+	int main_lock_depth; // only accessed by the main thread
+
+	// Protected by lock
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool context_busy;
+	bool exit, failed;
+	struct {
+		bool pending;
+		const char *path; // NULL to close fd
+		int fd;
+	} file_request;
+};
+
+static uint64_t get_current_time_usec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now) / 1000;
+}
+
+static void wake(int fd) {
+	if (eventfd_write(fd, 1) != 0) {
+		wlr_log_errno(WLR_ERROR, "eventfd_write failed");
+	}
+}
+
+/**
+ * Perform a pending file request from the input thread. Must be called from
+ * the main thread with the lock held.
+ */
+static void handle_file_request_locked(struct wlr_libinput_input_thread *thread) {
+	if (!thread->file_request.pending) {
+		return;
+	}
+
+	const char *path = thread->file_request.path;
+	int fd = thread->file_request.fd;
+
+	pthread_mutex_unlock(&thread->lock);
+	if (path != NULL) {
+		fd = libinput_backend_open_file(thread->backend, path);
+	} else {
+		libinput_backend_close_file(thread->backend, fd);
+		fd = -1;
+	}
+	pthread_mutex_lock(&thread->lock);
+
+	thread->file_request.pending = false;
+	thread->file_request.fd = fd;
+	pthread_cond_broadcast(&thread->cond);
+}
+
+int input_thread_request_file(struct wlr_libinput_backend *backend,
+		const char *path, int fd) {
+	struct wlr_libinput_input_thread *thread = backend->input_thread;
+
+	pthread_mutex_lock(&thread->lock);
+	assert(!thread->file_request.pending);
+	thread->file_request.pending = true;
+	thread->file_request.path = path;
+	thread->file_request.fd = fd;
+	pthread_cond_broadcast(&thread->cond);
+	pthread_mutex_unlock(&thread->lock);
+
+	// The main thread may be idle in the event loop
+	wake(thread->main_wake_fd);
+
+	pthread_mutex_lock(&thread->lock);
+	while (thread->file_request.pending && !thread->exit) {
+		pthread_cond_wait(&thread->cond, &thread->lock);
+	}
+	int ret = thread->file_request.pending ? -1 : thread->file_request.fd;
+	pthread_mutex_unlock(&thread->lock);
+	return ret;
+}
+
+bool input_thread_is_current(struct wlr_libinput_backend *backend) {
+	// The input thread ID may not be stored yet when the thread starts
+	return backend->input_thread != NULL &&
+		!pthread_equal(pthread_self(), backend->input_thread->main_thread);
+}
+
+void libinput_backend_lock(struct wlr_libinput_backend *backend) {
+	struct wlr_libinput_input_thread *thread = backend->input_thread;
+	if (thread == NULL) {
+		return;
+	}
+	assert(!input_thread_is_current(backend));
+
+	if (thread->main_lock_depth++ > 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&thread->lock);
+	while (thread->context_busy) {
+		// The input thread may be waiting for us to open a device
+		if (thread->file_request.pending) {
+			handle_file_request_locked(thread);
+		} else {
+			pthread_cond_wait(&thread->cond, &thread->lock);
+		}
+	}
+	thread->context_busy = true;
+	pthread_mutex_unlock(&thread->lock);
+}
+
+void libinput_backend_unlock(struct wlr_libinput_backend *backend) {
+	struct wlr_libinput_input_thread *thread = backend->input_thread;
+	if (thread == NULL) {
+		return;
+	}
+
+	assert(thread->main_lock_depth > 0);
+	if (--thread->main_lock_depth > 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&thread->lock);
+	thread->context_busy = false;
+	pthread_cond_broadcast(&thread->cond);
+	pthread_mutex_unlock(&thread->lock);
+}
+
+/**
+ * Move events from the libinput context to the queue. Returns the number of
+ * queued events.
+ */
+static size_t input_thread_queue_events(struct wlr_libinput_input_thread *thread) {
+	struct libinput *context = thread->backend->libinput_context;
+
+	size_t n = 0;
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_relaxed);
+	while (libinput_next_event_type(context) != LIBINPUT_EVENT_NONE) {
+		if (tail - atomic_load(&thread->head) == INPUT_QUEUE_SIZE) {
+			atomic_store(&thread->queue_full, true);
+			// The main thread may have drained the queue before seeing
+			// the flag
+			if (tail - atomic_load(&thread->head) == INPUT_QUEUE_SIZE) {
+				break;
+			}
+			atomic_store(&thread->queue_full, false);
+		}
+
+		struct input_queue_entry *entry = &thread->queue[tail % INPUT_QUEUE_SIZE];
+		entry->event = libinput_get_event(context);
+		entry->read_usec = get_current_time_usec();
+		tail++;
+		atomic_store_explicit(&thread->tail, tail, memory_order_release);
+		n++;
+	}
+	return n;
+}
+
+static void *input_thread_run(void *data) {
+	struct wlr_libinput_input_thread *thread = data;
+	struct libinput *context = thread->backend->libinput_context;
+
+	struct pollfd fds[] = {
+		{ .fd = libinput_get_fd(context) },
+		{ .fd = thread->thread_wake_fd, .events = POLLIN },
+	};
+
+	bool ok = true;
+	while (ok) {
+		// Leave events in the kernel while the queue is full
+		bool queue_full = atomic_load(&thread->queue_full);
+		fds[0].events = queue_full ? 0 : POLLIN;
+		if (poll(fds, sizeof(fds) / sizeof(fds[0]), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			wlr_log_errno(WLR_ERROR, "poll failed");
+			ok = false;
+		}
+		if (ok && (fds[1].revents & POLLIN)) {
+			eventfd_t value;
+			eventfd_read(thread->thread_wake_fd, &value);
+		}
+
+		pthread_mutex_lock(&thread->lock);
+		while (thread->context_busy && !thread->exit) {
+			pthread_cond_wait(&thread->cond, &thread->lock);
+		}
+		if (thread->exit) {
+			pthread_mutex_unlock(&thread->lock);
+			break;
+		}
+		thread->context_busy = true;
+		pthread_mutex_unlock(&thread->lock);
+
+		if (ok && (fds[0].revents & POLLIN)) {
+			int ret = libinput_dispatch(context);
+			if (ret != 0) {
+				wlr_log(WLR_ERROR, "Failed to dispatch libinput: %s", strerror(-ret));
+				ok = false;
+			}
+		}
+		size_t n = ok ? input_thread_queue_events(thread) : 0;
+
+		pthread_mutex_lock(&thread->lock);
+		thread->context_busy = false;
+		thread->failed = !ok;
+		pthread_cond_broadcast(&thread->cond);
+		pthread_mutex_unlock(&thread->lock);
+
+		if (n > 0 || !ok) {
+			wake(thread->main_wake_fd);
+		}
+	}
+
+	return NULL;
+}
+
+static void input_thread_process_events(struct wlr_libinput_input_thread *thread) {
+	struct wlr_libinput_backend *backend = thread->backend;
+
+	libinput_backend_lock(backend);
+
+	size_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&thread->tail, memory_order_acquire);
+	size_t depth = tail - head;
+	while (head != tail) {
+		struct input_queue_entry entry = thread->queue[head % INPUT_QUEUE_SIZE];
+		head++;
+		atomic_store(&thread->head, head);
+		process_libinput_event(backend, entry.event, entry.read_usec);
+	}
+	if (depth > 0) {
+		record_libinput_dispatch(backend, depth);
+	}
+
+	libinput_backend_unlock(backend);
+
+	if (atomic_exchange(&thread->queue_full, false)) {
+		wake(thread->thread_wake_fd);
+	}
+}
+
+static int handle_main_wake(int fd, uint32_t mask, void *data) {
+	struct wlr_libinput_input_thread *thread = data;
+
+	eventfd_t value;
+	eventfd_read(fd, &value);
+
+	pthread_mutex_lock(&thread->lock);
+	handle_file_request_locked(thread);
+	bool failed = thread->failed;
+	pthread_mutex_unlock(&thread->lock);
+
+	if (failed) {
+		wlr_backend_destroy(&thread->backend->backend);
+		return 0;
+	}
+
+	input_thread_process_events(thread);
+	return 0;
+}
+
+bool input_thread_start(struct wlr_libinput_backend *backend) {
+	assert(backend->input_thread == NULL);
+
+	struct wlr_libinput_input_thread *thread = calloc(1, sizeof(*thread));
+	if (thread == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	thread->backend = backend;
+	thread->main_thread = pthread_self();
+	atomic_init(&thread->head, 0);
+	atomic_init(&thread->tail, 0);
+	atomic_init(&thread->queue_full, false);
+	pthread_mutex_init(&thread->lock, NULL);
+	pthread_cond_init(&thread->cond, NULL);
+
+	thread->main_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	thread->thread_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (thread->main_wake_fd < 0 || thread->thread_wake_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "eventfd failed");
+		goto error;
+	}
+
+	thread->main_wake_source = wl_event_loop_add_fd(backend->session->event_loop,
+		thread->main_wake_fd, WL_EVENT_READABLE, handle_main_wake, thread);
+	if (thread->main_wake_source == NULL) {
+		wlr_log(WLR_ERROR, "Failed to add input thread event source");
+		goto error;
+	}
+
+	backend->input_thread = thread;
+
+	// Signals are handled by the event loop thread, through signalfd
+	sigset_t mask, prev_mask;
+	sigfillset(&mask);
+	pthread_sigmask(SIG_SETMASK, &mask, &prev_mask);
+	int ret = pthread_create(&thread->thread, NULL, input_thread_run, thread);
+	pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+	if (ret != 0) {
+		wlr_log(WLR_ERROR, "pthread_create failed: %s", strerror(ret));
+		backend->input_thread = NULL;
+		goto error;
+	}
+
+	return true;
+
+error:
+	if (thread->main_wake_source != NULL) {
+		wl_event_source_remove(thread->main_wake_source);
+	}
+	if (thread->main_wake_fd >= 0) {
+		close(thread->main_wake_fd);
+	}
+	if (thread->thread_wake_fd >= 0) {
+		close(thread->thread_wake_fd);
+	}
+	pthread_cond_destroy(&thread->cond);
+	pthread_mutex_destroy(&thread->lock);
+	free(thread);
+	return false;
+}
+
+void input_thread_stop(struct wlr_libinput_backend *backend) {
+	struct wlr_libinput_input_thread *thread = backend->input_thread;
+	if (thread == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&thread->lock);
+	thread->exit = true;
+	pthread_cond_broadcast(&thread->cond);
+	pthread_mutex_unlock(&thread->lock);
+	wake(thread->thread_wake_fd);
+
+	pthread_join(thread->thread, NULL);
+	backend->input_thread = NULL;
+
+	size_t head = atomic_load(&thread->head);
+	size_t tail = atomic_load(&thread->tail);
+	for (; head != tail; head++) {
+		libinput_event_destroy(thread->queue[head % INPUT_QUEUE_SIZE].event);
+	}
+
+	wl_event_source_remove(thread->main_wake_source);
+	close(thread->main_wake_fd);
+	close(thread->thread_wake_fd);
+	pthread_cond_destroy(&thread->cond);
+	pthread_mutex_destroy(&thread->lock);
+	free(thread);
+}
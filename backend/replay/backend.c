@@ -0,0 +1,225 @@
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "backend/replay.h"
+#include "util/time.h"
+
+struct wlr_replay_backend *replay_backend_from_backend(
+		struct wlr_backend *wlr_backend) {
+	assert(wlr_backend_is_replay(wlr_backend));
+	struct wlr_replay_backend *backend = wl_container_of(wlr_backend, backend, backend);
+	return backend;
+}
+
+static int64_t get_current_time_nsec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now);
+}
+
+/**
+ * Read the record at the current offset. Records aren't aligned in the file,
+ * so the header is copied out.
+ */
+static bool peek_record(struct wlr_replay_backend *backend,
+		struct input_record_header *header, const char **payload) {
+	if (backend->size - backend->offset < sizeof(*header)) {
+		return false;
+	}
+	memcpy(header, &backend->data[backend->offset], sizeof(*header));
+	if (backend->size - backend->offset - sizeof(*header) < header->size) {
+		return false;
+	}
+	*payload = &backend->data[backend->offset + sizeof(*header)];
+	return true;
+}
+
+static void stop_playback(struct wlr_replay_backend *backend) {
+	backend->offset = backend->size;
+	wl_event_source_timer_update(backend->timer, 0);
+}
+
+static void dispatch_records(struct wlr_replay_backend *backend) {
+	while (backend->offset < backend->size) {
+		struct input_record_header header;
+		const char *payload;
+		if (!peek_record(backend, &header, &payload)) {
+			wlr_log(WLR_ERROR, "Truncated input recording, stopping replay");
+			stop_playback(backend);
+			return;
+		}
+
+		uint64_t delay_usec = header.time_usec > backend->first_time_usec ?
+			header.time_usec - backend->first_time_usec : 0;
+		int64_t due_nsec = backend->start_time_nsec +
+			(int64_t)(delay_usec * 1000 / backend->speed);
+		int64_t now_nsec = get_current_time_nsec();
+		if (due_nsec > now_nsec) {
+			int64_t delay_msec = (due_nsec - now_nsec + 999999) / 1000000;
+			wl_event_source_timer_update(backend->timer, delay_msec);
+			return;
+		}
+
+		// Handling the record may destroy devices, but not the backend
+		backend->offset += sizeof(header) + header.size;
+		if (!replay_backend_handle_record(backend, &header, payload)) {
+			wlr_log(WLR_ERROR, "Invalid input record, stopping replay");
+			stop_playback(backend);
+			return;
+		}
+	}
+
+	wlr_log(WLR_INFO, "Input replay finished");
+}
+
+static int handle_timer(void *data) {
+	struct wlr_replay_backend *backend = data;
+	dispatch_records(backend);
+	return 0;
+}
+
+static bool backend_start(struct wlr_backend *wlr_backend) {
+	struct wlr_replay_backend *backend = replay_backend_from_backend(wlr_backend);
+	wlr_log(WLR_INFO, "Starting replay backend");
+
+	backend->started = true;
+	backend->start_time_nsec = get_current_time_nsec();
+	dispatch_records(backend);
+	return true;
+}
+
+static void backend_destroy(struct wlr_backend *wlr_backend) {
+	if (!wlr_backend) {
+		return;
+	}
+	struct wlr_replay_backend *backend = replay_backend_from_backend(wlr_backend);
+
+	wlr_backend_finish(wlr_backend);
+
+	struct wlr_replay_input_device *device, *tmp;
+	wl_list_for_each_safe(device, tmp, &backend->devices, link) {
+		replay_input_device_destroy(device);
+	}
+
+	wl_event_source_remove(backend->timer);
+	wl_list_remove(&backend->event_loop_destroy.link);
+	free(backend->data);
+	free(backend);
+}
+
+static const struct wlr_backend_impl backend_impl = {
+	.start = backend_start,
+	.destroy = backend_destroy,
+};
+
+static void handle_event_loop_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_replay_backend *backend =
+		wl_container_of(listener, backend, event_loop_destroy);
+	backend_destroy(&backend->backend);
+}
+
+static bool read_all(int fd, char **data_ptr, size_t *size_ptr) {
+	char *data = NULL;
+	size_t size = 0, cap = 0;
+	while (true) {
+		if (size == cap) {
+			cap = cap > 0 ? 2 * cap : 64 * 1024;
+			char *new_data = realloc(data, cap);
+			if (new_data == NULL) {
+				free(data);
+				return false;
+			}
+			data = new_data;
+		}
+
+		ssize_t n = read(fd, &data[size], cap - size);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			free(data);
+			return false;
+		} else if (n == 0) {
+			break;
+		}
+		size += n;
+	}
+
+	*data_ptr = data;
+	*size_ptr = size;
+	return true;
+}
+
+struct wlr_backend *wlr_replay_backend_create(struct wl_event_loop *loop,
+		int fd, double speed) {
+	wlr_log(WLR_INFO, "Creating replay backend");
+	assert(speed > 0 && isfinite(speed));
+
+	char *data = NULL;
+	size_t size = 0;
+	bool ok = read_all(fd, &data, &size);
+	close(fd);
+	if (!ok) {
+		wlr_log_errno(WLR_ERROR, "Failed to read input recording");
+		return NULL;
+	}
+
+	const struct input_recording_header *file_header = (const void *)data;
+	if (size < sizeof(*file_header) ||
+			memcmp(file_header->magic, INPUT_RECORDING_MAGIC,
+				sizeof(file_header->magic)) != 0) {
+		wlr_log(WLR_ERROR, "Invalid input recording");
+		free(data);
+		return NULL;
+	}
+	if (file_header->version != INPUT_RECORDING_VERSION) {
+		wlr_log(WLR_ERROR, "Unsupported input recording version %"PRIu32,
+			file_header->version);
+		free(data);
+		return NULL;
+	}
+
+	struct wlr_replay_backend *backend = calloc(1, sizeof(*backend));
+	if (!backend) {
+		wlr_log(WLR_ERROR, "Failed to allocate wlr_replay_backend");
+		free(data);
+		return NULL;
+	}
+
+	backend->timer = wl_event_loop_add_timer(loop, handle_timer, backend);
+	if (backend->timer == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create timer");
+		free(backend);
+		free(data);
+		return NULL;
+	}
+
+	wlr_backend_init(&backend->backend, &backend_impl);
+
+	backend->event_loop = loop;
+	backend->speed = speed;
+	backend->data = data;
+	backend->size = size;
+	backend->offset = sizeof(*file_header);
+	wl_list_init(&backend->devices);
+
+	struct input_record_header header;
+	const char *payload;
+	if (peek_record(backend, &header, &payload)) {
+		backend->first_time_usec = header.time_usec;
+	}
+
+	backend->event_loop_destroy.notify = handle_event_loop_destroy;
+	wl_event_loop_add_destroy_listener(loop, &backend->event_loop_destroy);
+
+	return &backend->backend;
+}
+
+bool wlr_backend_is_replay(struct wlr_backend *backend) {
+	return backend->impl == &backend_impl;
+}
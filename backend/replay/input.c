@@ -0,0 +1,549 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/interfaces/wlr_pointer.h>
+#include <wlr/interfaces/wlr_tablet_tool.h>
+#include <wlr/interfaces/wlr_touch.h>
+#include <wlr/util/log.h>
+#include "backend/replay.h"
+
+static const struct wlr_keyboard_impl keyboard_impl = {
+	.name = "replay-keyboard",
+};
+
+static const struct wlr_pointer_impl pointer_impl = {
+	.name = "replay-pointer",
+};
+
+static const struct wlr_touch_impl touch_impl = {
+	.name = "replay-touch",
+};
+
+static const struct wlr_tablet_impl tablet_impl = {
+	.name = "replay-tablet-tool",
+};
+
+bool wlr_input_device_is_replay(struct wlr_input_device *dev) {
+	switch (dev->type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		return wlr_keyboard_from_input_device(dev)->impl == &keyboard_impl;
+	case WLR_INPUT_DEVICE_POINTER:
+		return wlr_pointer_from_input_device(dev)->impl == &pointer_impl;
+	case WLR_INPUT_DEVICE_TOUCH:
+		return wlr_touch_from_input_device(dev)->impl == &touch_impl;
+	case WLR_INPUT_DEVICE_TABLET:
+		return wlr_tablet_from_input_device(dev)->impl == &tablet_impl;
+	default:
+		return false;
+	}
+}
+
+static struct wlr_replay_input_device *get_device(
+		struct wlr_replay_backend *backend, uint16_t id) {
+	struct wlr_replay_input_device *device;
+	wl_list_for_each(device, &backend->devices, link) {
+		if (device->id == id) {
+			return device;
+		}
+	}
+	return NULL;
+}
+
+static void tablet_tool_destroy(struct wlr_replay_tablet_tool *tool) {
+	wl_signal_emit_mutable(&tool->wlr_tool.events.destroy, &tool->wlr_tool);
+	wl_list_remove(&tool->link);
+	free(tool);
+}
+
+void replay_input_device_destroy(struct wlr_replay_input_device *device) {
+	switch (device->base.type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		wlr_keyboard_finish(&device->keyboard);
+		break;
+	case WLR_INPUT_DEVICE_POINTER:
+		wlr_pointer_finish(&device->pointer);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		wlr_touch_finish(&device->touch);
+		break;
+	case WLR_INPUT_DEVICE_TABLET:;
+		struct wlr_replay_tablet_tool *tool, *tmp;
+		wl_list_for_each_safe(tool, tmp, &device->tablet_tools, link) {
+			tablet_tool_destroy(tool);
+		}
+		wlr_tablet_finish(&device->tablet);
+		break;
+	default:
+		abort(); // unreachable
+	}
+
+	wl_list_remove(&device->link);
+	free(device);
+}
+
+static bool handle_device_add(struct wlr_replay_backend *backend,
+		const struct input_record_header *header, const char *payload) {
+	struct input_record_device_add record;
+	if (header->size < sizeof(record)) {
+		return false;
+	}
+	memcpy(&record, payload, sizeof(record));
+	if (header->size - sizeof(record) != record.name_len) {
+		return false;
+	}
+	if (get_device(backend, header->device) != NULL) {
+		return false;
+	}
+
+	char *name = strndup(payload + sizeof(record), record.name_len);
+	if (name == NULL) {
+		return false;
+	}
+
+	struct wlr_replay_input_device *device = calloc(1, sizeof(*device));
+	if (device == NULL) {
+		free(name);
+		return false;
+	}
+	device->backend = backend;
+	device->id = header->device;
+	wl_list_init(&device->tablet_tools);
+
+	switch (record.type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		wlr_keyboard_init(&device->keyboard, &keyboard_impl, name);
+		break;
+	case WLR_INPUT_DEVICE_POINTER:
+		wlr_pointer_init(&device->pointer, &pointer_impl, name);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		wlr_touch_init(&device->touch, &touch_impl, name);
+		break;
+	case WLR_INPUT_DEVICE_TABLET:
+		wlr_tablet_init(&device->tablet, &tablet_impl, name);
+		break;
+	default:
+		free(device);
+		free(name);
+		return false;
+	}
+	free(name);
+
+	wl_list_insert(backend->devices.prev, &device->link);
+	wl_signal_emit_mutable(&backend->backend.events.new_input, &device->base);
+	return true;
+}
+
+static struct wlr_tablet_tool *get_tablet_tool(
+		struct wlr_replay_input_device *device,
+		const struct input_record_tablet_tool *record) {
+	struct wlr_replay_tablet_tool *tool;
+	wl_list_for_each(tool, &device->tablet_tools, link) {
+		if (tool->wlr_tool.hardware_serial == record->hardware_serial &&
+				tool->wlr_tool.hardware_wacom == record->hardware_wacom &&
+				tool->wlr_tool.type == record->type) {
+			return &tool->wlr_tool;
+		}
+	}
+
+	tool = calloc(1, sizeof(*tool));
+	if (tool == NULL) {
+		wlr_log_errno(WLR_ERROR, "failed to allocate wlr_replay_tablet_tool");
+		return NULL;
+	}
+
+	tool->wlr_tool.type = record->type;
+	tool->wlr_tool.hardware_serial = record->hardware_serial;
+	tool->wlr_tool.hardware_wacom = record->hardware_wacom;
+	tool->wlr_tool.tilt = record->capabilities & INPUT_RECORD_TABLET_TOOL_TILT;
+	tool->wlr_tool.pressure =
+		record->capabilities & INPUT_RECORD_TABLET_TOOL_PRESSURE;
+	tool->wlr_tool.distance =
+		record->capabilities & INPUT_RECORD_TABLET_TOOL_DISTANCE;
+	tool->wlr_tool.rotation =
+		record->capabilities & INPUT_RECORD_TABLET_TOOL_ROTATION;
+	tool->wlr_tool.slider = record->capabilities & INPUT_RECORD_TABLET_TOOL_SLIDER;
+	tool->wlr_tool.wheel = record->capabilities & INPUT_RECORD_TABLET_TOOL_WHEEL;
+	wl_signal_init(&tool->wlr_tool.events.destroy);
+
+	wl_list_insert(&device->tablet_tools, &tool->link);
+	return &tool->wlr_tool;
+}
+
+static bool handle_pointer_record(struct wlr_replay_input_device *device,
+		const struct input_record_header *header, const char *payload) {
+	struct wlr_pointer *pointer = &device->pointer;
+
+	switch (header->type) {
+	case INPUT_RECORD_POINTER_MOTION:;
+		struct input_record_pointer_motion motion;
+		if (header->size != sizeof(motion)) {
+			return false;
+		}
+		memcpy(&motion, payload, sizeof(motion));
+		struct wlr_pointer_motion_event motion_event = {
+			.pointer = pointer,
+			.time_msec = motion.time_msec,
+			.delta_x = motion.delta_x,
+			.delta_y = motion.delta_y,
+			.unaccel_dx = motion.unaccel_dx,
+			.unaccel_dy = motion.unaccel_dy,
+		};
+		wl_signal_emit_mutable(&pointer->events.motion, &motion_event);
+		return true;
+	case INPUT_RECORD_POINTER_MOTION_ABSOLUTE:;
+		struct input_record_pointer_motion_absolute motion_abs;
+		if (header->size != sizeof(motion_abs)) {
+			return false;
+		}
+		memcpy(&motion_abs, payload, sizeof(motion_abs));
+		struct wlr_pointer_motion_absolute_event motion_abs_event = {
+			.pointer = pointer,
+			.time_msec = motion_abs.time_msec,
+			.x = motion_abs.x,
+			.y = motion_abs.y,
+		};
+		wl_signal_emit_mutable(&pointer->events.motion_absolute,
+			&motion_abs_event);
+		return true;
+	case INPUT_RECORD_POINTER_BUTTON:;
+		struct input_record_pointer_button button;
+		if (header->size != sizeof(button)) {
+			return false;
+		}
+		memcpy(&button, payload, sizeof(button));
+		struct wlr_pointer_button_event button_event = {
+			.pointer = pointer,
+			.time_msec = button.time_msec,
+			.button = button.button,
+			.state = button.state,
+		};
+		wl_signal_emit_mutable(&pointer->events.button, &button_event);
+		return true;
+	case INPUT_RECORD_POINTER_AXIS:;
+		struct input_record_pointer_axis axis;
+		if (header->size != sizeof(axis)) {
+			return false;
+		}
+		memcpy(&axis, payload, sizeof(axis));
+		struct wlr_pointer_axis_event axis_event = {
+			.pointer = pointer,
+			.time_msec = axis.time_msec,
+			.source = axis.source,
+			.orientation = axis.orientation,
+			.relative_direction = axis.relative_direction,
+			.delta = axis.delta,
+			.delta_discrete = axis.delta_discrete,
+		};
+		wl_signal_emit_mutable(&pointer->events.axis, &axis_event);
+		return true;
+	case INPUT_RECORD_POINTER_FRAME:
+		wl_signal_emit_mutable(&pointer->events.frame, pointer);
+		return true;
+	case INPUT_RECORD_POINTER_SWIPE_BEGIN:
+	case INPUT_RECORD_POINTER_PINCH_BEGIN:
+	case INPUT_RECORD_POINTER_HOLD_BEGIN:;
+		struct input_record_gesture_begin begin;
+		if (header->size != sizeof(begin)) {
+			return false;
+		}
+		memcpy(&begin, payload, sizeof(begin));
+		if (header->type == INPUT_RECORD_POINTER_SWIPE_BEGIN) {
+			struct wlr_pointer_swipe_begin_event event = {
+				.pointer = pointer,
+				.time_msec = begin.time_msec,
+				.fingers = begin.fingers,
+			};
+			wl_signal_emit_mutable(&pointer->events.swipe_begin, &event);
+		} else if (header->type == INPUT_RECORD_POINTER_PINCH_BEGIN) {
+			struct wlr_pointer_pinch_begin_event event = {
+				.pointer = pointer,
+				.time_msec = begin.time_msec,
+				.fingers = begin.fingers,
+			};
+			wl_signal_emit_mutable(&pointer->events.pinch_begin, &event);
+		} else {
+			struct wlr_pointer_hold_begin_event event = {
+				.pointer = pointer,
+				.time_msec = begin.time_msec,
+				.fingers = begin.fingers,
+			};
+			wl_signal_emit_mutable(&pointer->events.hold_begin, &event);
+		}
+		return true;
+	case INPUT_RECORD_POINTER_SWIPE_UPDATE:
+	case INPUT_RECORD_POINTER_PINCH_UPDATE:;
+		struct input_record_gesture_update update;
+		if (header->size != sizeof(update)) {
+			return false;
+		}
+		memcpy(&update, payload, sizeof(update));
+		if (header->type == INPUT_RECORD_POINTER_SWIPE_UPDATE) {
+			struct wlr_pointer_swipe_update_event event = {
+				.pointer = pointer,
+				.time_msec = update.time_msec,
+				.fingers = update.fingers,
+				.dx = update.dx,
+				.dy = update.dy,
+			};
+			wl_signal_emit_mutable(&pointer->events.swipe_update, &event);
+		} else {
+			struct wlr_pointer_pinch_update_event event = {
+				.pointer = pointer,
+				.time_msec = update.time_msec,
+				.fingers = update.fingers,
+				.dx = update.dx,
+				.dy = update.dy,
+				.scale = update.scale,
+				.rotation = update.rotation,
+			};
+			wl_signal_emit_mutable(&pointer->events.pinch_update, &event);
+		}
+		return true;
+	case INPUT_RECORD_POINTER_SWIPE_END:
+	case INPUT_RECORD_POINTER_PINCH_END:
+	case INPUT_RECORD_POINTER_HOLD_END:;
+		struct input_record_gesture_end end;
+		if (header->size != sizeof(end)) {
+			return false;
+		}
+		memcpy(&end, payload, sizeof(end));
+		if (header->type == INPUT_RECORD_POINTER_SWIPE_END) {
+			struct wlr_pointer_swipe_end_event event = {
+				.pointer = pointer,
+				.time_msec = end.time_msec,
+				.cancelled = end.cancelled,
+			};
+			wl_signal_emit_mutable(&pointer->events.swipe_end, &event);
+		} else if (header->type == INPUT_RECORD_POINTER_PINCH_END) {
+			struct wlr_pointer_pinch_end_event event = {
+				.pointer = pointer,
+				.time_msec = end.time_msec,
+				.cancelled = end.cancelled,
+			};
+			wl_signal_emit_mutable(&pointer->events.pinch_end, &event);
+		} else {
+			struct wlr_pointer_hold_end_event event = {
+				.pointer = pointer,
+				.time_msec = end.time_msec,
+				.cancelled = end.cancelled,
+			};
+			wl_signal_emit_mutable(&pointer->events.hold_end, &event);
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool handle_keyboard_record(struct wlr_replay_input_device *device,
+		const struct input_record_header *header, const char *payload) {
+	struct wlr_keyboard *keyboard = &device->keyboard;
+
+	switch (header->type) {
+	case INPUT_RECORD_KEYBOARD_KEY:;
+		struct input_record_keyboard_key key;
+		if (header->size != sizeof(key)) {
+			return false;
+		}
+		memcpy(&key, payload, sizeof(key));
+		struct wlr_keyboard_key_event key_event = {
+			.time_msec = key.time_msec,
+			.keycode = key.keycode,
+			.update_state = key.update_state,
+			.state = key.state,
+		};
+		wlr_keyboard_notify_key(keyboard, &key_event);
+		return true;
+	case INPUT_RECORD_KEYBOARD_MODIFIERS:;
+		struct input_record_keyboard_modifiers mods;
+		if (header->size != sizeof(mods)) {
+			return false;
+		}
+		memcpy(&mods, payload, sizeof(mods));
+		wlr_keyboard_notify_modifiers(keyboard, mods.depressed, mods.latched,
+			mods.locked, mods.group);
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool handle_touch_record(struct wlr_replay_input_device *device,
+		const struct input_record_header *header, const char *payload) {
+	struct wlr_touch *touch = &device->touch;
+
+	if (header->type == INPUT_RECORD_TOUCH_FRAME) {
+		wl_signal_emit_mutable(&touch->events.frame, NULL);
+		return true;
+	}
+
+	struct input_record_touch record;
+	if (header->size != sizeof(record)) {
+		return false;
+	}
+	memcpy(&record, payload, sizeof(record));
+
+	switch (header->type) {
+	case INPUT_RECORD_TOUCH_DOWN:;
+		struct wlr_touch_down_event down_event = {
+			.touch = touch,
+			.time_msec = record.time_msec,
+			.touch_id = record.touch_id,
+			.x = record.x,
+			.y = record.y,
+		};
+		wl_signal_emit_mutable(&touch->events.down, &down_event);
+		return true;
+	case INPUT_RECORD_TOUCH_UP:;
+		struct wlr_touch_up_event up_event = {
+			.touch = touch,
+			.time_msec = record.time_msec,
+			.touch_id = record.touch_id,
+		};
+		wl_signal_emit_mutable(&touch->events.up, &up_event);
+		return true;
+	case INPUT_RECORD_TOUCH_MOTION:;
+		struct wlr_touch_motion_event motion_event = {
+			.touch = touch,
+			.time_msec = record.time_msec,
+			.touch_id = record.touch_id,
+			.x = record.x,
+			.y = record.y,
+		};
+		wl_signal_emit_mutable(&touch->events.motion, &motion_event);
+		return true;
+	case INPUT_RECORD_TOUCH_CANCEL:;
+		struct wlr_touch_cancel_event cancel_event = {
+			.touch = touch,
+			.time_msec = record.time_msec,
+			.touch_id = record.touch_id,
+		};
+		wl_signal_emit_mutable(&touch->events.cancel, &cancel_event);
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool handle_tablet_record(struct wlr_replay_input_device *device,
+		const struct input_record_header *header, const char *payload) {
+	struct wlr_tablet *tablet = &device->tablet;
+
+	switch (header->type) {
+	case INPUT_RECORD_TABLET_TOOL_AXIS:;
+		struct input_record_tablet_tool_axis axis;
+		if (header->size != sizeof(axis)) {
+			return false;
+		}
+		memcpy(&axis, payload, sizeof(axis));
+		struct wlr_tablet_tool *axis_tool = get_tablet_tool(device, &axis.tool);
+		if (axis_tool == NULL) {
+			return false;
+		}
+		struct wlr_tablet_tool_axis_event axis_event = {
+			.tablet = tablet,
+			.tool = axis_tool,
+			.time_msec = axis.time_msec,
+			.updated_axes = axis.updated_axes,
+			.x = axis.x,
+			.y = axis.y,
+			.dx = axis.dx,
+			.dy = axis.dy,
+			.pressure = axis.pressure,
+			.distance = axis.distance,
+			.tilt_x = axis.tilt_x,
+			.tilt_y = axis.tilt_y,
+			.rotation = axis.rotation,
+			.slider = axis.slider,
+			.wheel_delta = axis.wheel_delta,
+		};
+		wl_signal_emit_mutable(&tablet->events.axis, &axis_event);
+		return true;
+	case INPUT_RECORD_TABLET_TOOL_PROXIMITY:
+	case INPUT_RECORD_TABLET_TOOL_TIP:;
+		struct input_record_tablet_tool_state state;
+		if (header->size != sizeof(state)) {
+			return false;
+		}
+		memcpy(&state, payload, sizeof(state));
+		struct wlr_tablet_tool *state_tool = get_tablet_tool(device, &state.tool);
+		if (state_tool == NULL) {
+			return false;
+		}
+		if (header->type == INPUT_RECORD_TABLET_TOOL_PROXIMITY) {
+			struct wlr_tablet_tool_proximity_event event = {
+				.tablet = tablet,
+				.tool = state_tool,
+				.time_msec = state.time_msec,
+				.x = state.x,
+				.y = state.y,
+				.state = state.state,
+			};
+			wl_signal_emit_mutable(&tablet->events.proximity, &event);
+		} else {
+			struct wlr_tablet_tool_tip_event event = {
+				.tablet = tablet,
+				.tool = state_tool,
+				.time_msec = state.time_msec,
+				.x = state.x,
+				.y = state.y,
+				.state = state.state,
+			};
+			wl_signal_emit_mutable(&tablet->events.tip, &event);
+		}
+		return true;
+	case INPUT_RECORD_TABLET_TOOL_BUTTON:;
+		struct input_record_tablet_tool_button button;
+		if (header->size != sizeof(button)) {
+			return false;
+		}
+		memcpy(&button, payload, sizeof(button));
+		struct wlr_tablet_tool *button_tool = get_tablet_tool(device, &button.tool);
+		if (button_tool == NULL) {
+			return false;
+		}
+		struct wlr_tablet_tool_button_event button_event = {
+			.tablet = tablet,
+			.tool = button_tool,
+			.time_msec = button.time_msec,
+			.button = button.button,
+			.state = button.state,
+		};
+		wl_signal_emit_mutable(&tablet->events.button, &button_event);
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool replay_backend_handle_record(struct wlr_replay_backend *backend,
+		const struct input_record_header *header, const char *payload) {
+	if (header->type == INPUT_RECORD_DEVICE_ADD) {
+		return handle_device_add(backend, header, payload);
+	}
+
+	struct wlr_replay_input_device *device = get_device(backend, header->device);
+	if (device == NULL) {
+		return false;
+	}
+
+	if (header->type == INPUT_RECORD_DEVICE_REMOVE) {
+		replay_input_device_destroy(device);
+		return true;
+	}
+
+	switch (device->base.type) {
+	case WLR_INPUT_DEVICE_POINTER:
+		return handle_pointer_record(device, header, payload);
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		return handle_keyboard_record(device, header, payload);
+	case WLR_INPUT_DEVICE_TOUCH:
+		return handle_touch_record(device, header, payload);
+	case WLR_INPUT_DEVICE_TABLET:
+		return handle_tablet_record(device, header, payload);
+	default:
+		abort(); // unreachable
+	}
+}
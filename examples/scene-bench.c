@@ -0,0 +1,242 @@
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/backend.h>
+#include <wlr/backend/headless.h>
+#include <wlr/render/allocator.h>
+#include <wlr/render/color.h>
+#include <wlr/render/pixman.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/util/log.h>
+
+/* Measures how rendering the scene-graph scales with the number of outputs,
+ * comparing wlr_scene_output_build_state() called for each output with
+ * wlr_scene_output_build_states().
+ *
+ * Outputs are headless and rendered with the pixman renderer, which supports
+ * recording render passes concurrently. Every frame fully damages all
+ * outputs. With -i, outputs are additionally rendered with a color transform
+ * built from the given ICC profile, which exercises the 3D LUT path of the
+ * pixman renderer. */
+
+#define MAX_OUTPUTS 16
+
+static int64_t now_nsec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void update_scene(struct wlr_scene_rect *background,
+		struct wlr_scene_rect **rects, int rects_len, int frame) {
+	float shade = (float)(frame % 64) / 64;
+	wlr_scene_rect_set_color(background, (float[4]){ shade, shade, shade, 1 });
+
+	for (int i = 0; i < rects_len; i++) {
+		wlr_scene_node_set_position(&rects[i]->node,
+			(i * 97 + frame * 8) % background->width,
+			(i * 53 + frame * 4) % background->height);
+	}
+}
+
+static double run(struct wlr_scene_output **scene_outputs, int outputs_len,
+		struct wlr_scene_rect *background, struct wlr_scene_rect **rects,
+		int rects_len, int frames, bool parallel,
+		const struct wlr_scene_output_state_options *options) {
+	struct wlr_output_state states[MAX_OUTPUTS];
+	struct wlr_scene_output_state_job jobs[MAX_OUTPUTS];
+
+	int64_t start = now_nsec();
+	for (int frame = 0; frame < frames; frame++) {
+		update_scene(background, rects, rects_len, frame);
+
+		for (int i = 0; i < outputs_len; i++) {
+			wlr_output_state_init(&states[i]);
+			jobs[i] = (struct wlr_scene_output_state_job){
+				.scene_output = scene_outputs[i],
+				.state = &states[i],
+				.options = options,
+			};
+		}
+
+		if (parallel) {
+			if (!wlr_scene_output_build_states(jobs, outputs_len)) {
+				wlr_log(WLR_ERROR, "wlr_scene_output_build_states() failed");
+			}
+		} else {
+			for (int i = 0; i < outputs_len; i++) {
+				if (!wlr_scene_output_build_state(scene_outputs[i], &states[i],
+						options)) {
+					wlr_log(WLR_ERROR, "wlr_scene_output_build_state() failed");
+				}
+			}
+		}
+
+		for (int i = 0; i < outputs_len; i++) {
+			wlr_output_state_finish(&states[i]);
+		}
+	}
+
+	return (double)(now_nsec() - start) / frames / 1000000;
+}
+
+static struct wlr_color_transform *load_icc_profile(const char *path) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to open %s", path);
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		wlr_log(WLR_ERROR, "Failed to stat %s", path);
+		close(fd);
+		return NULL;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "Failed to map %s", path);
+		return NULL;
+	}
+
+	struct wlr_color_transform *transform =
+		wlr_color_transform_init_linear_to_icc(data, st.st_size);
+	munmap(data, st.st_size);
+	return transform;
+}
+
+static void bench(struct wlr_scene_output **scene_outputs, int outputs_len,
+		struct wlr_scene_rect *background, struct wlr_scene_rect **rects,
+		int rects_len, int frames, const char *name,
+		const struct wlr_scene_output_state_options *options) {
+	// Warm up swapchains and worker threads
+	run(scene_outputs, outputs_len, background, rects, rects_len, 3, false, options);
+	run(scene_outputs, outputs_len, background, rects, rects_len, 3, true, options);
+
+	double sequential = run(scene_outputs, outputs_len, background, rects,
+		rects_len, frames, false, options);
+	double parallel = run(scene_outputs, outputs_len, background, rects,
+		rects_len, frames, true, options);
+	printf("%s:\n", name);
+	printf("  sequential: %.2f ms/frame\n", sequential);
+	printf("  parallel:   %.2f ms/frame (%.2fx)\n", parallel, sequential / parallel);
+}
+
+int main(int argc, char *argv[]) {
+	wlr_log_init(WLR_ERROR, NULL);
+
+	int outputs_len = 4;
+	int width = 3840, height = 2160;
+	int rects_len = 64;
+	int frames = 60;
+	const char *icc_path = NULL;
+
+	int c;
+	while ((c = getopt(argc, argv, "o:w:h:r:f:i:")) != -1) {
+		switch (c) {
+		case 'o':
+			outputs_len = atoi(optarg);
+			break;
+		case 'w':
+			width = atoi(optarg);
+			break;
+		case 'h':
+			height = atoi(optarg);
+			break;
+		case 'r':
+			rects_len = atoi(optarg);
+			break;
+		case 'f':
+			frames = atoi(optarg);
+			break;
+		case 'i':
+			icc_path = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-o outputs] [-w width] [-h height] "
+				"[-r rects] [-f frames] [-i icc-profile]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (outputs_len < 1 || outputs_len > MAX_OUTPUTS || width <= 0 ||
+			height <= 0 || rects_len < 0 || frames < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	struct wl_event_loop *loop = wl_event_loop_create();
+	struct wlr_backend *backend = wlr_headless_backend_create(loop);
+	struct wlr_renderer *renderer = wlr_pixman_renderer_create();
+	if (backend == NULL || renderer == NULL) {
+		return EXIT_FAILURE;
+	}
+	struct wlr_allocator *allocator = wlr_allocator_autocreate(backend, renderer);
+	if (allocator == NULL || !wlr_backend_start(backend)) {
+		return EXIT_FAILURE;
+	}
+
+	struct wlr_scene *scene = wlr_scene_create();
+	struct wlr_scene_rect *background = wlr_scene_rect_create(&scene->tree,
+		width * outputs_len, height, (float[4]){ 0, 0, 0, 1 });
+	struct wlr_scene_rect **rects = calloc(rects_len, sizeof(*rects));
+	for (int i = 0; i < rects_len; i++) {
+		rects[i] = wlr_scene_rect_create(&scene->tree, 400, 300,
+			(float[4]){ 0.2, 0.4, 0.6, 0.5 });
+	}
+
+	struct wlr_scene_output *scene_outputs[MAX_OUTPUTS];
+	for (int i = 0; i < outputs_len; i++) {
+		struct wlr_output *output = wlr_headless_add_output(backend, width, height);
+		wlr_output_init_render(output, allocator, renderer);
+
+		struct wlr_output_state state;
+		wlr_output_state_init(&state);
+		wlr_output_state_set_enabled(&state, true);
+		wlr_output_state_set_custom_mode(&state, width, height, 0);
+		bool ok = wlr_output_commit_state(output, &state);
+		wlr_output_state_finish(&state);
+		if (!ok) {
+			return EXIT_FAILURE;
+		}
+
+		scene_outputs[i] = wlr_scene_output_create(scene, output);
+		wlr_scene_output_set_position(scene_outputs[i], i * width, 0);
+	}
+
+	printf("%d outputs at %dx%d, %d rects, %d frames\n",
+		outputs_len, width, height, rects_len, frames);
+	bench(scene_outputs, outputs_len, background, rects, rects_len, frames,
+		"no color transform", NULL);
+
+	if (icc_path != NULL) {
+		struct wlr_color_transform *transform = load_icc_profile(icc_path);
+		if (transform == NULL) {
+			return EXIT_FAILURE;
+		}
+		struct wlr_scene_output_state_options options = {
+			.color_transform = transform,
+		};
+		bench(scene_outputs, outputs_len, background, rects, rects_len, frames,
+			"ICC profile color transform", &options);
+		wlr_color_transform_unref(transform);
+	}
+
+	wlr_scene_node_destroy(&scene->tree.node);
+	free(rects);
+	wlr_backend_destroy(backend);
+	wlr_allocator_destroy(allocator);
+	wlr_renderer_destroy(renderer);
+	wl_event_loop_destroy(loop);
+	return EXIT_SUCCESS;
+}
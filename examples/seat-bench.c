@@ -0,0 +1,161 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client-protocol.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/util/log.h>
+
+/* Measures looking up seat clients with many clients bound to the seat,
+ * comparing wlr_seat_client_for_wl_client() with a walk of the seat client
+ * list.
+ *
+ * Clients are connected in-process over socket pairs and bind the seat without
+ * waiting for the registry. Each client uses two file descriptors, the file
+ * descriptor limit may need to be raised for large numbers of clients. */
+
+struct bench_client {
+	struct wl_client *client;
+	struct wl_display *remote;
+};
+
+static int64_t now_nsec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct wlr_seat_client *find_seat_client_linear(struct wlr_seat *seat,
+		struct wl_client *client) {
+	struct wlr_seat_client *seat_client;
+	wl_list_for_each(seat_client, &seat->clients, link) {
+		if (seat_client->client == client) {
+			return seat_client;
+		}
+	}
+	return NULL;
+}
+
+static bool connect_client(struct wl_display *display, struct wlr_seat *seat,
+		struct bench_client *bench_client) {
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+		wlr_log_errno(WLR_ERROR, "socketpair failed");
+		return false;
+	}
+
+	bench_client->client = wl_client_create(display, sv[0]);
+	if (bench_client->client == NULL) {
+		close(sv[0]);
+		close(sv[1]);
+		return false;
+	}
+	bench_client->remote = wl_display_connect_to_fd(sv[1]);
+	if (bench_client->remote == NULL) {
+		close(sv[1]);
+		return false;
+	}
+
+	struct wl_registry *registry = wl_display_get_registry(bench_client->remote);
+	uint32_t name = wl_global_get_name(seat->global, bench_client->client);
+	wl_registry_bind(registry, name, &wl_seat_interface, 1);
+	return wl_display_flush(bench_client->remote) >= 0;
+}
+
+static double run(struct wlr_seat *seat, struct bench_client *clients,
+		int clients_len, int iterations, bool linear) {
+	size_t found = 0;
+	int64_t start = now_nsec();
+	for (int i = 0; i < iterations; i++) {
+		for (int j = 0; j < clients_len; j++) {
+			struct wl_client *client = clients[(j * 7919) % clients_len].client;
+			struct wlr_seat_client *seat_client = linear ?
+				find_seat_client_linear(seat, client) :
+				wlr_seat_client_for_wl_client(seat, client);
+			found += seat_client != NULL;
+		}
+	}
+	int64_t elapsed = now_nsec() - start;
+
+	if (found != (size_t)iterations * clients_len) {
+		fprintf(stderr, "seat client lookup failed\n");
+	}
+	return (double)elapsed / iterations / clients_len;
+}
+
+int main(int argc, char *argv[]) {
+	wlr_log_init(WLR_ERROR, NULL);
+
+	int clients_len = 256;
+	int iterations = 1000;
+
+	int c;
+	while ((c = getopt(argc, argv, "c:n:")) != -1) {
+		switch (c) {
+		case 'c':
+			clients_len = atoi(optarg);
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-c clients] [-n iterations]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (clients_len < 1 || iterations < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	struct wl_display *display = wl_display_create();
+	struct wl_event_loop *loop = wl_display_get_event_loop(display);
+	struct wlr_seat *seat = wlr_seat_create(display, "seat0");
+	if (seat == NULL) {
+		return EXIT_FAILURE;
+	}
+	wlr_seat_set_capabilities(seat,
+		WL_SEAT_CAPABILITY_POINTER | WL_SEAT_CAPABILITY_KEYBOARD);
+
+	struct bench_client *clients = calloc(clients_len, sizeof(*clients));
+	if (clients == NULL) {
+		return EXIT_FAILURE;
+	}
+	for (int i = 0; i < clients_len; i++) {
+		if (!connect_client(display, seat, &clients[i])) {
+			fprintf(stderr, "failed to connect client %d\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Process the bind requests
+	while (wl_list_length(&seat->clients) < clients_len) {
+		if (wl_event_loop_dispatch(loop, 1000) < 0) {
+			fprintf(stderr, "failed to dispatch clients\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Warm up
+	run(seat, clients, clients_len, 1, false);
+	run(seat, clients, clients_len, 1, true);
+
+	double linear = run(seat, clients, clients_len, iterations, true);
+	double hashed = run(seat, clients, clients_len, iterations, false);
+	printf("%d clients, %d iterations\n", clients_len, iterations);
+	printf("  list walk: %.1f ns/lookup\n", linear);
+	printf("  wlr_seat_client_for_wl_client: %.1f ns/lookup (%.2fx)\n",
+		hashed, linear / hashed);
+
+	wlr_seat_destroy(seat);
+	for (int i = 0; i < clients_len; i++) {
+		wl_display_disconnect(clients[i].remote);
+	}
+	free(clients);
+	wl_display_destroy_clients(display);
+	wl_display_destroy(display);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#undef _POSIX_C_SOURCE
+#define _GNU_SOURCE // for memfd_create and F_ADD_SEALS
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client-protocol.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_shm.h>
+#include <wlr/util/log.h>
+
+/* Measures the cost of wlr_buffer_begin_data_ptr_access() and
+ * wlr_buffer_end_data_ptr_access() on wl_shm buffers, for a pool backed by a
+ * memfd sealed against shrinking and for an unsealed one.
+ *
+ * The buffers are created by a client connected in-process over a socket
+ * pair. */
+
+#define WIDTH 256
+#define HEIGHT 256
+#define STRIDE (WIDTH * 4)
+#define SIZE (STRIDE * HEIGHT)
+
+static int64_t now_nsec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct wl_buffer *create_buffer(struct wl_shm *shm, bool sealed) {
+	int fd = memfd_create("shm-bench",
+		MFD_CLOEXEC | (sealed ? MFD_ALLOW_SEALING : 0));
+	if (fd < 0) {
+		wlr_log_errno(WLR_ERROR, "memfd_create failed");
+		return NULL;
+	}
+	if (ftruncate(fd, SIZE) != 0 ||
+			(sealed && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0)) {
+		wlr_log_errno(WLR_ERROR, "Failed to set up memfd");
+		close(fd);
+		return NULL;
+	}
+
+	struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, SIZE);
+	struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0,
+		WIDTH, HEIGHT, STRIDE, WL_SHM_FORMAT_ARGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+	return buffer;
+}
+
+static struct wlr_buffer *get_server_buffer(struct wl_display *display,
+		struct wl_client *client, struct wl_display *remote,
+		struct wl_buffer *remote_buffer) {
+	if (wl_display_flush(remote) < 0) {
+		return NULL;
+	}
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(display);
+	uint32_t id = wl_proxy_get_id((struct wl_proxy *)remote_buffer);
+	struct wl_resource *resource;
+	while ((resource = wl_client_get_object(client, id)) == NULL) {
+		if (wl_event_loop_dispatch(loop, 1000) < 0) {
+			return NULL;
+		}
+	}
+	return wlr_buffer_try_from_resource(resource);
+}
+
+static double run(struct wlr_buffer *buffer, int iterations) {
+	int64_t start = now_nsec();
+	for (int i = 0; i < iterations; i++) {
+		void *data;
+		uint32_t format;
+		size_t stride;
+		if (!wlr_buffer_begin_data_ptr_access(buffer,
+				WLR_BUFFER_DATA_PTR_ACCESS_READ, &data, &format, &stride)) {
+			fprintf(stderr, "wlr_buffer_begin_data_ptr_access() failed\n");
+			return 0;
+		}
+		wlr_buffer_end_data_ptr_access(buffer);
+	}
+	return (double)(now_nsec() - start) / iterations;
+}
+
+int main(int argc, char *argv[]) {
+	wlr_log_init(WLR_ERROR, NULL);
+
+	int iterations = 1000000;
+
+	int c;
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (iterations < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	struct wl_display *display = wl_display_create();
+	const uint32_t formats[] = { DRM_FORMAT_ARGB8888, DRM_FORMAT_XRGB8888 };
+	struct wlr_shm *shm = wlr_shm_create(display, 1,
+		formats, sizeof(formats) / sizeof(formats[0]));
+	if (shm == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+		return EXIT_FAILURE;
+	}
+	struct wl_client *client = wl_client_create(display, sv[0]);
+	struct wl_display *remote = wl_display_connect_to_fd(sv[1]);
+	if (client == NULL || remote == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	// Bind without waiting for the registry
+	struct wl_registry *registry = wl_display_get_registry(remote);
+	struct wl_shm *remote_shm = wl_registry_bind(registry,
+		wl_global_get_name(shm->global, client), &wl_shm_interface, 1);
+
+	struct wl_buffer *remote_sealed = create_buffer(remote_shm, true);
+	struct wl_buffer *remote_unsealed = create_buffer(remote_shm, false);
+	if (remote_sealed == NULL || remote_unsealed == NULL) {
+		return EXIT_FAILURE;
+	}
+	struct wlr_buffer *sealed =
+		get_server_buffer(display, client, remote, remote_sealed);
+	struct wlr_buffer *unsealed =
+		get_server_buffer(display, client, remote, remote_unsealed);
+	if (sealed == NULL || unsealed == NULL) {
+		fprintf(stderr, "failed to import buffers\n");
+		return EXIT_FAILURE;
+	}
+
+	// Warm up
+	run(sealed, 1000);
+	run(unsealed, 1000);
+
+	printf("%d iterations\n", iterations);
+	printf("  sealed pool:   %.1f ns/access\n", run(sealed, iterations));
+	printf("  unsealed pool: %.1f ns/access\n", run(unsealed, iterations));
+
+	wlr_buffer_unlock(sealed);
+	wlr_buffer_unlock(unsealed);
+	wl_display_disconnect(remote);
+	wl_display_destroy_clients(display);
+	wl_display_destroy(display);
+	return EXIT_SUCCESS;
+}
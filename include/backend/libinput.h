@@ -14,6 +14,8 @@
 
 #include "config.h"
 
+struct wlr_libinput_input_thread;
+
 struct wlr_libinput_backend {
 	struct wlr_backend backend;
 
@@ -26,9 +28,16 @@ struct wlr_libinput_backend {
 	struct wl_listener session_signal;
 
 	struct wl_list devices; // wlr_libinput_device.link
+
+	struct wlr_libinput_backend_stats stats;
+
+	bool use_input_thread;
+	// Reads input if enabled by the compositor and started, NULL otherwise
+	struct wlr_libinput_input_thread *input_thread;
 };
 
 struct wlr_libinput_input_device {
+	struct wlr_libinput_backend *backend;
 	struct libinput_device *handle;
 
 	struct wlr_keyboard keyboard;
@@ -46,6 +55,54 @@ uint32_t usec_to_msec(uint64_t usec);
 
 void handle_libinput_event(struct wlr_libinput_backend *state,
 		struct libinput_event *event);
+/**
+ * Handle and destroy an event read at read_usec (CLOCK_MONOTONIC), updating
+ * the latency statistics. Must be called with the context locked.
+ */
+void process_libinput_event(struct wlr_libinput_backend *backend,
+	struct libinput_event *event, uint64_t read_usec);
+/**
+ * Update the statistics after a batch of events has been processed.
+ */
+void record_libinput_dispatch(struct wlr_libinput_backend *backend,
+	size_t depth);
+int libinput_backend_open_file(struct wlr_libinput_backend *backend,
+	const char *path);
+void libinput_backend_close_file(struct wlr_libinput_backend *backend, int fd);
+
+/**
+ * Start reading input on a dedicated thread. The libinput context is then
+ * dispatched by the thread, and events are handed to the main thread through
+ * a queue.
+ */
+bool input_thread_start(struct wlr_libinput_backend *backend);
+/**
+ * Stop the input thread and drop the events it queued, if any.
+ */
+void input_thread_stop(struct wlr_libinput_backend *backend);
+/**
+ * Check whether the caller runs on the input thread.
+ */
+bool input_thread_is_current(struct wlr_libinput_backend *backend);
+/**
+ * Forward a device file request from the input thread to the main thread,
+ * which owns the session. path is NULL to close fd. Returns the opened file
+ * descriptor, or -1 on error.
+ */
+int input_thread_request_file(struct wlr_libinput_backend *backend,
+	const char *path, int fd);
+/**
+ * Get exclusive access to the libinput context from the main thread. libinput
+ * isn't thread-safe, so this is needed before using it while the input thread
+ * is running. Locks are recursive. No-op if there is no input thread.
+ */
+void libinput_backend_lock(struct wlr_libinput_backend *backend);
+void libinput_backend_unlock(struct wlr_libinput_backend *backend);
+/**
+ * Get the kernel timestamp of an event. Returns false if the event has no
+ * timestamp.
+ */
+bool get_libinput_event_time_usec(struct libinput_event *event, uint64_t *usec);
 
 void destroy_libinput_input_device(struct wlr_libinput_input_device *dev);
 const char *get_libinput_device_name(struct libinput_device *device);
@@ -0,0 +1,62 @@
+#ifndef BACKEND_REPLAY_H
+#define BACKEND_REPLAY_H
+
+#include <wlr/backend/replay.h>
+#include <wlr/backend/interface.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_tablet_tool.h>
+#include <wlr/types/wlr_touch.h>
+#include "types/wlr_input_recorder.h"
+
+struct wlr_replay_backend {
+	struct wlr_backend backend;
+	struct wl_event_loop *event_loop;
+	double speed;
+
+	char *data;
+	size_t size, offset; // offset of the next record
+
+	uint64_t first_time_usec; // of the first record
+	int64_t start_time_nsec; // when playback started
+	struct wl_event_source *timer;
+
+	struct wl_list devices; // wlr_replay_input_device.link
+
+	struct wl_listener event_loop_destroy;
+	bool started;
+};
+
+struct wlr_replay_input_device {
+	union {
+		struct wlr_input_device base;
+		struct wlr_keyboard keyboard;
+		struct wlr_pointer pointer;
+		struct wlr_touch touch;
+		struct wlr_tablet tablet;
+	};
+
+	struct wlr_replay_backend *backend;
+	uint16_t id;
+	struct wl_list link; // wlr_replay_backend.devices
+
+	struct wl_list tablet_tools; // wlr_replay_tablet_tool.link
+};
+
+struct wlr_replay_tablet_tool {
+	struct wlr_tablet_tool wlr_tool;
+	struct wl_list link; // wlr_replay_input_device.tablet_tools
+};
+
+struct wlr_replay_backend *replay_backend_from_backend(
+	struct wlr_backend *wlr_backend);
+
+/**
+ * Play back a record, returns false if it's invalid. The payload may not be
+ * aligned.
+ */
+bool replay_backend_handle_record(struct wlr_replay_backend *backend,
+	const struct input_record_header *header, const char *payload);
+void replay_input_device_destroy(struct wlr_replay_input_device *device);
+
+#endif
@@ -99,6 +99,13 @@ struct wlr_gles2_render_timer {
 	GLint64 gl_cpu_end;
 };
 
+struct wlr_gles2_render_profiler {
+	struct wlr_render_profiler base;
+	struct wlr_gles2_renderer *renderer;
+	struct wl_array queries; // GLuint
+	size_t written; // number of timestamps written by the last render pass
+};
+
 struct wlr_gles2_buffer {
 	struct wlr_buffer *buffer;
 	struct wlr_gles2_renderer *renderer;
@@ -1,10 +1,12 @@
 #ifndef RENDER_PIXMAN_H
 #define RENDER_PIXMAN_H
 
+#include <pthread.h>
 #include <wlr/render/drm_format_set.h>
 #include <wlr/render/interface.h>
 #include <wlr/render/pixman.h>
 #include <wlr/render/wlr_renderer.h>
+#include <wlr/util/addon.h>
 #include "render/pixel_format.h"
 
 struct wlr_pixman_pixel_format {
@@ -14,6 +16,8 @@ struct wlr_pixman_pixel_format {
 
 struct wlr_pixman_buffer;
 
+#define WLR_PIXMAN_TEXTURE_LOCKS 16
+
 struct wlr_pixman_renderer {
 	struct wlr_renderer wlr_renderer;
 
@@ -21,6 +25,14 @@ struct wlr_pixman_renderer {
 	struct wl_list textures; // wlr_pixman_texture.link
 
 	struct wlr_drm_format_set drm_formats;
+
+	struct wl_list color_transforms; // wlr_pixman_color_transform.link
+
+	// Texture images are mutated while compositing and their source buffer
+	// can only be accessed once at a time, so accesses from concurrent
+	// render passes are serialized. Several textures may share a source
+	// buffer, so locks are picked by hashing the buffer address.
+	pthread_mutex_t texture_locks[WLR_PIXMAN_TEXTURE_LOCKS];
 };
 
 struct wlr_pixman_buffer {
@@ -28,6 +40,9 @@ struct wlr_pixman_buffer {
 	struct wlr_pixman_renderer *renderer;
 
 	pixman_image_t *image;
+	// Intermediate image blended into when rendering with a color transform,
+	// may be NULL
+	pixman_image_t *blend_image;
 
 	struct wl_listener buffer_destroy;
 	struct wl_list link; // wlr_pixman_renderer.buffers
@@ -46,10 +61,50 @@ struct wlr_pixman_texture {
 	struct wlr_buffer *buffer; // if created via texture_from_buffer
 };
 
+// The pixman renderer executes operations synchronously, so CPU timestamps
+// taken around each operation are accurate
+struct wlr_pixman_render_profiler {
+	struct wlr_render_profiler base;
+	struct wl_array timestamps; // int64_t
+};
+
+/**
+ * Lock the texture for compositing. Needs to be called before accessing the
+ * texture image from a render pass.
+ */
+void pixman_texture_lock(struct wlr_pixman_texture *texture);
+void pixman_texture_unlock(struct wlr_pixman_texture *texture);
+
 struct wlr_pixman_render_pass {
 	struct wlr_render_pass base;
 	struct wlr_pixman_buffer *buffer;
+	pixman_image_t *image; // render target
+
+	// LUT applied from the blend image to the buffer on submit, may be NULL
+	struct wlr_color_transform *color_transform;
+	struct wlr_pixman_color_transform *lut_3d;
+	pixman_region32_t damage; // region rendered to, if lut_3d is set
+};
+
+/**
+ * A 3D LUT prepared for application on the CPU.
+ *
+ * Unlike GPU renderers, blending happens on sRGB-encoded values, so the
+ * decoding to linear values expected by the LUT is folded into the per-channel
+ * tables mapping 8-bit values to LUT grid coordinates.
+ */
+struct wlr_pixman_color_transform {
+	struct wlr_addon addon; // owned by: wlr_pixman_renderer
+	struct wl_list link; // wlr_pixman_renderer.color_transforms
+
+	size_t dim_len;
+	uint16_t *lut; // 4 16-bit channels per grid point, padded for alignment
+	// Lower grid index and interpolation weight (out of 256) for each
+	// sRGB-encoded channel value
+	uint16_t index[256];
+	uint16_t weight[256];
 };
+void pixman_color_transform_destroy(struct wlr_addon *addon);
 
 pixman_format_code_t get_pixman_format_from_drm(uint32_t fmt);
 uint32_t get_drm_format_from_pixman(pixman_format_code_t fmt);
@@ -59,6 +114,6 @@ bool begin_pixman_data_ptr_access(struct wlr_buffer *buffer, pixman_image_t **im
 	uint32_t flags);
 
 struct wlr_pixman_render_pass *begin_pixman_render_pass(
-	struct wlr_pixman_buffer *buffer);
+	struct wlr_pixman_buffer *buffer, struct wlr_color_transform *color_transform);
 
 #endif
@@ -47,6 +47,10 @@ struct wlr_vk_device {
 	uint32_t queue_family;
 	VkQueue queue;
 
+	// 0 if timestamp queries aren't supported by the queue
+	uint32_t timestamp_valid_bits;
+	float timestamp_period; // nanoseconds per timestamp tick
+
 	struct {
 		PFN_vkGetMemoryFdPropertiesKHR vkGetMemoryFdPropertiesKHR;
 		PFN_vkWaitSemaphoresKHR vkWaitSemaphoresKHR;
@@ -250,6 +254,8 @@ struct wlr_vk_command_buffer {
 	struct wl_list stage_buffers; // wlr_vk_shared_buffer.link
 	// Color transform to unref after the command buffer completes
 	struct wlr_color_transform *color_transform;
+	// Query pools to destroy after the command buffer completes
+	struct wl_array destroy_query_pools; // VkQueryPool
 
 	// For DMA-BUF implicit sync interop, may be NULL
 	VkSemaphore binary_semaphore;
@@ -270,6 +276,8 @@ struct wlr_vk_renderer {
 	VkShaderModule quad_frag_module;
 	VkShaderModule output_module;
 
+	VkPipelineCache pipeline_cache;
+
 	struct wl_list pipeline_layouts; // struct wlr_vk_pipeline_layout.link
 
 	// for blend->output subpass
@@ -383,6 +391,20 @@ struct wlr_vk_render_pass {
 struct wlr_vk_render_pass *vulkan_begin_render_pass(struct wlr_vk_renderer *renderer,
 	struct wlr_vk_render_buffer *buffer, const struct wlr_buffer_pass_options *options);
 
+struct wlr_vk_render_profiler {
+	struct wlr_render_profiler base;
+	struct wlr_vk_renderer *renderer;
+
+	VkQueryPool query_pool;
+	uint32_t query_count; // capacity of the query pool
+	size_t written; // number of timestamps written by the last render pass
+	uint64_t timeline_point; // of the last render pass, 0 if not submitted
+	uint64_t last_timeline_point; // of the last submitted render pass
+};
+
+struct wlr_render_profiler *vulkan_render_profiler_create(
+	struct wlr_renderer *wlr_renderer);
+
 // Suballocates a buffer span with the given size that can be mapped
 // and used as staging buffer. The allocation is implicitly released when the
 // stage cb has finished execution. The start of the span will be a multiple
@@ -14,4 +14,27 @@ struct wlr_renderer *renderer_autocreate_with_drm_fd(int drm_fd);
 const struct wlr_drm_format_set *wlr_renderer_get_render_formats(
 	struct wlr_renderer *renderer);
 
+/**
+ * Collect the results of the last render pass recorded by the profiler.
+ *
+ * Returns false if the results aren't available (yet).
+ */
+bool render_profiler_collect(struct wlr_render_profiler *profiler);
+/**
+ * Start recording a new render pass, discarding the previous results.
+ */
+void render_profiler_begin_pass(struct wlr_render_profiler *profiler);
+/**
+ * Record the beginning of an operation. Returns false if the operation cannot
+ * be profiled, in which case render_profiler_end_op() must not be called.
+ */
+bool render_profiler_begin_op(struct wlr_render_profiler *profiler,
+	struct wlr_render_pass *pass, enum wlr_render_profiler_op op,
+	const struct wlr_box *box);
+/**
+ * Record the end of the last operation.
+ */
+void render_profiler_end_op(struct wlr_render_profiler *profiler,
+	struct wlr_render_pass *pass);
+
 #endif
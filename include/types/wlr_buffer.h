@@ -59,6 +59,15 @@ bool dmabuf_buffer_drop(struct wlr_dmabuf_buffer *buffer);
  */
 bool buffer_is_opaque(struct wlr_buffer *buffer);
 
+/**
+ * Check whether a buffer contains a single pixel, e.g. a single-pixel-buffer-v1
+ * buffer or a 1x1 wl_shm buffer, and get its premultiplied color.
+ *
+ * For client buffers, the color is the one of the source buffer when the
+ * texture was created or last updated.
+ */
+bool buffer_get_single_pixel_color(struct wlr_buffer *buffer, float color[static 4]);
+
 /**
  * Creates a struct wlr_client_buffer from a given struct wlr_buffer by creating
  * a texture from it, and copying its struct wl_resource.
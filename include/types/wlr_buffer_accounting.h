@@ -0,0 +1,24 @@
+#ifndef TYPES_WLR_BUFFER_ACCOUNTING_H
+#define TYPES_WLR_BUFFER_ACCOUNTING_H
+
+#include <wlr/types/wlr_buffer_accounting.h>
+
+/**
+ * Start accounting a resource to a client. Does nothing if there is no
+ * accounting for the client's display.
+ */
+void buffer_accounting_entry_init(struct wlr_buffer_accounting_entry *entry,
+	struct wl_client *client, enum wlr_buffer_accounting_kind kind, size_t value);
+
+/**
+ * Update the amount accounted for a resource.
+ */
+void buffer_accounting_entry_update(struct wlr_buffer_accounting_entry *entry,
+	size_t value);
+
+/**
+ * Stop accounting a resource. The entry may be finished more than once.
+ */
+void buffer_accounting_entry_finish(struct wlr_buffer_accounting_entry *entry);
+
+#endif
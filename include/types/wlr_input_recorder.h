@@ -0,0 +1,178 @@
+#ifndef TYPES_WLR_INPUT_RECORDER_H
+#define TYPES_WLR_INPUT_RECORDER_H
+
+#include <stdint.h>
+
+/**
+ * Input recording file format.
+ *
+ * A recording starts with a struct input_recording_header, followed by
+ * records. Each record is a struct input_record_header immediately followed
+ * by `size` bytes of payload. All values are in host byte order, so recordings
+ * can only be replayed on machines with the same endianness and alignment
+ * rules.
+ */
+
+#define INPUT_RECORDING_MAGIC "WLRINREC"
+#define INPUT_RECORDING_VERSION 1
+
+struct input_recording_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+enum input_record_type {
+	INPUT_RECORD_DEVICE_ADD = 1, // struct input_record_device_add + name
+	INPUT_RECORD_DEVICE_REMOVE, // no payload
+
+	INPUT_RECORD_POINTER_MOTION, // struct input_record_pointer_motion
+	INPUT_RECORD_POINTER_MOTION_ABSOLUTE, // struct input_record_pointer_motion_absolute
+	INPUT_RECORD_POINTER_BUTTON, // struct input_record_pointer_button
+	INPUT_RECORD_POINTER_AXIS, // struct input_record_pointer_axis
+	INPUT_RECORD_POINTER_FRAME, // no payload
+	INPUT_RECORD_POINTER_SWIPE_BEGIN, // struct input_record_gesture_begin
+	INPUT_RECORD_POINTER_SWIPE_UPDATE, // struct input_record_gesture_update
+	INPUT_RECORD_POINTER_SWIPE_END, // struct input_record_gesture_end
+	INPUT_RECORD_POINTER_PINCH_BEGIN, // struct input_record_gesture_begin
+	INPUT_RECORD_POINTER_PINCH_UPDATE, // struct input_record_gesture_update
+	INPUT_RECORD_POINTER_PINCH_END, // struct input_record_gesture_end
+	INPUT_RECORD_POINTER_HOLD_BEGIN, // struct input_record_gesture_begin
+	INPUT_RECORD_POINTER_HOLD_END, // struct input_record_gesture_end
+
+	INPUT_RECORD_KEYBOARD_KEY, // struct input_record_keyboard_key
+	INPUT_RECORD_KEYBOARD_MODIFIERS, // struct input_record_keyboard_modifiers
+
+	INPUT_RECORD_TOUCH_DOWN, // struct input_record_touch
+	INPUT_RECORD_TOUCH_UP, // struct input_record_touch
+	INPUT_RECORD_TOUCH_MOTION, // struct input_record_touch
+	INPUT_RECORD_TOUCH_CANCEL, // struct input_record_touch
+	INPUT_RECORD_TOUCH_FRAME, // no payload
+
+	INPUT_RECORD_TABLET_TOOL_AXIS, // struct input_record_tablet_tool_axis
+	INPUT_RECORD_TABLET_TOOL_PROXIMITY, // struct input_record_tablet_tool_state
+	INPUT_RECORD_TABLET_TOOL_TIP, // struct input_record_tablet_tool_state
+	INPUT_RECORD_TABLET_TOOL_BUTTON, // struct input_record_tablet_tool_button
+};
+
+struct input_record_header {
+	uint16_t type; // enum input_record_type
+	uint16_t device; // assigned by the recorder, unique within a recording
+	uint32_t size; // of the payload
+	uint64_t time_usec; // CLOCK_MONOTONIC time at which the event was recorded
+};
+
+struct input_record_device_add {
+	uint32_t type; // enum wlr_input_device_type
+	uint32_t name_len; // followed by the name, without NUL terminator
+};
+
+struct input_record_pointer_motion {
+	uint32_t time_msec;
+	uint32_t reserved;
+	double delta_x, delta_y;
+	double unaccel_dx, unaccel_dy;
+};
+
+struct input_record_pointer_motion_absolute {
+	uint32_t time_msec;
+	uint32_t reserved;
+	double x, y;
+};
+
+struct input_record_pointer_button {
+	uint32_t time_msec;
+	uint32_t button;
+	uint32_t state;
+};
+
+struct input_record_pointer_axis {
+	uint32_t time_msec;
+	uint32_t source;
+	uint32_t orientation;
+	uint32_t relative_direction;
+	int32_t delta_discrete;
+	uint32_t reserved;
+	double delta;
+};
+
+struct input_record_gesture_begin {
+	uint32_t time_msec;
+	uint32_t fingers;
+};
+
+struct input_record_gesture_update {
+	uint32_t time_msec;
+	uint32_t fingers;
+	double dx, dy;
+	double scale, rotation; // pinch only
+};
+
+struct input_record_gesture_end {
+	uint32_t time_msec;
+	uint32_t cancelled;
+};
+
+struct input_record_keyboard_key {
+	uint32_t time_msec;
+	uint32_t keycode;
+	uint32_t state;
+	uint32_t update_state;
+};
+
+struct input_record_keyboard_modifiers {
+	uint32_t depressed, latched, locked, group;
+};
+
+struct input_record_touch {
+	uint32_t time_msec;
+	int32_t touch_id;
+	double x, y; // down and motion only
+};
+
+struct input_record_tablet_tool {
+	uint64_t hardware_serial;
+	uint64_t hardware_wacom;
+	uint32_t type; // enum wlr_tablet_tool_type
+	uint32_t capabilities; // enum input_record_tablet_tool_capability
+};
+
+enum input_record_tablet_tool_capability {
+	INPUT_RECORD_TABLET_TOOL_TILT = 1 << 0,
+	INPUT_RECORD_TABLET_TOOL_PRESSURE = 1 << 1,
+	INPUT_RECORD_TABLET_TOOL_DISTANCE = 1 << 2,
+	INPUT_RECORD_TABLET_TOOL_ROTATION = 1 << 3,
+	INPUT_RECORD_TABLET_TOOL_SLIDER = 1 << 4,
+	INPUT_RECORD_TABLET_TOOL_WHEEL = 1 << 5,
+};
+
+struct input_record_tablet_tool_axis {
+	struct input_record_tablet_tool tool;
+	uint32_t time_msec;
+	uint32_t updated_axes;
+	double x, y;
+	double dx, dy;
+	double pressure;
+	double distance;
+	double tilt_x, tilt_y;
+	double rotation;
+	double slider;
+	double wheel_delta;
+};
+
+struct input_record_tablet_tool_state {
+	struct input_record_tablet_tool tool;
+	uint32_t time_msec;
+	uint32_t state;
+	double x, y;
+};
+
+struct input_record_tablet_tool_button {
+	struct input_record_tablet_tool tool;
+	uint32_t time_msec;
+	uint32_t button;
+	uint32_t state;
+	uint32_t reserved;
+};
+
+#endif
@@ -22,6 +22,25 @@ bool output_cursor_set_texture(struct wlr_output_cursor *cursor,
 
 void output_defer_present(struct wlr_output *output, struct wlr_output_event_present event);
 
+/**
+ * Update vblank timings from a present event which presented a frame. The
+ * refresh period is set to zero if unknown.
+ */
+void output_update_vblank_timings(struct wlr_output *output,
+	const struct wlr_output_event_present *event,
+	struct timespec *last_present, int64_t *refresh_ns);
+/**
+ * Predict the first vblank at least budget_ns after now_ns, from the time of
+ * the last presentation and the refresh period.
+ */
+int64_t output_predict_vblank(const struct timespec *last_present,
+	int64_t refresh_ns, int64_t now_ns, int64_t budget_ns);
+/**
+ * Get the delay of an event loop timer firing before deadline_ns. Returns
+ * zero or less if the deadline is less than a millisecond away.
+ */
+int output_deadline_delay_ms(int64_t deadline_ns, int64_t now_ns);
+
 bool output_prepare_commit(struct wlr_output *output, const struct wlr_output_state *state);
 void output_apply_commit(struct wlr_output *output, const struct wlr_output_state *state);
 
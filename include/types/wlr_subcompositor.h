@@ -6,4 +6,10 @@
 void subsurface_consider_map(struct wlr_subsurface *subsurface);
 void subsurface_handle_parent_commit(struct wlr_subsurface *subsurface);
 
+/**
+ * Mark the flattened subsurface tree of the surface and its ancestors as
+ * outdated.
+ */
+void surface_invalidate_flattened_tree(struct wlr_surface *surface);
+
 #endif
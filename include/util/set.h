@@ -15,6 +15,14 @@
  */
 ssize_t set_add(uint32_t values[], size_t *len, size_t cap, uint32_t target);
 
+/**
+ * Add target to the end of values, without checking whether it already
+ * exists.
+ *
+ * Returns the index of target, or -1 if the set is full.
+ */
+ssize_t set_append(uint32_t values[], size_t *len, size_t cap, uint32_t target);
+
 /**
  * Remove target from values.
  *
@@ -7,5 +7,10 @@
 int create_shm_file(void);
 int allocate_shm_file(size_t size);
 bool allocate_shm_file_pair(size_t size, int *rw_fd, int *ro_fd);
+/**
+ * Allocate a memfd holding a copy of the data, sealed against any further
+ * modification. Returns -1 if sealing isn't supported or on error.
+ */
+int allocate_sealed_shm_file(const void *data, size_t size);
 
 #endif
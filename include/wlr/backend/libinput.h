@@ -19,11 +19,72 @@ struct wlr_input_device;
 struct wlr_backend *wlr_libinput_backend_create(struct wlr_session *session);
 /**
  * Gets the underlying struct libinput_device handle for the given input device.
+ *
+ * If the input thread is enabled, the handle may only be used from handlers of
+ * events emitted by the backend, or with wlr_libinput_device_configure().
  */
 struct libinput_device *wlr_libinput_get_device_handle(
 		struct wlr_input_device *dev);
 
+/**
+ * Call a function with exclusive access to the underlying libinput device,
+ * e.g. to change its configuration.
+ *
+ * If the backend reads input on a dedicated thread, this waits for the thread
+ * to release the libinput context. Otherwise, the function is called
+ * immediately.
+ */
+void wlr_libinput_device_configure(struct wlr_input_device *dev,
+	void (*configure)(struct libinput_device *handle, void *data), void *data);
+
+/**
+ * Read input on a dedicated thread, so that events are drained from the kernel
+ * while the event loop is busy. Events are still emitted on the event loop.
+ *
+ * The compositor must ensure that libinput is never used concurrently with the
+ * thread: libinput device handles may only be used from handlers of events
+ * emitted by the backend, or with wlr_libinput_device_configure(). In
+ * particular, handles must not be configured directly from the event loop.
+ * Messages logged by libinput are passed to wlr_log() from the input thread,
+ * so a custom log callback must be thread-safe.
+ *
+ * Must be called before the backend is started.
+ */
+void wlr_libinput_backend_enable_input_thread(struct wlr_backend *backend);
+
 bool wlr_backend_is_libinput(struct wlr_backend *backend);
 bool wlr_input_device_is_libinput(struct wlr_input_device *device);
 
+/**
+ * Input processing statistics of a libinput backend.
+ *
+ * Latencies are measured between the kernel timestamp of an event and the
+ * time it's processed by the backend. A high latency indicates that the
+ * event loop was busy while input was pending.
+ *
+ * With an input thread, events are read as soon as they're available and
+ * queued for the event loop: the queue latency is the time spent in the queue,
+ * and the queue depth is the number of events processed at once.
+ */
+struct wlr_libinput_backend_stats {
+	uint64_t dispatches; // number of times pending events were read
+	uint64_t events; // number of events processed
+	size_t max_queue_depth; // maximum number of events read at once
+
+	uint64_t timed_events; // number of events with a timestamp
+	uint64_t total_latency_usec;
+	uint64_t max_latency_usec;
+
+	uint64_t total_queue_latency_usec;
+	uint64_t max_queue_latency_usec;
+};
+
+/**
+ * Get the input processing statistics since the backend was started or the
+ * statistics were last reset.
+ */
+void wlr_libinput_backend_get_stats(struct wlr_backend *backend,
+	struct wlr_libinput_backend_stats *stats);
+void wlr_libinput_backend_reset_stats(struct wlr_backend *backend);
+
 #endif
@@ -0,0 +1,32 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_BACKEND_REPLAY_H
+#define WLR_BACKEND_REPLAY_H
+
+#include <wlr/backend.h>
+#include <wlr/types/wlr_input_device.h>
+
+/**
+ * Creates a replay backend. A replay backend has no outputs, it plays back
+ * input devices and events recorded with struct wlr_input_recorder.
+ *
+ * The recording is read from the file descriptor, which is closed. Playback
+ * starts when the backend is started. Events are emitted with the delays they
+ * were recorded with, divided by `speed`: 1 plays back at the original speed,
+ * 2 twice as fast. The event timestamps are replayed as recorded.
+ *
+ * Returns NULL if the recording is invalid.
+ */
+struct wlr_backend *wlr_replay_backend_create(struct wl_event_loop *loop,
+	int fd, double speed);
+
+bool wlr_backend_is_replay(struct wlr_backend *backend);
+bool wlr_input_device_is_replay(struct wlr_input_device *device);
+
+#endif
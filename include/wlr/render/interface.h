@@ -10,6 +10,7 @@
 #define WLR_RENDER_INTERFACE_H
 
 #include <stdbool.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/render/wlr_texture.h>
@@ -31,6 +32,7 @@ struct wlr_renderer_impl {
 	struct wlr_render_pass *(*begin_buffer_pass)(struct wlr_renderer *renderer,
 		struct wlr_buffer *buffer, const struct wlr_buffer_pass_options *options);
 	struct wlr_render_timer *(*render_timer_create)(struct wlr_renderer *renderer);
+	struct wlr_render_profiler *(*render_profiler_create)(struct wlr_renderer *renderer);
 };
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
@@ -50,6 +52,8 @@ void wlr_texture_init(struct wlr_texture *texture, struct wlr_renderer *rendener
 
 struct wlr_render_pass {
 	const struct wlr_render_pass_impl *impl;
+
+	struct wlr_render_profiler *profiler; // may be NULL
 };
 
 void wlr_render_pass_init(struct wlr_render_pass *pass,
@@ -73,6 +77,42 @@ struct wlr_render_timer_impl {
 	void (*destroy)(struct wlr_render_timer *timer);
 };
 
+#define WLR_RENDER_PROFILER_LABEL_SIZE 64
+
+struct wlr_render_profiler {
+	const struct wlr_render_profiler_impl *impl;
+
+	// private state
+
+	char label[WLR_RENDER_PROFILER_LABEL_SIZE];
+	struct timespec pass_start;
+	bool collected;
+	bool available;
+
+	struct wl_array entries; // struct wlr_render_profiler_entry
+	struct wl_array labels; // char[WLR_RENDER_PROFILER_LABEL_SIZE]
+	struct wl_array timestamps; // int64_t, two per entry
+
+	FILE *trace_file;
+	int trace_tid;
+};
+
+struct wlr_render_profiler_impl {
+	/* Write the timestamp with the given index into the render pass, the
+	 * beginning of entry i uses index 2 * i and its end 2 * i + 1 */
+	void (*write_timestamp)(struct wlr_render_profiler *profiler,
+		struct wlr_render_pass *pass, size_t index);
+	/* Read back the timestamps in nanoseconds, setting the ones which weren't
+	 * written to -1. Returns false if the results aren't available yet. */
+	bool (*get_timestamps)(struct wlr_render_profiler *profiler,
+		int64_t *timestamps, size_t len);
+	void (*destroy)(struct wlr_render_profiler *profiler);
+};
+
+void wlr_render_profiler_init(struct wlr_render_profiler *profiler,
+	const struct wlr_render_profiler_impl *impl);
+void wlr_render_profiler_finish(struct wlr_render_profiler *profiler);
+
 void wlr_render_texture_options_get_src_box(const struct wlr_render_texture_options *options,
 	struct wlr_fbox *box);
 void wlr_render_texture_options_get_dst_box(const struct wlr_render_texture_options *options,
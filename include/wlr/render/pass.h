@@ -27,9 +27,16 @@ struct wlr_render_pass;
  */
 struct wlr_render_timer;
 
+/**
+ * An object recording per-operation GPU timestamps for render passes.
+ */
+struct wlr_render_profiler;
+
 struct wlr_buffer_pass_options {
 	/* Timer to measure the duration of the render pass */
 	struct wlr_render_timer *timer;
+	/* Profiler to measure the duration of each operation of the render pass */
+	struct wlr_render_profiler *profiler;
 	/* Color transform to apply to the output of the render pass,
 	 * leave NULL to indicate sRGB/no custom transform */
 	struct wlr_color_transform *color_transform;
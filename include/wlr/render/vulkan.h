@@ -25,6 +25,26 @@ VkPhysicalDevice wlr_vk_renderer_get_physical_device(struct wlr_renderer *render
 VkDevice wlr_vk_renderer_get_device(struct wlr_renderer *renderer);
 uint32_t wlr_vk_renderer_get_queue_family(struct wlr_renderer *renderer);
 
+/**
+ * Merge a pipeline cache previously retrieved with
+ * wlr_vk_renderer_get_pipeline_cache_data() into the renderer's cache.
+ *
+ * This avoids compiling pipelines again on startup. Data originating from
+ * another device or driver version is rejected. Pipelines are created when
+ * an output is first rendered to, so this should be called right after
+ * creating the renderer.
+ */
+bool wlr_vk_renderer_load_pipeline_cache(struct wlr_renderer *renderer,
+	const void *data, size_t size);
+/**
+ * Serialize the renderer's pipeline cache, so that it can be saved to disk and
+ * loaded on the next startup. The returned buffer must be freed by the caller.
+ *
+ * Returns NULL on error.
+ */
+void *wlr_vk_renderer_get_pipeline_cache_data(struct wlr_renderer *renderer,
+	size_t *size);
+
 bool wlr_renderer_is_vk(struct wlr_renderer *wlr_renderer);
 bool wlr_texture_is_vk(struct wlr_texture *texture);
 
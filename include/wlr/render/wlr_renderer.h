@@ -10,10 +10,12 @@
 #define WLR_RENDER_WLR_RENDERER_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <wayland-server-core.h>
 #include <wlr/render/pass.h>
 #include <wlr/render/wlr_texture.h>
 #include <wlr/util/box.h>
+#include <wlr/util/log.h>
 
 struct wlr_backend;
 struct wlr_renderer_impl;
@@ -45,6 +47,12 @@ struct wlr_renderer {
 		 * Does the renderer support color transforms on its output?
 		 */
 		bool output_color_transform;
+		/**
+		 * Can render passes targeting different buffers be recorded
+		 * concurrently from multiple threads? Passes are still begun and
+		 * submitted from a single thread.
+		 */
+		bool concurrent_buffer_passes;
 	} features;
 
 	// private state
@@ -116,4 +124,67 @@ int wlr_render_timer_get_duration_ns(struct wlr_render_timer *timer);
  */
 void wlr_render_timer_destroy(struct wlr_render_timer *timer);
 
+enum wlr_render_profiler_op {
+	WLR_RENDER_PROFILER_OP_TEXTURE,
+	WLR_RENDER_PROFILER_OP_RECT,
+};
+
+/**
+ * A single operation of a profiled render pass.
+ */
+struct wlr_render_profiler_entry {
+	enum wlr_render_profiler_op op;
+	// label set via wlr_render_profiler_set_label() before the operation
+	const char *label;
+	// destination box, leave empty for the whole buffer
+	struct wlr_box box;
+	// start of the operation relative to the start of the render pass
+	int64_t start_ns;
+	// GPU duration of the operation, -1 if unavailable
+	int64_t duration_ns;
+};
+
+/**
+ * Allocate and initialise a new render profiler.
+ *
+ * The profiler can be passed to wlr_renderer_begin_buffer_pass() via
+ * struct wlr_buffer_pass_options.profiler. A profiler should only be used by
+ * one render pass at a time: results of the previous pass are collected when
+ * a new one begins, and discarded if the GPU isn't done yet. Compositors
+ * should use one profiler per output.
+ *
+ * Returns NULL if the renderer doesn't support GPU timestamps.
+ */
+struct wlr_render_profiler *wlr_render_profiler_create(struct wlr_renderer *renderer);
+
+/**
+ * Destroy the render profiler.
+ */
+void wlr_render_profiler_destroy(struct wlr_render_profiler *profiler);
+
+/**
+ * Set the label attributed to the next operations recorded by the profiler,
+ * for instance the scene node or the surface being rendered.
+ */
+void wlr_render_profiler_set_label(struct wlr_render_profiler *profiler,
+	const char *fmt, ...) _WLR_ATTRIB_PRINTF(2, 3);
+
+/**
+ * Get the entries recorded during the last render pass.
+ *
+ * Returns NULL if the results are unavailable, e.g. because the GPU hasn't
+ * finished the render pass yet.
+ */
+const struct wlr_render_profiler_entry *wlr_render_profiler_get_entries(
+	struct wlr_render_profiler *profiler, size_t *len);
+
+/**
+ * Write each collected render pass as Chrome trace events (JSON array format,
+ * loadable with chrome://tracing or Perfetto) to the file.
+ *
+ * The caller keeps ownership of the file. Pass NULL to stop tracing.
+ */
+void wlr_render_profiler_set_trace_file(struct wlr_render_profiler *profiler,
+	FILE *file);
+
 #endif
@@ -24,6 +24,13 @@ struct wlr_texture {
 	uint32_t width, height;
 
 	struct wlr_renderer *renderer;
+
+	/**
+	 * Whether the texture references the memory of the buffer it was created
+	 * from with wlr_texture_from_buffer(), instead of a copy. In that case,
+	 * the buffer is kept locked while the texture is alive.
+	 */
+	bool references_buffer;
 };
 
 struct wlr_texture_read_pixels_options {
@@ -154,6 +154,10 @@ struct wlr_client_buffer {
 	struct wl_listener renderer_destroy;
 
 	size_t n_ignore_locks;
+
+	// Color of the content uploaded to the texture, if it's a single pixel
+	bool is_single_pixel;
+	float single_pixel_color[4];
 };
 
 /**
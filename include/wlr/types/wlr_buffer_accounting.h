@@ -0,0 +1,103 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_BUFFER_ACCOUNTING_H
+#define WLR_TYPES_WLR_BUFFER_ACCOUNTING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+enum wlr_buffer_accounting_kind {
+	// Bytes of wl_shm pools mapped by the compositor
+	WLR_BUFFER_ACCOUNTING_SHM,
+	// Bytes of DMA-BUFs imported via linux-dmabuf-v1
+	WLR_BUFFER_ACCOUNTING_DMABUF,
+	// Estimated bytes of textures created for surfaces
+	WLR_BUFFER_ACCOUNTING_TEXTURE,
+	// Number of wl_buffer objects
+	WLR_BUFFER_ACCOUNTING_BUFFERS,
+};
+
+#define WLR_BUFFER_ACCOUNTING_KIND_COUNT (WLR_BUFFER_ACCOUNTING_BUFFERS + 1)
+
+struct wlr_buffer_accounting_usage {
+	size_t values[WLR_BUFFER_ACCOUNTING_KIND_COUNT]; // indexed by enum wlr_buffer_accounting_kind
+};
+
+/**
+ * Per-client accounting of the buffer memory pinned by the compositor.
+ *
+ * There can only be one accounting per display. Once created, wl_shm pools,
+ * linux-dmabuf-v1 buffers and surface textures are accounted to the client
+ * which created them. Resources created before are not accounted.
+ */
+struct wlr_buffer_accounting {
+	struct wl_display *display;
+
+	/**
+	 * Soft limits, zero means unlimited. When a client goes over one of the
+	 * limits, the limit_exceeded event is emitted from an idle callback if the
+	 * client is still over the limit by then. It's up to the compositor to
+	 * throttle or disconnect the client.
+	 *
+	 * To disconnect the client, handlers must post a protocol error (e.g. with
+	 * wl_client_post_implementation_error()) or defer the disconnection, not
+	 * call wl_client_destroy() synchronously.
+	 */
+	struct wlr_buffer_accounting_usage soft_limits;
+
+	struct {
+		struct wl_signal limit_exceeded; // struct wlr_buffer_accounting_client
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	struct wl_list clients; // wlr_buffer_accounting_client.link
+
+	struct wl_listener display_destroy;
+};
+
+struct wlr_buffer_accounting_client {
+	struct wl_client *client;
+	struct wlr_buffer_accounting_usage usage;
+
+	// private state
+
+	struct wlr_buffer_accounting *accounting;
+	struct wl_list link; // wlr_buffer_accounting.clients
+	struct wl_list entries; // wlr_buffer_accounting_entry.link
+	bool over_limit;
+	struct wl_event_source *limit_idle; // pending limit_exceeded event
+
+	struct wl_listener client_destroy;
+};
+
+/**
+ * A resource accounted to a client, embedded in the object holding it.
+ */
+struct wlr_buffer_accounting_entry {
+	struct wlr_buffer_accounting_client *client; // NULL if not accounted
+	enum wlr_buffer_accounting_kind kind;
+	size_t value;
+	struct wl_list link; // wlr_buffer_accounting_client.entries
+};
+
+struct wlr_buffer_accounting *wlr_buffer_accounting_create(struct wl_display *display);
+
+void wlr_buffer_accounting_destroy(struct wlr_buffer_accounting *accounting);
+
+/**
+ * Get the usage of a client. Returns NULL if nothing has been accounted to
+ * the client yet.
+ */
+struct wlr_buffer_accounting_client *wlr_buffer_accounting_get_client(
+	struct wlr_buffer_accounting *accounting, struct wl_client *client);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_COMMIT_LATCH_H
+#define WLR_TYPES_WLR_COMMIT_LATCH_H
+
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wlr/util/addon.h>
+
+struct wlr_output;
+struct wlr_surface;
+
+/**
+ * A per-output surface commit scheduler.
+ *
+ * Surface commits queued with wlr_commit_latch_queue() are applied together
+ * at a deadline before the predicted next vblank of the output. Commits
+ * queued after the deadline are deferred to the next frame. This keeps the
+ * time between a client commit and its presentation constant, which reduces
+ * jitter for games and video playback.
+ *
+ * The next vblank is predicted from the output's present events. Until a
+ * prediction is available (e.g. the output is disabled or has never been
+ * presented), queued commits are applied right away.
+ *
+ * When a latch is created for an output, wlr_linux_drm_syncobj_manager_v1
+ * waits for acquire points to be signalled, then queues the commits of
+ * surfaces on that output.
+ */
+struct wlr_commit_latch {
+	struct wlr_output *output;
+
+	struct {
+		struct wl_signal latch;
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	int64_t deadline_ns;
+	struct timespec last_present;
+	int64_t refresh_ns; // zero if unknown
+
+	struct wl_list commits; // struct wlr_commit_latch_commit.link
+	struct wl_event_source *timer;
+	bool timer_armed;
+	struct wl_event_source *idle_source;
+
+	struct wlr_addon addon;
+
+	struct wl_listener output_present;
+	struct wl_listener output_commit;
+};
+
+/**
+ * Create a commit latch for the output.
+ *
+ * There can only be one latch per output. The latch is destroyed along with
+ * the output.
+ */
+struct wlr_commit_latch *wlr_commit_latch_create(struct wlr_output *output);
+
+/**
+ * Destroy the latch. Queued commits are applied immediately.
+ */
+void wlr_commit_latch_destroy(struct wlr_commit_latch *latch);
+
+/**
+ * Get the commit latch of an output, if any.
+ */
+struct wlr_commit_latch *wlr_commit_latch_from_output(struct wlr_output *output);
+
+/**
+ * Set how long before the predicted vblank queued commits are applied, in
+ * nanoseconds. This should leave enough time for the compositor to render the
+ * next frame. The default is 4 milliseconds.
+ */
+void wlr_commit_latch_set_deadline(struct wlr_commit_latch *latch,
+	int64_t deadline_ns);
+
+/**
+ * Get the refresh period predicted for the output, in nanoseconds. Returns
+ * zero if no prediction is available.
+ */
+int64_t wlr_commit_latch_get_refresh_ns(struct wlr_commit_latch *latch);
+
+/**
+ * Queue a surface commit until the next deadline.
+ *
+ * The commit must have been locked with wlr_surface_lock_pending(). The latch
+ * takes over the lock and calls wlr_surface_unlock_cached() when the deadline
+ * is reached or when the latch is destroyed.
+ */
+bool wlr_commit_latch_queue(struct wlr_commit_latch *latch,
+	struct wlr_surface *surface, uint32_t seq);
+
+/**
+ * Get the commit latch which should schedule commits of a surface. This is the
+ * latch of the first output the surface is displayed on which has one.
+ */
+struct wlr_commit_latch *wlr_commit_latch_from_surface(struct wlr_surface *surface);
+
+#endif
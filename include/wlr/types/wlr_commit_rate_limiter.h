@@ -0,0 +1,68 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_COMMIT_RATE_LIMITER_H
+#define WLR_TYPES_WLR_COMMIT_RATE_LIMITER_H
+
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+struct wlr_compositor;
+
+/**
+ * A policy limiting how often surfaces can attach new buffers.
+ *
+ * A surface attaching buffers faster than the refresh rate of its output gets
+ * its commits deferred until the output's commit latch deadline (see
+ * struct wlr_commit_latch). Deferred commits are then applied together, and
+ * only the last buffer is uploaded: intermediate buffers are released without
+ * being used. Surfaces are only limited on outputs with a commit latch.
+ *
+ * The limiter should be created right after the compositor, surfaces created
+ * before are not limited.
+ */
+struct wlr_commit_rate_limiter {
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	struct wl_list clients; // wlr_commit_rate_limiter_client.link
+	struct wl_list surfaces; // wlr_commit_rate_limiter_surface.link
+
+	struct wl_listener compositor_new_surface;
+	struct wl_listener compositor_destroy;
+};
+
+struct wlr_commit_rate_limiter_client {
+	struct wl_client *client;
+	// Number of buffers which were replaced before being used
+	uint64_t dropped_buffers;
+
+	// private state
+
+	struct wlr_commit_rate_limiter *limiter;
+	struct wl_list link; // wlr_commit_rate_limiter.clients
+
+	struct wl_listener client_destroy;
+};
+
+struct wlr_commit_rate_limiter *wlr_commit_rate_limiter_create(
+	struct wlr_compositor *compositor);
+
+void wlr_commit_rate_limiter_destroy(struct wlr_commit_rate_limiter *limiter);
+
+/**
+ * Get the statistics of a client. Returns NULL if the client hasn't created
+ * any surface yet.
+ */
+struct wlr_commit_rate_limiter_client *wlr_commit_rate_limiter_get_client(
+	struct wlr_commit_rate_limiter *limiter, struct wl_client *client);
+
+#endif
@@ -14,10 +14,13 @@
 #include <stdint.h>
 #include <time.h>
 #include <wayland-server-core.h>
+#include <wlr/types/wlr_buffer_accounting.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/addon.h>
 #include <wlr/util/box.h>
 
+#define WLR_SURFACE_BUFFER_POOL_SIZE 2
+
 enum wlr_surface_state_field {
 	WLR_SURFACE_STATE_BUFFER = 1 << 0,
 	WLR_SURFACE_STATE_SURFACE_DAMAGE = 1 << 1,
@@ -68,6 +71,9 @@ struct wlr_surface_state {
 
 	// Number of locks that prevent this surface state from being committed.
 	size_t cached_state_locks;
+	// Number of locks which are about to be released, see
+	// wlr_surface_expect_unlock_cached().
+	size_t cached_state_expected_unlocks;
 	struct wl_list cached_state_link; // wlr_surface.cached
 
 	// Sync'ed object states, one per struct wlr_surface_synced
@@ -127,6 +133,11 @@ struct wlr_surface {
 	 * commits with a non-null buffer in its pending state. A surface will not
 	 * have a buffer if it has never committed one, has committed a null buffer,
 	 * or something went wrong with uploading the buffer.
+	 *
+	 * When a cached state is immediately replaced by another one attaching a
+	 * new buffer, its buffer isn't uploaded: during the commit event for that
+	 * state, this still holds the previous content and doesn't match
+	 * current.buffer.
 	 */
 	struct wlr_client_buffer *buffer;
 	/**
@@ -237,6 +248,26 @@ struct wlr_surface {
 
 	struct wl_resource *pending_buffer_resource;
 	struct wl_listener pending_buffer_resource_destroy;
+
+	// Previous client buffers whose texture can be updated in place when the
+	// current one is still referenced elsewhere
+	struct {
+		struct wlr_client_buffer *buffer; // may be NULL
+		// Damage since the buffer was current, in buffer-local coordinates
+		pixman_region32_t damage;
+	} buffer_pool[WLR_SURFACE_BUFFER_POOL_SIZE];
+	// Damage of superseded buffers which haven't been uploaded, in
+	// buffer-local coordinates
+	pixman_region32_t superseded_damage;
+
+	// Textures held by the surface
+	struct wlr_buffer_accounting_entry texture_accounting;
+
+	// The surface and its mapped descendants in rendering order, with their
+	// positions, rebuilt lazily by wlr_surface_for_each_surface()
+	struct wl_array flattened_tree; // struct wlr_surface_tree_entry
+	bool flattened_tree_dirty;
+	int flattened_tree_iterating;
 };
 
 struct wlr_renderer;
@@ -435,6 +466,18 @@ uint32_t wlr_surface_lock_pending(struct wlr_surface *surface);
  */
 void wlr_surface_unlock_cached(struct wlr_surface *surface, uint32_t seq);
 
+/**
+ * Announce that a lock for a cached state is about to be released with
+ * wlr_surface_unlock_cached(), as part of a batch of unlocks.
+ *
+ * Callers releasing many locks at once can use this before releasing any of
+ * them, so that cached states are applied in the order the locks are released
+ * while buffers replaced by a later state of the same batch are not uploaded.
+ * The next wlr_surface_unlock_cached() call for the state consumes the
+ * announcement.
+ */
+void wlr_surface_expect_unlock_cached(struct wlr_surface *surface, uint32_t seq);
+
 /**
  * Set the preferred buffer scale for the surface.
  *
@@ -141,6 +141,10 @@ void wlr_cursor_move(struct wlr_cursor *cur, struct wlr_input_device *dev,
  *
  * The buffer is used on all outputs and is scaled accordingly. The hotspot is
  * expressed in logical coordinates. A NULL buffer hides the cursor.
+ *
+ * The buffer contents are uploaded when the buffer is set. Setting the same
+ * buffer with the same hotspot and scale again is a no-op: to show modified
+ * contents, set another image first.
  */
 void wlr_cursor_set_buffer(struct wlr_cursor *cur, struct wlr_buffer *buffer,
 	int32_t hotspot_x, int32_t hotspot_y, float scale);
@@ -215,4 +219,41 @@ void wlr_cursor_map_to_region(struct wlr_cursor *cur, const struct wlr_box *box)
 void wlr_cursor_map_input_to_region(struct wlr_cursor *cur,
 	struct wlr_input_device *dev, const struct wlr_box *box);
 
+struct wlr_cursor_motion_coalescing_options {
+	/**
+	 * Minimum interval between two motion events of a device. Zero only
+	 * merges the motion events of a pointer frame.
+	 */
+	uint32_t interval_ms;
+	// Required if interval_ms is non-zero
+	struct wl_event_loop *event_loop;
+
+	// Also coalesce touch motion events, per touch point
+	bool touch;
+	// Also coalesce tablet tool axis events
+	bool tablet;
+	/**
+	 * Extrapolate the position of coalesced touch and tablet tool motion
+	 * this far ahead, using the velocity computed from the event
+	 * timestamps. Zero disables prediction.
+	 */
+	uint32_t prediction_ms;
+};
+
+/**
+ * Coalesce the motion events of input devices.
+ *
+ * Consecutive motion events of a device are merged into a single event,
+ * emitted right before the next frame or any other event of the device.
+ * Relative deltas are summed, including unaccelerated deltas, and the latest
+ * absolute positions are kept. With a non-zero interval, frames containing
+ * only motion are delayed so that at most one motion event per device is
+ * emitted per interval. Tablet tools don't have frames: their axis events
+ * are only coalesced with a non-zero interval.
+ *
+ * Pass NULL to disable coalescing, which is the default.
+ */
+void wlr_cursor_set_motion_coalescing(struct wlr_cursor *cur,
+	const struct wlr_cursor_motion_coalescing_options *options);
+
 #endif
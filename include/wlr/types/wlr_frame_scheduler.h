@@ -0,0 +1,108 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_FRAME_SCHEDULER_H
+#define WLR_TYPES_WLR_FRAME_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wlr/util/addon.h>
+
+#define WLR_FRAME_SCHEDULER_HISTORY_LEN 16
+
+struct wlr_output;
+
+/**
+ * An adaptive frame scheduler for an output.
+ *
+ * Backends send the output frame event right after a vblank, so compositors
+ * rendering in response start a full refresh period before their frame is
+ * presented. The frame scheduler delays the frame event until shortly before
+ * the predicted deadline of the next vblank, leaving just enough time to
+ * render, which reduces latency.
+ *
+ * The next vblank is predicted from the output's present events. The render
+ * duration is estimated from the durations reported with
+ * wlr_frame_scheduler_record_render_duration(). Until both are available, the
+ * frame event is forwarded right away.
+ *
+ * Compositors should listen to the scheduler's frame event instead of the
+ * output's, and keep using wlr_output_schedule_frame().
+ */
+struct wlr_frame_scheduler {
+	struct wlr_output *output;
+
+	struct {
+		struct wl_signal frame;
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	int64_t margin_ns;
+
+	struct timespec last_present;
+	int64_t refresh_ns; // zero if unknown
+
+	int64_t render_durations[WLR_FRAME_SCHEDULER_HISTORY_LEN];
+	size_t render_durations_len, render_durations_index;
+
+	struct wl_event_source *timer;
+	bool timer_armed;
+
+	struct wlr_addon addon;
+
+	struct wl_listener output_frame;
+	struct wl_listener output_present;
+	struct wl_listener output_commit;
+};
+
+struct wlr_frame_scheduler_prediction {
+	// Predicted presentation time of the next frame
+	struct timespec present;
+	// Estimated time needed to render a frame, in nanoseconds
+	int64_t render_duration_ns;
+	// Time at which the frame event should be sent to meet the deadline
+	struct timespec frame;
+};
+
+/**
+ * Create a frame scheduler for the output. It is destroyed along with the
+ * output.
+ */
+struct wlr_frame_scheduler *wlr_frame_scheduler_create(struct wlr_output *output);
+
+void wlr_frame_scheduler_destroy(struct wlr_frame_scheduler *scheduler);
+
+/**
+ * Set the safety margin added to the estimated render duration, in
+ * nanoseconds. The default is 1 millisecond.
+ */
+void wlr_frame_scheduler_set_margin(struct wlr_frame_scheduler *scheduler,
+	int64_t margin_ns);
+
+/**
+ * Record how long it took to render a frame, in nanoseconds. With the scene
+ * graph, this is the value returned by wlr_scene_timer_get_duration_ns(),
+ * which becomes available once the frame has been presented. Negative
+ * durations are ignored.
+ */
+void wlr_frame_scheduler_record_render_duration(
+	struct wlr_frame_scheduler *scheduler, int64_t duration_ns);
+
+/**
+ * Predict the timings of the next frame.
+ *
+ * Returns false if no prediction is available.
+ */
+bool wlr_frame_scheduler_predict(struct wlr_frame_scheduler *scheduler,
+	struct wlr_frame_scheduler_prediction *prediction);
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_INPUT_RECORDER_H
+#define WLR_TYPES_WLR_INPUT_RECORDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+struct wlr_input_device;
+
+/**
+ * Records the events of input devices into a file, along with the time they
+ * were received. Recordings can be played back with the replay backend, see
+ * wlr_replay_backend_create().
+ *
+ * Pointer, keyboard, touch and tablet tool events are recorded. Records are
+ * buffered in memory and written to the file when the buffer is full, when
+ * wlr_input_recorder_flush() is called and when the recorder is destroyed.
+ */
+struct wlr_input_recorder {
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	int fd;
+	struct wl_array buffer;
+	bool failed;
+	uint16_t next_device_id;
+	struct wl_list devices; // wlr_input_recorder_device.link
+};
+
+/**
+ * Create a recorder writing to a file descriptor, which should refer to a
+ * regular file. The recorder takes ownership of the file descriptor.
+ */
+struct wlr_input_recorder *wlr_input_recorder_create(int fd);
+
+void wlr_input_recorder_destroy(struct wlr_input_recorder *recorder);
+
+/**
+ * Start recording the events of an input device. The device is recorded until
+ * it's destroyed. Adding the same device twice has no effect.
+ *
+ * Returns false if the device type can't be recorded.
+ */
+bool wlr_input_recorder_add_device(struct wlr_input_recorder *recorder,
+	struct wlr_input_device *device);
+
+/**
+ * Write buffered records to the file. Returns false if writing failed, in
+ * which case recording stops.
+ */
+bool wlr_input_recorder_flush(struct wlr_input_recorder *recorder);
+
+#endif
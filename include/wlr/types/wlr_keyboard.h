@@ -38,8 +38,11 @@ enum wlr_keyboard_modifier {
 };
 
 #define WLR_KEYBOARD_KEYS_CAP 32
+// Pressed key codes below this value are tracked in a bitset (KEY_MAX + 1)
+#define WLR_KEYBOARD_KEYCODE_MAX 768
 
 struct wlr_keyboard_impl;
+struct wlr_keyboard_keymap_file;
 
 struct wlr_keyboard_modifiers {
 	xkb_mod_mask_t depressed;
@@ -93,6 +96,13 @@ struct wlr_keyboard {
 	} events;
 
 	void *data;
+
+	// private state
+
+	// Shared with all other keyboards using an identical keymap
+	struct wlr_keyboard_keymap_file *keymap_file;
+	// Bitset of the key codes in keycodes, below WLR_KEYBOARD_KEYCODE_MAX
+	uint64_t pressed_keys[WLR_KEYBOARD_KEYCODE_MAX / 64];
 };
 
 struct wlr_keyboard_key_event {
@@ -110,6 +120,12 @@ struct wlr_keyboard_key_event {
 struct wlr_keyboard *wlr_keyboard_from_input_device(
 	struct wlr_input_device *input_device);
 
+/**
+ * Set the keymap of the keyboard.
+ *
+ * Keyboards with identical keymaps share the same keymap string and
+ * read-only file descriptor.
+ */
 bool wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 	struct xkb_keymap *keymap);
 
@@ -15,7 +15,8 @@
 struct wlr_keyboard_group {
 	struct wlr_keyboard keyboard;
 	struct wl_list devices; // keyboard_group_device.link
-	struct wl_list keys; // keyboard_group_key.link
+	// keyboard_group_key.link, for key codes above WLR_KEYBOARD_KEYCODE_MAX
+	struct wl_list keys;
 
 	struct {
 		/**
@@ -41,6 +42,11 @@ struct wlr_keyboard_group {
 	} events;
 
 	void *data;
+
+	// private state
+
+	// Number of member keyboards pressing each key code
+	uint32_t key_counts[WLR_KEYBOARD_KEYCODE_MAX];
 };
 
 struct wlr_keyboard_group *wlr_keyboard_group_create(void);
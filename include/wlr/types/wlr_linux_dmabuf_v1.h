@@ -13,6 +13,7 @@
 #include <sys/stat.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_buffer_accounting.h>
 #include <wlr/render/dmabuf.h>
 #include <wlr/render/drm_format_set.h>
 
@@ -27,6 +28,8 @@ struct wlr_dmabuf_v1_buffer {
 	// private state
 
 	struct wl_listener release;
+
+	struct wlr_buffer_accounting_entry accounting_bytes, accounting_buffers;
 };
 
 /**
@@ -58,6 +61,7 @@ struct wlr_linux_dmabuf_v1 {
 	// private state
 
 	struct wlr_linux_dmabuf_feedback_v1_compiled *default_feedback;
+	struct wl_list compiled_feedbacks; // wlr_linux_dmabuf_feedback_v1_compiled.link
 	struct wlr_drm_format_set default_formats; // for legacy clients
 	struct wl_list surfaces; // wlr_linux_dmabuf_v1_surface.link
 
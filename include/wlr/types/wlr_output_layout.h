@@ -13,8 +13,7 @@
 #include <wayland-util.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/addon.h>
-
-struct wlr_box;
+#include <wlr/util/box.h>
 
 /**
  * Helper to arrange outputs in a 2D coordinate space. The output effective
@@ -38,6 +37,17 @@ struct wlr_output_layout {
 
 	// private state
 
+	struct wlr_box extents;
+
+	// Grid over the edges of the output boxes, each cell references the first
+	// output covering it. Only valid if the grid isn't too large.
+	struct {
+		bool valid;
+		int *xs, *ys; // sorted, de-duplicated
+		size_t xs_len, ys_len;
+		struct wlr_output_layout_output **cells; // (ys_len - 1) rows of (xs_len - 1)
+	} index;
+
 	struct wl_listener display_destroy;
 };
 
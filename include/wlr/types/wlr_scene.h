@@ -39,6 +39,7 @@ struct wlr_surface;
 struct wlr_scene_node;
 struct wlr_scene_buffer;
 struct wlr_scene_output_layout;
+struct wlr_scene_render_workers;
 
 struct wlr_presentation;
 struct wlr_linux_dmabuf_v1;
@@ -109,6 +110,9 @@ struct wlr_scene {
 	bool direct_scanout;
 	bool calculate_visibility;
 	bool highlight_transparent_region;
+
+	// Created on first use by wlr_scene_output_build_states()
+	struct wlr_scene_render_workers *render_workers;
 };
 
 /** A scene-graph node displaying a single surface. */
@@ -191,6 +195,9 @@ struct wlr_scene_buffer {
 	int buffer_width, buffer_height;
 	bool buffer_is_opaque;
 
+	bool is_single_pixel_buffer;
+	float single_pixel_buffer_color[4]; // premultiplied
+
 	struct wl_listener buffer_release;
 	struct wl_listener renderer_destroy;
 };
@@ -217,6 +224,10 @@ struct wlr_scene_output {
 	uint8_t index;
 	bool prev_scanout;
 
+	// last composited buffer, re-used if nothing changed since then
+	struct wlr_buffer *last_buffer;
+	struct wlr_color_transform *last_color_transform;
+
 	struct wl_listener output_commit;
 	struct wl_listener output_damage;
 	struct wl_listener output_needs_frame;
@@ -470,6 +481,12 @@ void wlr_scene_output_set_position(struct wlr_scene_output *scene_output,
 
 struct wlr_scene_output_state_options {
 	struct wlr_scene_timer *timer;
+	/**
+	 * Profiler recording the GPU duration of each rendered node, labelled
+	 * after the node or the surface and client it displays. See
+	 * wlr_render_profiler_create().
+	 */
+	struct wlr_render_profiler *profiler;
 	struct wlr_color_transform *color_transform;
 
 	/**
@@ -492,6 +509,31 @@ bool wlr_scene_output_commit(struct wlr_scene_output *scene_output,
 bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	struct wlr_output_state *state, const struct wlr_scene_output_state_options *options);
 
+struct wlr_scene_output_state_job {
+	struct wlr_scene_output *scene_output;
+	struct wlr_output_state *state;
+	const struct wlr_scene_output_state_options *options; // may be NULL
+
+	bool success; // set by wlr_scene_output_build_states()
+};
+
+/**
+ * Render and populate the given output states, like
+ * wlr_scene_output_build_state() called on each job.
+ *
+ * If the renderers of all outputs support concurrent render passes, the
+ * render passes are recorded in parallel on worker threads, which are kept
+ * around until the scene is destroyed. Render passes are begun and submitted
+ * from the calling thread. The function only returns once all outputs have
+ * been rendered, so the scene graph is never modified while rendering. All
+ * scene outputs must belong to the same scene, and each scene output must
+ * appear at most once.
+ *
+ * Returns false if any job failed.
+ */
+bool wlr_scene_output_build_states(struct wlr_scene_output_state_job *jobs,
+	size_t jobs_len);
+
 /**
  * Retrieve the duration in nanoseconds between the last wlr_scene_output_commit() call and the end
  * of its operations, including those on the GPU that may have finished after the call returned.
@@ -18,6 +18,7 @@
 struct wlr_surface;
 
 #define WLR_SERIAL_RINGSET_SIZE 128
+#define WLR_SEAT_CLIENT_BUCKETS 64
 
 struct wlr_serial_range {
 	uint32_t min_incl;
@@ -67,6 +68,10 @@ struct wlr_seat_client {
 		int32_t last_discrete[2];
 		double acc_axis[2];
 	} value120;
+
+	// private state
+
+	struct wl_list bucket_link; // wlr_seat.client_buckets
 };
 
 struct wlr_touch_point {
@@ -298,6 +303,11 @@ struct wlr_seat {
 	} events;
 
 	void *data;
+
+	// private state
+
+	// wlr_seat_client.bucket_link, indexed by a hash of the wl_client
+	struct wl_list client_buckets[WLR_SEAT_CLIENT_BUCKETS];
 };
 
 struct wlr_seat_pointer_request_set_cursor_event {
@@ -31,6 +31,10 @@ struct wlr_xcursor_manager {
 	char *name;
 	uint32_t size;
 	struct wl_list scaled_themes; // wlr_xcursor_manager_theme.link
+
+	struct {
+		struct wl_signal destroy;
+	} events;
 };
 
 /**
@@ -70,14 +70,24 @@ struct wlr_xcursor {
 	uint32_t total_delay; /* total duration of the animation in ms */
 };
 
+struct wlr_xcursor_theme_file;
+
 /**
  * Container for an Xcursor theme.
+ *
+ * Cursors are loaded lazily: the cursors array only contains the cursors
+ * which have been looked up via wlr_xcursor_theme_get_cursor() so far.
  */
 struct wlr_xcursor_theme {
 	unsigned int cursor_count;
 	struct wlr_xcursor **cursors;
 	char *name;
 	int size;
+
+	// private state
+
+	struct wlr_xcursor_theme_file *files;
+	size_t files_len, files_cap;
 };
 
 /**
@@ -90,6 +100,9 @@ struct wlr_xcursor_theme {
  *
  * The size is given in pixels.
  *
+ * Only the list of cursor files is read, cursor images are loaded on first
+ * use by wlr_xcursor_theme_get_cursor().
+ *
  * If a cursor theme with the given name couldn't be loaded, a fallback theme
  * is loaded.
  *
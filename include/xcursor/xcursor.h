@@ -52,7 +52,10 @@ void
 xcursor_images_destroy(struct xcursor_images *images);
 
 void
-xcursor_load_theme(const char *theme, int size,
-		   void (*load_callback)(struct xcursor_images *, void *),
+xcursor_scan_theme(const char *theme,
+		   void (*scan_callback)(const char *name, const char *path, void *),
 		   void *user_data);
+
+struct xcursor_images *
+xcursor_load_images(const char *path, const char *name, int size);
 #endif
@@ -29,6 +29,7 @@
 
 static const struct wlr_renderer_impl renderer_impl;
 static const struct wlr_render_timer_impl render_timer_impl;
+static const struct wlr_render_profiler_impl render_profiler_impl;
 
 bool wlr_renderer_is_gles2(struct wlr_renderer *wlr_renderer) {
 	return wlr_renderer->impl == &renderer_impl;
@@ -352,6 +353,124 @@ static void gles2_render_timer_destroy(struct wlr_render_timer *wlr_timer) {
 	free(timer);
 }
 
+static struct wlr_gles2_render_profiler *gles2_get_render_profiler(
+		struct wlr_render_profiler *wlr_profiler) {
+	assert(wlr_profiler->impl == &render_profiler_impl);
+	struct wlr_gles2_render_profiler *profiler =
+		wl_container_of(wlr_profiler, profiler, base);
+	return profiler;
+}
+
+static struct wlr_render_profiler *gles2_render_profiler_create(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
+	if (!renderer->exts.EXT_disjoint_timer_query) {
+		wlr_log(WLR_ERROR, "can't create profiler, EXT_disjoint_timer_query not available");
+		return NULL;
+	}
+
+	struct wlr_gles2_render_profiler *profiler = calloc(1, sizeof(*profiler));
+	if (!profiler) {
+		return NULL;
+	}
+	wlr_render_profiler_init(&profiler->base, &render_profiler_impl);
+	profiler->renderer = renderer;
+	wl_array_init(&profiler->queries);
+
+	return &profiler->base;
+}
+
+static void gles2_render_profiler_write_timestamp(
+		struct wlr_render_profiler *wlr_profiler, struct wlr_render_pass *pass,
+		size_t index) {
+	struct wlr_gles2_render_profiler *profiler = gles2_get_render_profiler(wlr_profiler);
+	struct wlr_gles2_renderer *renderer = profiler->renderer;
+
+	if (index == 0) {
+		profiler->written = 0;
+	}
+
+	// The render pass keeps the EGL context current
+	size_t queries_len = profiler->queries.size / sizeof(GLuint);
+	if (index >= queries_len) {
+		size_t new_len = queries_len * 2 > index + 1 ? queries_len * 2 : index + 1;
+		GLuint *new_queries = wl_array_add(&profiler->queries,
+			(new_len - queries_len) * sizeof(GLuint));
+		if (new_queries == NULL) {
+			return;
+		}
+		renderer->procs.glGenQueriesEXT(new_len - queries_len, new_queries);
+	}
+
+	GLuint *queries = profiler->queries.data;
+	renderer->procs.glQueryCounterEXT(queries[index], GL_TIMESTAMP_EXT);
+	if (index + 1 > profiler->written) {
+		profiler->written = index + 1;
+	}
+}
+
+static bool gles2_render_profiler_get_timestamps(
+		struct wlr_render_profiler *wlr_profiler, int64_t *timestamps, size_t len) {
+	struct wlr_gles2_render_profiler *profiler = gles2_get_render_profiler(wlr_profiler);
+	struct wlr_gles2_renderer *renderer = profiler->renderer;
+
+	for (size_t i = 0; i < len; i++) {
+		timestamps[i] = -1;
+	}
+
+	size_t written = profiler->written < len ? profiler->written : len;
+	if (written == 0) {
+		return true;
+	}
+
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_make_current(renderer->egl, &prev_ctx);
+
+	GLint64 disjoint;
+	renderer->procs.glGetInteger64vEXT(GL_GPU_DISJOINT_EXT, &disjoint);
+	if (disjoint) {
+		wlr_log(WLR_ERROR, "a disjoint operation occurred and the profiler results are invalid");
+		wlr_egl_restore_context(&prev_ctx);
+		return true;
+	}
+
+	// Queries complete in order, checking the last one is enough
+	GLuint *queries = profiler->queries.data;
+	GLint available;
+	renderer->procs.glGetQueryObjectivEXT(queries[written - 1],
+		GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+	if (!available) {
+		wlr_egl_restore_context(&prev_ctx);
+		return false;
+	}
+
+	for (size_t i = 0; i < written; i++) {
+		GLuint64 value;
+		renderer->procs.glGetQueryObjectui64vEXT(queries[i], GL_QUERY_RESULT_EXT, &value);
+		timestamps[i] = value;
+	}
+
+	wlr_egl_restore_context(&prev_ctx);
+	return true;
+}
+
+static void gles2_render_profiler_destroy(struct wlr_render_profiler *wlr_profiler) {
+	struct wlr_gles2_render_profiler *profiler = gles2_get_render_profiler(wlr_profiler);
+	struct wlr_gles2_renderer *renderer = profiler->renderer;
+
+	size_t queries_len = profiler->queries.size / sizeof(GLuint);
+	if (queries_len > 0) {
+		struct wlr_egl_context prev_ctx;
+		wlr_egl_make_current(renderer->egl, &prev_ctx);
+		renderer->procs.glDeleteQueriesEXT(queries_len, profiler->queries.data);
+		wlr_egl_restore_context(&prev_ctx);
+	}
+
+	wl_array_release(&profiler->queries);
+	wlr_render_profiler_finish(&profiler->base);
+	free(profiler);
+}
+
 static const struct wlr_renderer_impl renderer_impl = {
 	.destroy = gles2_destroy,
 	.get_texture_formats = gles2_get_texture_formats,
@@ -360,6 +479,7 @@ static const struct wlr_renderer_impl renderer_impl = {
 	.texture_from_buffer = gles2_texture_from_buffer,
 	.begin_buffer_pass = gles2_begin_buffer_pass,
 	.render_timer_create = gles2_render_timer_create,
+	.render_profiler_create = gles2_render_profiler_create,
 };
 
 static const struct wlr_render_timer_impl render_timer_impl = {
@@ -367,6 +487,12 @@ static const struct wlr_render_timer_impl render_timer_impl = {
 	.destroy = gles2_render_timer_destroy,
 };
 
+static const struct wlr_render_profiler_impl render_profiler_impl = {
+	.write_timestamp = gles2_render_profiler_write_timestamp,
+	.get_timestamps = gles2_render_profiler_get_timestamps,
+	.destroy = gles2_render_profiler_destroy,
+};
+
 void push_gles2_debug_(struct wlr_gles2_renderer *renderer,
 		const char *file, const char *func) {
 	if (!renderer->procs.glPushDebugGroupKHR) {
@@ -377,6 +377,7 @@ static struct wlr_texture *gles2_texture_from_dmabuf(
 
 	texture->target = buffer->external_only ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D;
 	texture->buffer = buffer;
+	texture->wlr_texture.references_buffer = true;
 	texture->drm_format = DRM_FORMAT_INVALID; // texture can't be written anyways
 	texture->has_alpha = pixel_format_has_alpha(attribs->format);
 
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <string.h>
 #include <wlr/render/interface.h>
+#include "render/wlr_renderer.h"
 
 void wlr_render_pass_init(struct wlr_render_pass *render_pass,
 		const struct wlr_render_pass_impl *impl) {
@@ -25,13 +26,32 @@ void wlr_render_pass_add_texture(struct wlr_render_pass *render_pass,
 			box->y + box->height <= options->texture->height);
 	}
 
+	struct wlr_render_profiler *profiler = render_pass->profiler;
+	struct wlr_box box;
+	wlr_render_texture_options_get_dst_box(options, &box);
+	if (profiler == NULL || !render_profiler_begin_op(profiler, render_pass,
+			WLR_RENDER_PROFILER_OP_TEXTURE, &box)) {
+		render_pass->impl->add_texture(render_pass, options);
+		return;
+	}
+
 	render_pass->impl->add_texture(render_pass, options);
+	render_profiler_end_op(profiler, render_pass);
 }
 
 void wlr_render_pass_add_rect(struct wlr_render_pass *render_pass,
 		const struct wlr_render_rect_options *options) {
 	assert(options->box.width >= 0 && options->box.height >= 0);
+
+	struct wlr_render_profiler *profiler = render_pass->profiler;
+	if (profiler == NULL || !render_profiler_begin_op(profiler, render_pass,
+			WLR_RENDER_PROFILER_OP_RECT, &options->box)) {
+		render_pass->impl->add_rect(render_pass, options);
+		return;
+	}
+
 	render_pass->impl->add_rect(render_pass, options);
+	render_profiler_end_op(profiler, render_pass);
 }
 
 void wlr_render_texture_options_get_src_box(const struct wlr_render_texture_options *options,
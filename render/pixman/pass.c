@@ -1,8 +1,13 @@
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
+#include <wlr/render/color.h>
+#include <wlr/util/log.h>
+#include "render/color.h"
 #include "render/pixman.h"
 
 static const struct wlr_render_pass_impl render_pass_impl;
+static const struct wlr_addon_interface pixman_color_transform_impl;
 
 static struct wlr_pixman_render_pass *get_render_pass(struct wlr_render_pass *wlr_pass) {
 	assert(wlr_pass->impl == &render_pass_impl);
@@ -16,9 +21,153 @@ static struct wlr_pixman_texture *get_texture(struct wlr_texture *wlr_texture) {
 	return texture;
 }
 
+static uint32_t lerp(uint32_t a, uint32_t b, uint32_t weight) {
+	return (a * (256 - weight) + b * weight) >> 8;
+}
+
+#if defined(__GNUC__)
+/**
+ * The channels of a LUT grid point are interpolated at once using the
+ * compiler's generic vector extensions, which map to SSE2 or NEON.
+ */
+typedef uint32_t lut_vec_t __attribute__((vector_size(16)));
+
+static lut_vec_t lut_load(const uint16_t *p) {
+	return (lut_vec_t){ p[0], p[1], p[2], p[3] };
+}
+
+static lut_vec_t lerp_vec(lut_vec_t a, lut_vec_t b, uint32_t weight) {
+	return (a * (256 - weight) + b * weight) >> 8;
+}
+#endif
+
+static uint32_t color_transform_apply_pixel(
+		const struct wlr_pixman_color_transform *transform, uint32_t pixel) {
+	uint32_t a = pixel >> 24;
+	if (a == 0) {
+		return 0;
+	}
+
+	// Convert from pre-multiplied alpha to straight alpha
+	uint32_t rgb[3] = { (pixel >> 16) & 0xFF, (pixel >> 8) & 0xFF, pixel & 0xFF };
+	if (a != 0xFF) {
+		for (size_t i = 0; i < 3; i++) {
+			rgb[i] = (rgb[i] * 0xFF + a / 2) / a;
+			if (rgb[i] > 0xFF) {
+				rgb[i] = 0xFF;
+			}
+		}
+	}
+
+	size_t dim_len = transform->dim_len;
+	size_t r_index = transform->index[rgb[0]];
+	size_t g_index = transform->index[rgb[1]];
+	size_t b_index = transform->index[rgb[2]];
+	uint32_t r_weight = transform->weight[rgb[0]];
+	uint32_t g_weight = transform->weight[rgb[1]];
+	uint32_t b_weight = transform->weight[rgb[2]];
+
+	size_t r_step = 4, g_step = 4 * dim_len, b_step = 4 * dim_len * dim_len;
+	const uint16_t *base = &transform->lut[4 * r_index +
+		g_step * g_index + b_step * b_index];
+
+	// Trilinear interpolation between the 8 surrounding grid points
+	uint32_t values[3];
+#if defined(__GNUC__)
+	lut_vec_t c00 = lerp_vec(lut_load(base), lut_load(base + r_step), r_weight);
+	lut_vec_t c10 = lerp_vec(lut_load(base + g_step),
+		lut_load(base + g_step + r_step), r_weight);
+	lut_vec_t c01 = lerp_vec(lut_load(base + b_step),
+		lut_load(base + b_step + r_step), r_weight);
+	lut_vec_t c11 = lerp_vec(lut_load(base + b_step + g_step),
+		lut_load(base + b_step + g_step + r_step), r_weight);
+	lut_vec_t c0 = lerp_vec(c00, c10, g_weight);
+	lut_vec_t c1 = lerp_vec(c01, c11, g_weight);
+	lut_vec_t value = lerp_vec(c0, c1, b_weight);
+	for (size_t i = 0; i < 3; i++) {
+		values[i] = value[i];
+	}
+#else
+	for (size_t i = 0; i < 3; i++) {
+		const uint16_t *p = base + i;
+		uint32_t c00 = lerp(p[0], p[r_step], r_weight);
+		uint32_t c10 = lerp(p[g_step], p[g_step + r_step], r_weight);
+		uint32_t c01 = lerp(p[b_step], p[b_step + r_step], r_weight);
+		uint32_t c11 = lerp(p[b_step + g_step], p[b_step + g_step + r_step], r_weight);
+		uint32_t c0 = lerp(c00, c10, g_weight);
+		uint32_t c1 = lerp(c01, c11, g_weight);
+		values[i] = lerp(c0, c1, b_weight);
+	}
+#endif
+
+	// Back to pre-multiplied alpha and 8 bits per channel
+	uint32_t out = a << 24;
+	for (size_t i = 0; i < 3; i++) {
+		out |= ((values[i] * a + 0xFFFF / 2) / 0xFFFF) << (16 - 8 * i);
+	}
+	return out;
+}
+
+static void render_pass_apply_color_transform(struct wlr_pixman_render_pass *pass) {
+	pixman_image_t *src = pass->image;
+	pixman_image_t *dst = pass->buffer->image;
+	int width = pixman_image_get_width(src);
+	int height = pixman_image_get_height(src);
+
+	pixman_region32_intersect_rect(&pass->damage, &pass->damage, 0, 0, width, height);
+
+	uint32_t *row = malloc(width * sizeof(*row));
+	pixman_image_t *row_image = NULL;
+	if (row != NULL) {
+		row_image = pixman_image_create_bits_no_clear(PIXMAN_a8r8g8b8,
+			width, 1, row, width * sizeof(*row));
+	}
+	if (row_image == NULL) {
+		wlr_log(WLR_ERROR, "Failed to allocate color transform row");
+		free(row);
+		return;
+	}
+
+	const uint32_t *src_data = pixman_image_get_data(src);
+	size_t src_stride = pixman_image_get_stride(src) / sizeof(*src_data);
+
+	// Neighbouring pixels often have the same color, skip the lookup for them
+	uint32_t prev_in = 0, prev_out = 0;
+
+	int rects_len;
+	const pixman_box32_t *rects = pixman_region32_rectangles(&pass->damage, &rects_len);
+	for (int i = 0; i < rects_len; i++) {
+		const pixman_box32_t *rect = &rects[i];
+		int rect_width = rect->x2 - rect->x1;
+		for (int y = rect->y1; y < rect->y2; y++) {
+			const uint32_t *src_row = &src_data[y * src_stride + rect->x1];
+			for (int x = 0; x < rect_width; x++) {
+				if (src_row[x] != prev_in) {
+					prev_in = src_row[x];
+					prev_out = color_transform_apply_pixel(pass->lut_3d, prev_in);
+				}
+				row[x] = prev_out;
+			}
+
+			// Let pixman convert to the buffer format
+			pixman_image_composite32(PIXMAN_OP_SRC, row_image, NULL, dst,
+				0, 0, 0, 0, rect->x1, y, rect_width, 1);
+		}
+	}
+
+	pixman_image_unref(row_image);
+	free(row);
+}
+
 static bool render_pass_submit(struct wlr_render_pass *wlr_pass) {
 	struct wlr_pixman_render_pass *pass = get_render_pass(wlr_pass);
 
+	if (pass->lut_3d != NULL) {
+		render_pass_apply_color_transform(pass);
+		pixman_region32_fini(&pass->damage);
+	}
+	wlr_color_transform_unref(pass->color_transform);
+
 	wlr_buffer_end_data_ptr_access(pass->buffer->buffer);
 	wlr_buffer_unlock(pass->buffer->buffer);
 	free(pass);
@@ -26,6 +175,21 @@ static bool render_pass_submit(struct wlr_render_pass *wlr_pass) {
 	return true;
 }
 
+static void render_pass_add_damage(struct wlr_pixman_render_pass *pass,
+		const struct wlr_box *box, const pixman_region32_t *clip) {
+	if (pass->lut_3d == NULL) {
+		return;
+	}
+
+	pixman_region32_t region;
+	pixman_region32_init_rect(&region, box->x, box->y, box->width, box->height);
+	if (clip != NULL) {
+		pixman_region32_intersect(&region, &region, clip);
+	}
+	pixman_region32_union(&pass->damage, &pass->damage, &region);
+	pixman_region32_fini(&region);
+}
+
 static pixman_op_t get_pixman_blending(enum wlr_render_blend_mode mode) {
 	switch (mode) {
 	case WLR_RENDER_BLEND_MODE_PREMULTIPLIED:
@@ -42,13 +206,16 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 	struct wlr_pixman_texture *texture = get_texture(options->texture);
 	struct wlr_pixman_buffer *buffer = pass->buffer;
 
+	pixman_texture_lock(texture);
+
 	if (texture->buffer != NULL && !begin_pixman_data_ptr_access(texture->buffer,
 			&texture->image, WLR_BUFFER_DATA_PTR_ACCESS_READ)) {
+		pixman_texture_unlock(texture);
 		return;
 	}
 
 	pixman_op_t op = get_pixman_blending(options->blend_mode);
-	pixman_image_set_clip_region32(buffer->image, (pixman_region32_t *)options->clip);
+	pixman_image_set_clip_region32(pass->image, (pixman_region32_t *)options->clip);
 
 	struct wlr_fbox src_fbox;
 	wlr_render_texture_options_get_src_box(options, &src_fbox);
@@ -61,6 +228,7 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 
 	struct wlr_box dst_box;
 	wlr_render_texture_options_get_dst_box(options, &dst_box);
+	render_pass_add_damage(pass, &dst_box, options->clip);
 
 	pixman_image_t *mask = NULL;
 	float alpha = wlr_render_texture_options_get_alpha(options);
@@ -171,7 +339,7 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 		// width,height part of source crop is done here by the width and height we pass:
 		// because of the scaling, cropping at the end by dst_box.{width,height} is
 		// equivalent to if we cropped at the start by src_box.{width,height}.
-		pixman_image_composite32(op, texture->image, mask, buffer->image,
+		pixman_image_composite32(op, texture->image, mask, pass->image,
 			0, 0, // source x,y
 			0, 0, // mask x,y
 			dst_box.x, dst_box.y, // dest x,y
@@ -182,17 +350,19 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 	} else {
 		// No transforms or crop needed, just a straight blit from the source
 		pixman_image_set_transform(texture->image, NULL);
-		pixman_image_composite32(op, texture->image, mask, buffer->image,
+		pixman_image_composite32(op, texture->image, mask, pass->image,
 			src_box.x, src_box.y, 0, 0, dst_box.x, dst_box.y,
 			src_box.width, src_box.height);
 	}
 
-	pixman_image_set_clip_region32(buffer->image, NULL);
+	pixman_image_set_clip_region32(pass->image, NULL);
 
 	if (texture->buffer != NULL) {
 		wlr_buffer_end_data_ptr_access(texture->buffer);
 	}
 
+	pixman_texture_unlock(texture);
+
 	if (mask != NULL) {
 		pixman_image_unref(mask);
 	}
@@ -201,9 +371,9 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 static void render_pass_add_rect(struct wlr_render_pass *wlr_pass,
 		const struct wlr_render_rect_options *options) {
 	struct wlr_pixman_render_pass *pass = get_render_pass(wlr_pass);
-	struct wlr_pixman_buffer *buffer = pass->buffer;
 	struct wlr_box box;
 	wlr_render_rect_options_get_box(options, pass->buffer->buffer, &box);
+	render_pass_add_damage(pass, &box, options->clip);
 
 	pixman_op_t op = get_pixman_blending(options->color.a == 1 ?
 		WLR_RENDER_BLEND_MODE_NONE : options->blend_mode);
@@ -217,10 +387,10 @@ static void render_pass_add_rect(struct wlr_render_pass *wlr_pass,
 
 	pixman_image_t *fill = pixman_image_create_solid_fill(&color);
 
-	pixman_image_set_clip_region32(buffer->image, (pixman_region32_t *)options->clip);
-	pixman_image_composite32(op, fill, NULL, buffer->image,
+	pixman_image_set_clip_region32(pass->image, (pixman_region32_t *)options->clip);
+	pixman_image_composite32(op, fill, NULL, pass->image,
 		0, 0, 0, 0, box.x, box.y, box.width, box.height);
-	pixman_image_set_clip_region32(buffer->image, NULL);
+	pixman_image_set_clip_region32(pass->image, NULL);
 
 	pixman_image_unref(fill);
 }
@@ -231,8 +401,87 @@ static const struct wlr_render_pass_impl render_pass_impl = {
 	.add_rect = render_pass_add_rect,
 };
 
+void pixman_color_transform_destroy(struct wlr_addon *addon) {
+	struct wlr_pixman_color_transform *transform =
+		wl_container_of(addon, transform, addon);
+	wl_list_remove(&transform->link);
+	wlr_addon_finish(&transform->addon);
+	free(transform->lut);
+	free(transform);
+}
+
+static const struct wlr_addon_interface pixman_color_transform_impl = {
+	.name = "pixman_color_transform",
+	.destroy = pixman_color_transform_destroy,
+};
+
+static float srgb_channel_to_linear(float x) {
+	if (x <= 0.04045) {
+		return x / 12.92;
+	}
+	return powf((x + 0.055) / 1.055, 2.4);
+}
+
+static struct wlr_pixman_color_transform *pixman_color_transform_create(
+		struct wlr_pixman_renderer *renderer, struct wlr_color_transform *transform) {
+	assert(transform->type == COLOR_TRANSFORM_LUT_3D);
+	const struct wlr_color_transform_lut3d *lut3d = &transform->lut3d;
+	size_t dim_len = lut3d->dim_len;
+	assert(dim_len >= 2 && dim_len <= UINT16_MAX);
+
+	struct wlr_pixman_color_transform *pixman_transform =
+		calloc(1, sizeof(*pixman_transform));
+	if (pixman_transform == NULL) {
+		return NULL;
+	}
+
+	size_t points_len = dim_len * dim_len * dim_len;
+	pixman_transform->lut = calloc(4 * points_len, sizeof(uint16_t));
+	if (pixman_transform->lut == NULL) {
+		free(pixman_transform);
+		return NULL;
+	}
+	pixman_transform->dim_len = dim_len;
+
+	for (size_t i = 0; i < points_len; i++) {
+		for (size_t j = 0; j < 3; j++) {
+			float value = lut3d->lut_3d[3 * i + j];
+			value = fminf(fmaxf(value, 0), 1);
+			pixman_transform->lut[4 * i + j] = roundf(value * UINT16_MAX);
+		}
+	}
+
+	for (size_t i = 0; i < 256; i++) {
+		float pos = srgb_channel_to_linear(i / 255.0f) * (dim_len - 1);
+		size_t index = floorf(pos);
+		if (index > dim_len - 2) {
+			index = dim_len - 2;
+		}
+		pixman_transform->index[i] = index;
+		pixman_transform->weight[i] = roundf((pos - index) * 256);
+	}
+
+	wlr_addon_init(&pixman_transform->addon, &transform->addons,
+		renderer, &pixman_color_transform_impl);
+	wl_list_insert(&renderer->color_transforms, &pixman_transform->link);
+
+	return pixman_transform;
+}
+
+static struct wlr_pixman_color_transform *get_color_transform(
+		struct wlr_pixman_renderer *renderer, struct wlr_color_transform *transform) {
+	struct wlr_addon *addon = wlr_addon_find(&transform->addons, renderer,
+		&pixman_color_transform_impl);
+	if (addon == NULL) {
+		return pixman_color_transform_create(renderer, transform);
+	}
+	struct wlr_pixman_color_transform *pixman_transform =
+		wl_container_of(addon, pixman_transform, addon);
+	return pixman_transform;
+}
+
 struct wlr_pixman_render_pass *begin_pixman_render_pass(
-		struct wlr_pixman_buffer *buffer) {
+		struct wlr_pixman_buffer *buffer, struct wlr_color_transform *color_transform) {
 	struct wlr_pixman_render_pass *pass = calloc(1, sizeof(*pass));
 	if (pass == NULL) {
 		return NULL;
@@ -240,14 +489,44 @@ struct wlr_pixman_render_pass *begin_pixman_render_pass(
 
 	wlr_render_pass_init(&pass->base, &render_pass_impl);
 
+	// Blending already happens on sRGB-encoded values, so only 3D LUTs need
+	// to be applied
+	if (color_transform != NULL && color_transform->type == COLOR_TRANSFORM_LUT_3D) {
+		pass->lut_3d = get_color_transform(buffer->renderer, color_transform);
+		if (pass->lut_3d == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create color transform");
+			free(pass);
+			return NULL;
+		}
+
+		if (buffer->blend_image == NULL) {
+			buffer->blend_image = pixman_image_create_bits(PIXMAN_a8r8g8b8,
+				buffer->buffer->width, buffer->buffer->height, NULL, 0);
+			if (buffer->blend_image == NULL) {
+				wlr_log(WLR_ERROR, "Failed to create blend image");
+				free(pass);
+				return NULL;
+			}
+		}
+
+		wlr_color_transform_ref(color_transform);
+		pass->color_transform = color_transform;
+		pixman_region32_init(&pass->damage);
+	}
+
 	if (!begin_pixman_data_ptr_access(buffer->buffer, &buffer->image,
 			WLR_BUFFER_DATA_PTR_ACCESS_READ | WLR_BUFFER_DATA_PTR_ACCESS_WRITE)) {
+		if (pass->lut_3d != NULL) {
+			pixman_region32_fini(&pass->damage);
+		}
+		wlr_color_transform_unref(pass->color_transform);
 		free(pass);
 		return NULL;
 	}
 
 	wlr_buffer_lock(buffer->buffer);
 	pass->buffer = buffer;
+	pass->image = pass->lut_3d != NULL ? buffer->blend_image : buffer->image;
 
 	return pass;
 }
@@ -2,6 +2,7 @@
 #include <drm_fourcc.h>
 #include <pixman.h>
 #include <stdlib.h>
+#include <time.h>
 #include <wayland-util.h>
 #include <wlr/render/interface.h>
 #include <wlr/util/box.h>
@@ -9,8 +10,10 @@
 
 #include "render/pixman.h"
 #include "types/wlr_buffer.h"
+#include "util/time.h"
 
 static const struct wlr_renderer_impl renderer_impl;
+static const struct wlr_render_profiler_impl render_profiler_impl;
 
 bool wlr_renderer_is_pixman(struct wlr_renderer *wlr_renderer) {
 	return wlr_renderer->impl == &renderer_impl;
@@ -133,6 +136,9 @@ static void destroy_buffer(struct wlr_pixman_buffer *buffer) {
 	wl_list_remove(&buffer->buffer_destroy.link);
 
 	pixman_image_unref(buffer->image);
+	if (buffer->blend_image != NULL) {
+		pixman_image_unref(buffer->blend_image);
+	}
 
 	free(buffer);
 }
@@ -270,10 +276,27 @@ static struct wlr_texture *pixman_texture_from_buffer(
 	}
 
 	texture->buffer = wlr_buffer_lock(buffer);
+	texture->wlr_texture.references_buffer = true;
 
 	return &texture->wlr_texture;
 }
 
+static pthread_mutex_t *get_texture_lock(struct wlr_pixman_texture *texture) {
+	struct wlr_pixman_renderer *renderer = texture->renderer;
+	uintptr_t key = texture->buffer != NULL ?
+		(uintptr_t)texture->buffer : (uintptr_t)texture;
+	// Drop the low bits, which are the same for all allocations
+	return &renderer->texture_locks[(key >> 6) % WLR_PIXMAN_TEXTURE_LOCKS];
+}
+
+void pixman_texture_lock(struct wlr_pixman_texture *texture) {
+	pthread_mutex_lock(get_texture_lock(texture));
+}
+
+void pixman_texture_unlock(struct wlr_pixman_texture *texture) {
+	pthread_mutex_unlock(get_texture_lock(texture));
+}
+
 static void pixman_destroy(struct wlr_renderer *wlr_renderer) {
 	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
 
@@ -287,8 +310,18 @@ static void pixman_destroy(struct wlr_renderer *wlr_renderer) {
 		wlr_texture_destroy(&tex->wlr_texture);
 	}
 
+	struct wlr_pixman_color_transform *color_transform, *color_transform_tmp;
+	wl_list_for_each_safe(color_transform, color_transform_tmp,
+			&renderer->color_transforms, link) {
+		pixman_color_transform_destroy(&color_transform->addon);
+	}
+
 	wlr_drm_format_set_finish(&renderer->drm_formats);
 
+	for (size_t i = 0; i < WLR_PIXMAN_TEXTURE_LOCKS; i++) {
+		pthread_mutex_destroy(&renderer->texture_locks[i]);
+	}
+
 	free(renderer);
 }
 
@@ -304,19 +337,87 @@ static struct wlr_render_pass *pixman_begin_buffer_pass(struct wlr_renderer *wlr
 		return NULL;
 	}
 
-	struct wlr_pixman_render_pass *pass = begin_pixman_render_pass(buffer);
+	struct wlr_pixman_render_pass *pass = begin_pixman_render_pass(buffer,
+		options->color_transform);
 	if (pass == NULL) {
 		return NULL;
 	}
 	return &pass->base;
 }
 
+static struct wlr_pixman_render_profiler *get_render_profiler(
+		struct wlr_render_profiler *wlr_profiler) {
+	assert(wlr_profiler->impl == &render_profiler_impl);
+	struct wlr_pixman_render_profiler *profiler =
+		wl_container_of(wlr_profiler, profiler, base);
+	return profiler;
+}
+
+static struct wlr_render_profiler *pixman_render_profiler_create(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_pixman_render_profiler *profiler = calloc(1, sizeof(*profiler));
+	if (profiler == NULL) {
+		return NULL;
+	}
+	wlr_render_profiler_init(&profiler->base, &render_profiler_impl);
+	wl_array_init(&profiler->timestamps);
+	return &profiler->base;
+}
+
+static void pixman_render_profiler_write_timestamp(
+		struct wlr_render_profiler *wlr_profiler, struct wlr_render_pass *pass,
+		size_t index) {
+	struct wlr_pixman_render_profiler *profiler = get_render_profiler(wlr_profiler);
+
+	while (profiler->timestamps.size <= index * sizeof(int64_t)) {
+		int64_t *ts = wl_array_add(&profiler->timestamps, sizeof(*ts));
+		if (ts == NULL) {
+			return;
+		}
+		*ts = -1;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t *timestamps = profiler->timestamps.data;
+	timestamps[index] = timespec_to_nsec(&now);
+}
+
+static bool pixman_render_profiler_get_timestamps(
+		struct wlr_render_profiler *wlr_profiler, int64_t *timestamps, size_t len) {
+	struct wlr_pixman_render_profiler *profiler = get_render_profiler(wlr_profiler);
+
+	size_t written = profiler->timestamps.size / sizeof(int64_t);
+	const int64_t *data = profiler->timestamps.data;
+	for (size_t i = 0; i < len; i++) {
+		timestamps[i] = i < written ? data[i] : -1;
+	}
+
+	// Timestamps are recycled for the next render pass
+	profiler->timestamps.size = 0;
+	return true;
+}
+
+static void pixman_render_profiler_destroy(struct wlr_render_profiler *wlr_profiler) {
+	struct wlr_pixman_render_profiler *profiler = get_render_profiler(wlr_profiler);
+	wlr_render_profiler_finish(&profiler->base);
+	wl_array_release(&profiler->timestamps);
+	free(profiler);
+}
+
+static const struct wlr_render_profiler_impl render_profiler_impl = {
+	.write_timestamp = pixman_render_profiler_write_timestamp,
+	.get_timestamps = pixman_render_profiler_get_timestamps,
+	.destroy = pixman_render_profiler_destroy,
+};
+
 static const struct wlr_renderer_impl renderer_impl = {
 	.get_texture_formats = pixman_get_texture_formats,
 	.get_render_formats = pixman_get_render_formats,
 	.texture_from_buffer = pixman_texture_from_buffer,
 	.destroy = pixman_destroy,
 	.begin_buffer_pass = pixman_begin_buffer_pass,
+	.render_profiler_create = pixman_render_profiler_create,
 };
 
 struct wlr_renderer *wlr_pixman_renderer_create(void) {
@@ -327,9 +428,15 @@ struct wlr_renderer *wlr_pixman_renderer_create(void) {
 
 	wlr_log(WLR_INFO, "Creating pixman renderer");
 	wlr_renderer_init(&renderer->wlr_renderer, &renderer_impl, WLR_BUFFER_CAP_DATA_PTR);
-	renderer->wlr_renderer.features.output_color_transform = false;
+	renderer->wlr_renderer.features.output_color_transform = true;
+	renderer->wlr_renderer.features.concurrent_buffer_passes = true;
 	wl_list_init(&renderer->buffers);
 	wl_list_init(&renderer->textures);
+	wl_list_init(&renderer->color_transforms);
+
+	for (size_t i = 0; i < WLR_PIXMAN_TEXTURE_LOCKS; i++) {
+		pthread_mutex_init(&renderer->texture_locks[i], NULL);
+	}
 
 	size_t len = 0;
 	const uint32_t *formats = get_pixman_drm_formats(&len);
@@ -0,0 +1,238 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/render/interface.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/util/log.h>
+#include "render/wlr_renderer.h"
+#include "util/time.h"
+
+static int next_trace_tid = 1;
+
+void wlr_render_profiler_init(struct wlr_render_profiler *profiler,
+		const struct wlr_render_profiler_impl *impl) {
+	assert(impl->write_timestamp && impl->get_timestamps);
+
+	*profiler = (struct wlr_render_profiler){
+		.impl = impl,
+		.collected = true,
+		.trace_tid = next_trace_tid++,
+	};
+
+	wl_array_init(&profiler->entries);
+	wl_array_init(&profiler->labels);
+	wl_array_init(&profiler->timestamps);
+}
+
+void wlr_render_profiler_finish(struct wlr_render_profiler *profiler) {
+	if (profiler->trace_file != NULL) {
+		fflush(profiler->trace_file);
+	}
+
+	wl_array_release(&profiler->entries);
+	wl_array_release(&profiler->labels);
+	wl_array_release(&profiler->timestamps);
+}
+
+struct wlr_render_profiler *wlr_render_profiler_create(struct wlr_renderer *renderer) {
+	if (!renderer->impl->render_profiler_create) {
+		return NULL;
+	}
+	return renderer->impl->render_profiler_create(renderer);
+}
+
+void wlr_render_profiler_destroy(struct wlr_render_profiler *profiler) {
+	if (profiler == NULL) {
+		return;
+	}
+
+	if (profiler->impl->destroy) {
+		profiler->impl->destroy(profiler);
+	} else {
+		wlr_render_profiler_finish(profiler);
+		free(profiler);
+	}
+}
+
+void wlr_render_profiler_set_label(struct wlr_render_profiler *profiler,
+		const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(profiler->label, sizeof(profiler->label), fmt, args);
+	va_end(args);
+}
+
+void wlr_render_profiler_set_trace_file(struct wlr_render_profiler *profiler,
+		FILE *file) {
+	if (profiler->trace_file != NULL) {
+		fflush(profiler->trace_file);
+	}
+
+	profiler->trace_file = file;
+	if (file != NULL) {
+		// The closing bracket is optional in the JSON array format, which
+		// allows appending events until the compositor exits
+		fprintf(file, "[\n");
+	}
+}
+
+static size_t profiler_entries_len(struct wlr_render_profiler *profiler) {
+	return profiler->entries.size / sizeof(struct wlr_render_profiler_entry);
+}
+
+static const char *op_name(enum wlr_render_profiler_op op) {
+	switch (op) {
+	case WLR_RENDER_PROFILER_OP_TEXTURE:
+		return "texture";
+	case WLR_RENDER_PROFILER_OP_RECT:
+		return "rect";
+	}
+	abort();
+}
+
+static void write_json_string(FILE *f, const char *str) {
+	fputc('"', f);
+	for (const char *c = str; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(f, "\\%c", *c);
+		} else if ((unsigned char)*c < 0x20) {
+			fprintf(f, "\\u%04x", (unsigned char)*c);
+		} else {
+			fputc(*c, f);
+		}
+	}
+	fputc('"', f);
+}
+
+static void write_trace_events(struct wlr_render_profiler *profiler) {
+	FILE *f = profiler->trace_file;
+	int pid = getpid();
+	int64_t pass_start_ns = timespec_to_nsec(&profiler->pass_start);
+
+	struct wlr_render_profiler_entry *entry;
+	wl_array_for_each(entry, &profiler->entries) {
+		if (entry->duration_ns < 0) {
+			continue;
+		}
+
+		int64_t ts_ns = pass_start_ns + entry->start_ns;
+		fprintf(f, "{\"name\":");
+		write_json_string(f, entry->label[0] != '\0' ? entry->label : op_name(entry->op));
+		fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\","
+			"\"ts\":%" PRId64 ".%03" PRId64 ",\"dur\":%" PRId64 ".%03" PRId64 ","
+			"\"pid\":%d,\"tid\":%d,"
+			"\"args\":{\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d}},\n",
+			op_name(entry->op),
+			ts_ns / 1000, ts_ns % 1000,
+			entry->duration_ns / 1000, entry->duration_ns % 1000,
+			pid, profiler->trace_tid,
+			entry->box.x, entry->box.y, entry->box.width, entry->box.height);
+	}
+}
+
+bool render_profiler_collect(struct wlr_render_profiler *profiler) {
+	if (profiler->collected) {
+		return profiler->available;
+	}
+
+	size_t len = profiler_entries_len(profiler);
+	int64_t *timestamps = profiler->timestamps.data;
+	if (len > 0 && !profiler->impl->get_timestamps(profiler, timestamps, 2 * len)) {
+		return false;
+	}
+
+	profiler->collected = true;
+	profiler->available = true;
+
+	int64_t base = -1;
+	for (size_t i = 0; i < 2 * len; i += 2) {
+		if (timestamps[i] >= 0 && (base < 0 || timestamps[i] < base)) {
+			base = timestamps[i];
+		}
+	}
+
+	struct wlr_render_profiler_entry *entries = profiler->entries.data;
+	char (*labels)[WLR_RENDER_PROFILER_LABEL_SIZE] = profiler->labels.data;
+	for (size_t i = 0; i < len; i++) {
+		struct wlr_render_profiler_entry *entry = &entries[i];
+		int64_t begin = timestamps[2 * i], end = timestamps[2 * i + 1];
+
+		entry->label = labels[i];
+		if (begin >= 0 && end >= begin) {
+			entry->start_ns = begin - base;
+			entry->duration_ns = end - begin;
+		} else {
+			entry->start_ns = 0;
+			entry->duration_ns = -1;
+		}
+	}
+
+	if (profiler->trace_file != NULL) {
+		write_trace_events(profiler);
+	}
+
+	return true;
+}
+
+void render_profiler_begin_pass(struct wlr_render_profiler *profiler) {
+	profiler->entries.size = 0;
+	profiler->labels.size = 0;
+	profiler->timestamps.size = 0;
+	profiler->collected = false;
+	profiler->available = false;
+	profiler->label[0] = '\0';
+	clock_gettime(CLOCK_MONOTONIC, &profiler->pass_start);
+}
+
+bool render_profiler_begin_op(struct wlr_render_profiler *profiler,
+		struct wlr_render_pass *pass, enum wlr_render_profiler_op op,
+		const struct wlr_box *box) {
+	size_t index = profiler_entries_len(profiler);
+
+	struct wlr_render_profiler_entry *entry =
+		wl_array_add(&profiler->entries, sizeof(*entry));
+	char *label = wl_array_add(&profiler->labels, WLR_RENDER_PROFILER_LABEL_SIZE);
+	int64_t *timestamps = wl_array_add(&profiler->timestamps, 2 * sizeof(*timestamps));
+	if (entry == NULL || label == NULL || timestamps == NULL) {
+		wlr_log(WLR_ERROR, "Failed to allocate render profiler entry");
+		// Roll back to a consistent state, the arrays never shrink their
+		// allocation so this doesn't lose any data
+		profiler->entries.size = index * sizeof(*entry);
+		profiler->labels.size = index * WLR_RENDER_PROFILER_LABEL_SIZE;
+		profiler->timestamps.size = 2 * index * sizeof(*timestamps);
+		return false;
+	}
+
+	*entry = (struct wlr_render_profiler_entry){
+		.op = op,
+		.box = *box,
+		.duration_ns = -1,
+	};
+	memcpy(label, profiler->label, WLR_RENDER_PROFILER_LABEL_SIZE);
+	timestamps[0] = timestamps[1] = -1;
+
+	profiler->impl->write_timestamp(profiler, pass, 2 * index);
+	return true;
+}
+
+void render_profiler_end_op(struct wlr_render_profiler *profiler,
+		struct wlr_render_pass *pass) {
+	size_t len = profiler_entries_len(profiler);
+	assert(len > 0);
+	profiler->impl->write_timestamp(profiler, pass, 2 * (len - 1) + 1);
+}
+
+const struct wlr_render_profiler_entry *wlr_render_profiler_get_entries(
+		struct wlr_render_profiler *profiler, size_t *len) {
+	if (!render_profiler_collect(profiler)) {
+		*len = 0;
+		return NULL;
+	}
+
+	*len = profiler_entries_len(profiler);
+	return profiler->entries.data;
+}
@@ -10,6 +10,7 @@
 
 static const struct wlr_render_pass_impl render_pass_impl;
 static const struct wlr_addon_interface vk_color_transform_impl;
+static const struct wlr_render_profiler_impl render_profiler_impl;
 
 static struct wlr_vk_render_pass *get_render_pass(struct wlr_render_pass *wlr_pass) {
 	assert(wlr_pass->impl == &render_pass_impl);
@@ -430,6 +431,13 @@ static bool render_pass_submit(struct wlr_render_pass *wlr_pass) {
 
 	free(render_wait);
 
+	if (pass->base.profiler != NULL) {
+		struct wlr_vk_render_profiler *profiler =
+			wl_container_of(pass->base.profiler, profiler, base);
+		profiler->timeline_point = render_timeline_point;
+		profiler->last_timeline_point = render_timeline_point;
+	}
+
 	struct wlr_vk_shared_buffer *stage_buf, *stage_buf_tmp;
 	wl_list_for_each_safe(stage_buf, stage_buf_tmp, &renderer->stage.buffers, link) {
 		if (stage_buf->allocs.size == 0) {
@@ -924,6 +932,189 @@ static const struct wlr_addon_interface vk_color_transform_impl = {
 	.destroy = vk_color_transform_destroy,
 };
 
+static const uint32_t min_profiler_query_count = 256;
+
+static struct wlr_vk_render_profiler *get_render_profiler(
+		struct wlr_render_profiler *wlr_profiler) {
+	assert(wlr_profiler->impl == &render_profiler_impl);
+	struct wlr_vk_render_profiler *profiler = wl_container_of(wlr_profiler, profiler, base);
+	return profiler;
+}
+
+static bool render_profiler_init_query_pool(struct wlr_vk_render_profiler *profiler,
+		uint32_t query_count, struct wlr_vk_command_buffer *cb) {
+	VkDevice dev = profiler->renderer->dev->dev;
+
+	VkQueryPoolCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = query_count,
+	};
+	VkQueryPool query_pool;
+	VkResult res = vkCreateQueryPool(dev, &info, NULL, &query_pool);
+	if (res != VK_SUCCESS) {
+		wlr_vk_error("vkCreateQueryPool", res);
+		return false;
+	}
+
+	if (profiler->query_pool != VK_NULL_HANDLE) {
+		// The old pool may still be used by pending command buffers, which
+		// complete before the one being recorded
+		VkQueryPool *old = wl_array_add(&cb->destroy_query_pools, sizeof(*old));
+		if (old == NULL) {
+			vkDestroyQueryPool(dev, query_pool, NULL);
+			return false;
+		}
+		*old = profiler->query_pool;
+	}
+
+	profiler->query_pool = query_pool;
+	profiler->query_count = query_count;
+	profiler->written = 0;
+	return true;
+}
+
+struct wlr_render_profiler *vulkan_render_profiler_create(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_vk_renderer *renderer = vulkan_get_renderer(wlr_renderer);
+	if (renderer->dev->timestamp_valid_bits == 0) {
+		wlr_log(WLR_ERROR, "can't create profiler, timestamp queries not supported");
+		return NULL;
+	}
+
+	struct wlr_vk_render_profiler *profiler = calloc(1, sizeof(*profiler));
+	if (profiler == NULL) {
+		return NULL;
+	}
+	wlr_render_profiler_init(&profiler->base, &render_profiler_impl);
+	profiler->renderer = renderer;
+
+	if (!render_profiler_init_query_pool(profiler, min_profiler_query_count, NULL)) {
+		wlr_render_profiler_finish(&profiler->base);
+		free(profiler);
+		return NULL;
+	}
+
+	return &profiler->base;
+}
+
+static void render_profiler_reset(struct wlr_vk_render_profiler *profiler,
+		struct wlr_vk_command_buffer *cb) {
+	// Size the pool after the previous render pass, which is most likely
+	// similar to this one. On failure, keep using the current pool.
+	size_t prev_len = 2 * profiler->base.entries.size /
+		sizeof(struct wlr_render_profiler_entry);
+	if (prev_len > profiler->query_count) {
+		uint32_t query_count = profiler->query_count > 0 ?
+			profiler->query_count : min_profiler_query_count;
+		while (query_count < prev_len) {
+			query_count *= 2;
+		}
+		render_profiler_init_query_pool(profiler, query_count, cb);
+	}
+
+	profiler->written = 0;
+	profiler->timeline_point = 0;
+	vkCmdResetQueryPool(cb->vk, profiler->query_pool, 0, profiler->query_count);
+}
+
+static void render_profiler_write_timestamp(struct wlr_render_profiler *wlr_profiler,
+		struct wlr_render_pass *wlr_pass, size_t index) {
+	struct wlr_vk_render_profiler *profiler = get_render_profiler(wlr_profiler);
+	struct wlr_vk_render_pass *pass = get_render_pass(wlr_pass);
+
+	// Operations beyond the capacity of the pool are not timed, the pool
+	// is grown for the next render pass
+	if (index >= profiler->query_count) {
+		return;
+	}
+
+	vkCmdWriteTimestamp(pass->command_buffer->vk, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		profiler->query_pool, index);
+	if (index + 1 > profiler->written) {
+		profiler->written = index + 1;
+	}
+}
+
+static bool render_profiler_get_timestamps(struct wlr_render_profiler *wlr_profiler,
+		int64_t *timestamps, size_t len) {
+	struct wlr_vk_render_profiler *profiler = get_render_profiler(wlr_profiler);
+	struct wlr_vk_device *dev = profiler->renderer->dev;
+
+	for (size_t i = 0; i < len; i++) {
+		timestamps[i] = -1;
+	}
+
+	size_t written = profiler->written < len ? profiler->written : len;
+	if (written == 0) {
+		return true;
+	}
+
+	// Only read back results once the render pass has completed, instead
+	// of waiting for them
+	uint64_t current_point;
+	VkResult res = dev->api.vkGetSemaphoreCounterValueKHR(dev->dev,
+		profiler->renderer->timeline_semaphore, &current_point);
+	if (res != VK_SUCCESS) {
+		wlr_vk_error("vkGetSemaphoreCounterValueKHR", res);
+		return true;
+	}
+	if (profiler->timeline_point == 0) {
+		// The render pass was never submitted
+		return true;
+	} else if (current_point < profiler->timeline_point) {
+		return false;
+	}
+
+	uint64_t values[written];
+	res = vkGetQueryPoolResults(dev->dev, profiler->query_pool, 0, written,
+		sizeof(values), values, sizeof(values[0]), VK_QUERY_RESULT_64_BIT);
+	if (res == VK_NOT_READY) {
+		return false;
+	} else if (res != VK_SUCCESS) {
+		wlr_vk_error("vkGetQueryPoolResults", res);
+		return true;
+	}
+
+	uint64_t mask = dev->timestamp_valid_bits >= 64 ?
+		UINT64_MAX : (UINT64_C(1) << dev->timestamp_valid_bits) - 1;
+	for (size_t i = 0; i < written; i++) {
+		timestamps[i] = (int64_t)((double)(values[i] & mask) * dev->timestamp_period);
+	}
+
+	return true;
+}
+
+static void render_profiler_destroy(struct wlr_render_profiler *wlr_profiler) {
+	struct wlr_vk_render_profiler *profiler = get_render_profiler(wlr_profiler);
+	VkDevice dev = profiler->renderer->dev->dev;
+
+	if (profiler->last_timeline_point > 0) {
+		// Only wait for the last render pass using the pool
+		VkSemaphoreWaitInfoKHR wait_info = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+			.semaphoreCount = 1,
+			.pSemaphores = &profiler->renderer->timeline_semaphore,
+			.pValues = &profiler->last_timeline_point,
+		};
+		VkResult res = profiler->renderer->dev->api.vkWaitSemaphoresKHR(dev,
+			&wait_info, UINT64_MAX);
+		if (res != VK_SUCCESS) {
+			wlr_vk_error("vkWaitSemaphoresKHR", res);
+		}
+	}
+	vkDestroyQueryPool(dev, profiler->query_pool, NULL);
+
+	wlr_render_profiler_finish(&profiler->base);
+	free(profiler);
+}
+
+static const struct wlr_render_profiler_impl render_profiler_impl = {
+	.write_timestamp = render_profiler_write_timestamp,
+	.get_timestamps = render_profiler_get_timestamps,
+	.destroy = render_profiler_destroy,
+};
+
 struct wlr_vk_render_pass *vulkan_begin_render_pass(struct wlr_vk_renderer *renderer,
 		struct wlr_vk_render_buffer *buffer, const struct wlr_buffer_pass_options *options) {
 	bool using_srgb_pathway;
@@ -991,6 +1182,11 @@ struct wlr_vk_render_pass *vulkan_begin_render_pass(struct wlr_vk_renderer *rend
 			VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_ACCESS_SHADER_READ_BIT);
 	}
 
+	// Queries must be reset outside of the render pass instance
+	if (options != NULL && options->profiler != NULL) {
+		render_profiler_reset(get_render_profiler(options->profiler), cb);
+	}
+
 	int width = buffer->wlr_buffer->width;
 	int height = buffer->wlr_buffer->height;
 	VkRect2D rect = { .extent = { width, height } };
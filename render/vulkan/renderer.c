@@ -4,6 +4,7 @@
 #include <poll.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <drm_fourcc.h>
@@ -430,6 +431,7 @@ static bool init_command_buffer(struct wlr_vk_command_buffer *cb,
 	};
 	wl_list_init(&cb->destroy_textures);
 	wl_list_init(&cb->stage_buffers);
+	wl_array_init(&cb->destroy_query_pools);
 	return true;
 }
 
@@ -475,6 +477,12 @@ static void release_command_buffer_resources(struct wlr_vk_command_buffer *cb,
 		wlr_color_transform_unref(cb->color_transform);
 		cb->color_transform = NULL;
 	}
+
+	VkQueryPool *query_pool;
+	wl_array_for_each(query_pool, &cb->destroy_query_pools) {
+		vkDestroyQueryPool(renderer->dev->dev, *query_pool, NULL);
+	}
+	cb->destroy_query_pools.size = 0;
 }
 
 static struct wlr_vk_command_buffer *get_command_buffer(
@@ -1070,6 +1078,7 @@ static void vulkan_destroy(struct wlr_renderer *wlr_renderer) {
 			continue;
 		}
 		release_command_buffer_resources(cb, renderer);
+		wl_array_release(&cb->destroy_query_pools);
 		if (cb->binary_semaphore != VK_NULL_HANDLE) {
 			vkDestroySemaphore(renderer->dev->dev, cb->binary_semaphore, NULL);
 		}
@@ -1134,6 +1143,7 @@ static void vulkan_destroy(struct wlr_renderer *wlr_renderer) {
 	vkFreeMemory(dev->dev, renderer->dummy3d_mem, NULL);
 
 	vkDestroySemaphore(dev->dev, renderer->timeline_semaphore, NULL);
+	vkDestroyPipelineCache(dev->dev, renderer->pipeline_cache, NULL);
 	vkDestroyPipelineLayout(dev->dev, renderer->output_pipe_layout, NULL);
 	vkDestroyDescriptorSetLayout(dev->dev, renderer->output_ds_srgb_layout, NULL);
 	vkDestroyDescriptorSetLayout(dev->dev, renderer->output_ds_lut3d_layout, NULL);
@@ -1416,6 +1426,7 @@ static const struct wlr_renderer_impl renderer_impl = {
 	.get_drm_fd = vulkan_get_drm_fd,
 	.texture_from_buffer = vulkan_texture_from_buffer,
 	.begin_buffer_pass = vulkan_begin_buffer_pass,
+	.render_profiler_create = vulkan_render_profiler_create,
 };
 
 // Initializes the VkDescriptorSetLayout and VkPipelineLayout needed
@@ -1766,8 +1777,8 @@ struct wlr_vk_pipeline *setup_get_or_create_pipeline(
 		.pVertexInputState = &vertex,
 	};
 
-	VkPipelineCache cache = VK_NULL_HANDLE;
-	res = vkCreateGraphicsPipelines(dev, cache, 1, &pinfo, NULL, &pipeline->vk);
+	res = vkCreateGraphicsPipelines(dev, renderer->pipeline_cache, 1, &pinfo,
+		NULL, &pipeline->vk);
 	if (res != VK_SUCCESS) {
 		wlr_vk_error("failed to create vulkan pipelines:", res);
 		free(pipeline);
@@ -1883,8 +1894,8 @@ static bool init_blend_to_output_pipeline(struct wlr_vk_renderer *renderer,
 		.pVertexInputState = &vertex,
 	};
 
-	VkPipelineCache cache = VK_NULL_HANDLE;
-	res = vkCreateGraphicsPipelines(dev, cache, 1, &pinfo, NULL, pipe);
+	res = vkCreateGraphicsPipelines(dev, renderer->pipeline_cache, 1, &pinfo,
+		NULL, pipe);
 	if (res != VK_SUCCESS) {
 		wlr_vk_error("failed to create vulkan pipelines:", res);
 		return false;
@@ -2423,6 +2434,16 @@ struct wlr_renderer *vulkan_renderer_create_for_device(struct wlr_vk_device *dev
 	wl_list_init(&renderer->color_transforms);
 	wl_list_init(&renderer->pipeline_layouts);
 
+	VkPipelineCacheCreateInfo cache_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+	};
+	res = vkCreatePipelineCache(dev->dev, &cache_info, NULL,
+		&renderer->pipeline_cache);
+	if (res != VK_SUCCESS) {
+		wlr_vk_error("vkCreatePipelineCache", res);
+		goto error;
+	}
+
 	if (!init_static_render_data(renderer)) {
 		goto error;
 	}
@@ -2519,3 +2540,89 @@ uint32_t wlr_vk_renderer_get_queue_family(struct wlr_renderer *renderer) {
 	struct wlr_vk_renderer *vk_renderer = vulkan_get_renderer(renderer);
 	return vk_renderer->dev->queue_family;
 }
+
+static bool pipeline_cache_header_is_compatible(struct wlr_vk_renderer *renderer,
+		const void *data, size_t size) {
+	VkPipelineCacheHeaderVersionOne header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer->dev->phdev, &props);
+
+	return header.headerSize >= sizeof(header) &&
+		header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header.vendorID == props.vendorID &&
+		header.deviceID == props.deviceID &&
+		memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID,
+			VK_UUID_SIZE) == 0;
+}
+
+bool wlr_vk_renderer_load_pipeline_cache(struct wlr_renderer *wlr_renderer,
+		const void *data, size_t size) {
+	struct wlr_vk_renderer *renderer = vulkan_get_renderer(wlr_renderer);
+	VkDevice dev = renderer->dev->dev;
+
+	// Implementations are supposed to ignore incompatible data, but some
+	// drivers have been known to crash on it, so check the header ourselves
+	if (!pipeline_cache_header_is_compatible(renderer, data, size)) {
+		wlr_log(WLR_DEBUG, "Ignoring incompatible Vulkan pipeline cache");
+		return false;
+	}
+
+	VkPipelineCacheCreateInfo cache_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = size,
+		.pInitialData = data,
+	};
+	VkPipelineCache src_cache;
+	VkResult res = vkCreatePipelineCache(dev, &cache_info, NULL, &src_cache);
+	if (res != VK_SUCCESS) {
+		wlr_vk_error("vkCreatePipelineCache", res);
+		return false;
+	}
+
+	// Pipelines are created lazily, so the renderer cache may already hold
+	// some of them: merge instead of replacing it
+	res = vkMergePipelineCaches(dev, renderer->pipeline_cache, 1, &src_cache);
+	vkDestroyPipelineCache(dev, src_cache, NULL);
+	if (res != VK_SUCCESS) {
+		wlr_vk_error("vkMergePipelineCaches", res);
+		return false;
+	}
+
+	return true;
+}
+
+void *wlr_vk_renderer_get_pipeline_cache_data(struct wlr_renderer *wlr_renderer,
+		size_t *size) {
+	struct wlr_vk_renderer *renderer = vulkan_get_renderer(wlr_renderer);
+	VkDevice dev = renderer->dev->dev;
+
+	size_t data_size = 0;
+	VkResult res = vkGetPipelineCacheData(dev, renderer->pipeline_cache,
+		&data_size, NULL);
+	if (res != VK_SUCCESS) {
+		wlr_vk_error("vkGetPipelineCacheData", res);
+		return NULL;
+	}
+
+	void *data = malloc(data_size);
+	if (data == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	// VK_INCOMPLETE still returns a valid, truncated cache
+	res = vkGetPipelineCacheData(dev, renderer->pipeline_cache, &data_size, data);
+	if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+		wlr_vk_error("vkGetPipelineCacheData", res);
+		free(data);
+		return NULL;
+	}
+
+	*size = data_size;
+	return data;
+}
@@ -795,6 +795,7 @@ static struct wlr_texture *vulkan_texture_from_dmabuf_buffer(
 	}
 
 	texture->buffer = wlr_buffer_lock(buffer);
+	texture->wlr_texture.references_buffer = true;
 	wlr_addon_init(&texture->buffer_addon, &buffer->addons, renderer,
 		&buffer_addon_impl);
 
@@ -491,12 +491,20 @@ struct wlr_vk_device *vulkan_device_create(struct wlr_vk_instance *ini,
 			graphics_found = queue_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT;
 			if (graphics_found) {
 				dev->queue_family = i;
+				dev->timestamp_valid_bits = queue_props[i].timestampValidBits;
 				break;
 			}
 		}
 		assert(graphics_found);
 	}
 
+	VkPhysicalDeviceProperties phdev_props;
+	vkGetPhysicalDeviceProperties(phdev, &phdev_props);
+	dev->timestamp_period = phdev_props.limits.timestampPeriod;
+	if (dev->timestamp_valid_bits == 0) {
+		wlr_log(WLR_DEBUG, "Queue family doesn't support timestamp queries");
+	}
+
 	const VkPhysicalDeviceExternalSemaphoreInfo ext_semaphore_info = {
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO,
 		.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
@@ -301,7 +301,20 @@ struct wlr_render_pass *wlr_renderer_begin_buffer_pass(struct wlr_renderer *rend
 		options = &default_options;
 	}
 
-	return renderer->impl->begin_buffer_pass(renderer, buffer, options);
+	struct wlr_render_profiler *profiler = options->profiler;
+	if (profiler != NULL) {
+		// Collect the previous results before the renderer recycles its
+		// queries
+		render_profiler_collect(profiler);
+	}
+
+	struct wlr_render_pass *pass =
+		renderer->impl->begin_buffer_pass(renderer, buffer, options);
+	if (pass != NULL && profiler != NULL) {
+		pass->profiler = profiler;
+		render_profiler_begin_pass(profiler);
+	}
+	return pass;
 }
 
 struct wlr_render_timer *wlr_render_timer_create(struct wlr_renderer *renderer) {
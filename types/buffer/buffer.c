@@ -128,3 +128,68 @@ bool buffer_is_opaque(struct wlr_buffer *buffer) {
 
 	return !pixel_format_has_alpha(format);
 }
+
+static bool read_single_pixel_color(struct wlr_buffer *buffer, float color[static 4]) {
+	if (buffer->width != 1 || buffer->height != 1) {
+		return false;
+	}
+
+	void *data;
+	uint32_t format;
+	size_t stride;
+	if (!wlr_buffer_begin_data_ptr_access(buffer,
+			WLR_BUFFER_DATA_PTR_ACCESS_READ, &data, &format, &stride)) {
+		return false;
+	}
+
+	// Little-endian byte order
+	const uint8_t *pixel = data;
+	uint8_t r, g, b, a;
+	bool ok = true;
+	switch (format) {
+	case DRM_FORMAT_ARGB8888:
+	case DRM_FORMAT_XRGB8888:
+		b = pixel[0];
+		g = pixel[1];
+		r = pixel[2];
+		a = format == DRM_FORMAT_ARGB8888 ? pixel[3] : 0xFF;
+		break;
+	case DRM_FORMAT_ABGR8888:
+	case DRM_FORMAT_XBGR8888:
+		r = pixel[0];
+		g = pixel[1];
+		b = pixel[2];
+		a = format == DRM_FORMAT_ABGR8888 ? pixel[3] : 0xFF;
+		break;
+	default:
+		ok = false;
+		break;
+	}
+
+	wlr_buffer_end_data_ptr_access(buffer);
+	if (!ok) {
+		return false;
+	}
+
+	color[0] = r / 255.f;
+	color[1] = g / 255.f;
+	color[2] = b / 255.f;
+	color[3] = a / 255.f;
+	return true;
+}
+
+bool buffer_get_single_pixel_color(struct wlr_buffer *buffer, float color[static 4]) {
+	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(buffer);
+	if (client_buffer != NULL) {
+		// The source may have been released to the client, use the color
+		// read when the texture was last updated
+		if (!client_buffer->is_single_pixel) {
+			return false;
+		}
+		memcpy(color, client_buffer->single_pixel_color,
+			sizeof(client_buffer->single_pixel_color));
+		return true;
+	}
+
+	return read_single_pixel_color(buffer, color);
+}
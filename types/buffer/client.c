@@ -41,9 +41,52 @@ static bool client_buffer_get_dmabuf(struct wlr_buffer *buffer,
 	return wlr_buffer_get_dmabuf(client_buffer->source, attribs);
 }
 
+/**
+ * Renderers copy wl_shm buffers into their textures or wrap them without
+ * copying. In the latter case, the texture keeps the source locked, so the
+ * client can't modify it while the client buffer is in use and the source can
+ * be used directly, e.g. for direct scan-out.
+ */
+static bool client_buffer_source_is_stable(struct wlr_client_buffer *client_buffer) {
+	return client_buffer->source != NULL && client_buffer->texture != NULL &&
+		client_buffer->texture->references_buffer;
+}
+
+static bool client_buffer_get_shm(struct wlr_buffer *buffer,
+		struct wlr_shm_attributes *attribs) {
+	struct wlr_client_buffer *client_buffer = client_buffer_from_buffer(buffer);
+
+	if (!client_buffer_source_is_stable(client_buffer)) {
+		return false;
+	}
+
+	return wlr_buffer_get_shm(client_buffer->source, attribs);
+}
+
+static bool client_buffer_begin_data_ptr_access(struct wlr_buffer *buffer,
+		uint32_t flags, void **data, uint32_t *format, size_t *stride) {
+	struct wlr_client_buffer *client_buffer = client_buffer_from_buffer(buffer);
+
+	if (!client_buffer_source_is_stable(client_buffer) ||
+			(flags & WLR_BUFFER_DATA_PTR_ACCESS_WRITE)) {
+		return false;
+	}
+
+	return wlr_buffer_begin_data_ptr_access(client_buffer->source, flags,
+		data, format, stride);
+}
+
+static void client_buffer_end_data_ptr_access(struct wlr_buffer *buffer) {
+	struct wlr_client_buffer *client_buffer = client_buffer_from_buffer(buffer);
+	wlr_buffer_end_data_ptr_access(client_buffer->source);
+}
+
 static const struct wlr_buffer_impl client_buffer_impl = {
 	.destroy = client_buffer_destroy,
 	.get_dmabuf = client_buffer_get_dmabuf,
+	.get_shm = client_buffer_get_shm,
+	.begin_data_ptr_access = client_buffer_begin_data_ptr_access,
+	.end_data_ptr_access = client_buffer_end_data_ptr_access,
 };
 
 static void client_buffer_handle_source_destroy(struct wl_listener *listener,
@@ -81,6 +124,8 @@ struct wlr_client_buffer *wlr_client_buffer_create(struct wlr_buffer *buffer,
 		texture->width, texture->height);
 	client_buffer->source = buffer;
 	client_buffer->texture = texture;
+	client_buffer->is_single_pixel = buffer_get_single_pixel_color(buffer,
+		client_buffer->single_pixel_color);
 
 	wl_signal_add(&buffer->events.destroy, &client_buffer->source_destroy);
 	client_buffer->source_destroy.notify = client_buffer_handle_source_destroy;
@@ -105,5 +150,11 @@ bool wlr_client_buffer_apply_damage(struct wlr_client_buffer *client_buffer,
 		return false;
 	}
 
-	return wlr_texture_update_from_buffer(client_buffer->texture, next, damage);
+	if (!wlr_texture_update_from_buffer(client_buffer->texture, next, damage)) {
+		return false;
+	}
+
+	client_buffer->is_single_pixel = buffer_get_single_pixel_color(next,
+		client_buffer->single_pixel_color);
+	return true;
 }
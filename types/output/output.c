@@ -11,6 +11,7 @@
 #include "types/wlr_output.h"
 #include "util/env.h"
 #include "util/global.h"
+#include "util/time.h"
 
 #define OUTPUT_VERSION 4
 
@@ -836,6 +837,40 @@ void output_defer_present(struct wlr_output *output, struct wlr_output_event_pre
 		deferred_present_event_handle_idle, deferred);
 }
 
+void output_update_vblank_timings(struct wlr_output *output,
+		const struct wlr_output_event_present *event,
+		struct timespec *last_present, int64_t *refresh_ns) {
+	assert(event->presented);
+
+	*last_present = *event->when;
+	if (event->refresh > 0) {
+		*refresh_ns = event->refresh;
+	} else if (output->refresh > 0) {
+		*refresh_ns = 1000000000000LL / output->refresh;
+	} else {
+		*refresh_ns = 0;
+	}
+}
+
+int64_t output_predict_vblank(const struct timespec *last_present,
+		int64_t refresh_ns, int64_t now_ns, int64_t budget_ns) {
+	assert(refresh_ns > 0);
+
+	int64_t last_ns = timespec_to_nsec(last_present);
+	int64_t vblank_ns = last_ns + refresh_ns;
+	int64_t elapsed_ns = now_ns + budget_ns - last_ns;
+	if (elapsed_ns >= 0) {
+		vblank_ns += elapsed_ns / refresh_ns * refresh_ns;
+	}
+	return vblank_ns;
+}
+
+int output_deadline_delay_ms(int64_t deadline_ns, int64_t now_ns) {
+	// Event loop timers have a millisecond granularity, round down so that
+	// the deadline isn't missed
+	return (deadline_ns - now_ns) / 1000000;
+}
+
 void wlr_output_send_request_state(struct wlr_output *output,
 		const struct wlr_output_state *state) {
 	uint32_t unchanged = output_compare_state(output, state);
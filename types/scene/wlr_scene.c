@@ -1,7 +1,11 @@
 #include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wlr/backend.h>
+#include <wlr/render/color.h>
 #include <wlr/render/swapchain.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_compositor.h>
@@ -85,6 +89,7 @@ static void scene_buffer_set_buffer(struct wlr_scene_buffer *scene_buffer,
 	struct wlr_buffer *buffer);
 static void scene_buffer_set_texture(struct wlr_scene_buffer *scene_buffer,
 	struct wlr_texture *texture);
+static void scene_render_workers_destroy(struct wlr_scene_render_workers *workers);
 
 void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 	if (node == NULL) {
@@ -128,6 +133,7 @@ void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 			}
 
 			wl_list_remove(&scene->linux_dmabuf_v1_destroy.link);
+			scene_render_workers_destroy(scene->render_workers);
 		} else {
 			assert(node->parent);
 		}
@@ -302,6 +308,7 @@ struct render_data {
 	struct wlr_scene_output *output;
 
 	struct wlr_render_pass *render_pass;
+	struct wlr_render_profiler *profiler; // may be NULL
 	pixman_region32_t damage;
 };
 
@@ -626,6 +633,7 @@ static void scene_buffer_set_buffer(struct wlr_scene_buffer *scene_buffer,
 	scene_buffer->own_buffer = false;
 	scene_buffer->buffer_width = scene_buffer->buffer_height = 0;
 	scene_buffer->buffer_is_opaque = false;
+	scene_buffer->is_single_pixel_buffer = false;
 
 	if (!buffer) {
 		return;
@@ -637,6 +645,13 @@ static void scene_buffer_set_buffer(struct wlr_scene_buffer *scene_buffer,
 	scene_buffer->buffer_height = buffer->height;
 	scene_buffer->buffer_is_opaque = buffer_is_opaque(buffer);
 
+	// Single-pixel buffers are drawn as solid rectangles
+	scene_buffer->is_single_pixel_buffer = buffer_get_single_pixel_color(buffer,
+		scene_buffer->single_pixel_buffer_color);
+	if (scene_buffer->is_single_pixel_buffer) {
+		scene_buffer->buffer_is_opaque = scene_buffer->single_pixel_buffer_color[3] == 1;
+	}
+
 	scene_buffer->buffer_release.notify = scene_buffer_handle_buffer_release;
 	wl_signal_add(&buffer->events.release, &scene_buffer->buffer_release);
 }
@@ -1164,11 +1179,42 @@ struct wlr_scene_node *wlr_scene_node_at(struct wlr_scene_node *node,
 
 struct render_list_entry {
 	struct wlr_scene_node *node;
+	struct wlr_texture *texture; // for buffer nodes, resolved before rendering
 	bool sent_dmabuf_feedback;
 	bool highlight_transparent_region;
+	bool rendered;
 	int x, y;
 };
 
+static void scene_node_set_profiler_label(struct wlr_scene_node *node,
+		struct wlr_render_profiler *profiler) {
+	switch (node->type) {
+	case WLR_SCENE_NODE_TREE:
+		assert(false);
+		break;
+	case WLR_SCENE_NODE_RECT:
+		wlr_render_profiler_set_label(profiler, "wlr_scene_rect %p", (void *)node);
+		break;
+	case WLR_SCENE_NODE_BUFFER:;
+		struct wlr_scene_buffer *scene_buffer = wlr_scene_buffer_from_node(node);
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_try_from_buffer(scene_buffer);
+		if (scene_surface == NULL) {
+			wlr_render_profiler_set_label(profiler, "wlr_scene_buffer %p", (void *)node);
+			break;
+		}
+
+		// Attribute the surface to its client so that expensive clients can
+		// be told apart in the profile
+		struct wl_resource *resource = scene_surface->surface->resource;
+		pid_t pid = 0;
+		wl_client_get_credentials(wl_resource_get_client(resource), &pid, NULL, NULL);
+		wlr_render_profiler_set_label(profiler, "wl_surface#%" PRIu32 " (pid %d)",
+			wl_resource_get_id(resource), (int)pid);
+		break;
+	}
+}
+
 static void scene_entry_render(struct render_list_entry *entry, const struct render_data *data) {
 	struct wlr_scene_node *node = entry->node;
 
@@ -1202,6 +1248,10 @@ static void scene_entry_render(struct render_list_entry *entry, const struct ren
 	transform_output_box(&dst_box, data);
 	transform_output_damage(&render_region, data);
 
+	if (data->profiler != NULL) {
+		scene_node_set_profiler_label(node, data->profiler);
+	}
+
 	switch (node->type) {
 	case WLR_SCENE_NODE_TREE:
 		assert(false);
@@ -1223,8 +1273,26 @@ static void scene_entry_render(struct render_list_entry *entry, const struct ren
 	case WLR_SCENE_NODE_BUFFER:;
 		struct wlr_scene_buffer *scene_buffer = wlr_scene_buffer_from_node(node);
 
-		struct wlr_texture *texture = scene_buffer_get_texture(scene_buffer,
-			data->output->output->renderer);
+		if (scene_buffer->is_single_pixel_buffer) {
+			const float *color = scene_buffer->single_pixel_buffer_color;
+			float alpha = scene_buffer->opacity;
+			wlr_render_pass_add_rect(data->render_pass, &(struct wlr_render_rect_options){
+				.box = dst_box,
+				.color = {
+					.r = color[0] * alpha,
+					.g = color[1] * alpha,
+					.b = color[2] * alpha,
+					.a = color[3] * alpha,
+				},
+				.clip = &render_region,
+				.blend_mode = pixman_region32_not_empty(&opaque) ?
+					WLR_RENDER_BLEND_MODE_PREMULTIPLIED : WLR_RENDER_BLEND_MODE_NONE,
+			});
+			entry->rendered = true;
+			break;
+		}
+
+		struct wlr_texture *texture = entry->texture;
 		if (texture == NULL) {
 			wlr_damage_ring_add(&data->output->damage_ring, &render_region);
 			break;
@@ -1245,12 +1313,7 @@ static void scene_entry_render(struct render_list_entry *entry, const struct ren
 			.blend_mode = pixman_region32_not_empty(&opaque) ?
 				WLR_RENDER_BLEND_MODE_PREMULTIPLIED : WLR_RENDER_BLEND_MODE_NONE,
 		});
-
-		struct wlr_scene_output_sample_event sample_event = {
-			.output = data->output,
-			.direct_scanout = false,
-		};
-		wl_signal_emit_mutable(&scene_buffer->events.output_sample, &sample_event);
+		entry->rendered = true;
 
 		if (entry->highlight_transparent_region) {
 			wlr_render_pass_add_rect(data->render_pass, &(struct wlr_render_rect_options){
@@ -1455,6 +1518,9 @@ void wlr_scene_output_destroy(struct wlr_scene_output *scene_output) {
 	wl_list_remove(&scene_output->output_damage.link);
 	wl_list_remove(&scene_output->output_needs_frame.link);
 
+	wlr_buffer_unlock(scene_output->last_buffer);
+	wlr_color_transform_unref(scene_output->last_color_transform);
+
 	wl_array_release(&scene_output->render_list);
 	free(scene_output);
 }
@@ -1710,8 +1776,76 @@ out:
 	return ok;
 }
 
-bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
-		struct wlr_output_state *state, const struct wlr_scene_output_state_options *options) {
+/**
+ * Rendering an output is split in three steps: the render pass is set up
+ * from the event loop thread, the render pass is then recorded and submitted
+ * (possibly from another thread), and finally the result is applied to the
+ * output state from the event loop thread again.
+ *
+ * Recording doesn't modify the scene graph or emit any signal, and only
+ * touches state owned by the scene output.
+ */
+struct scene_output_render {
+	struct render_data data;
+	struct wlr_output_state *state;
+	struct wlr_buffer *buffer;
+	struct timespec now;
+	struct wlr_color_transform *color_transform;
+	bool cacheable;
+	bool submitted;
+
+	struct wl_list worker_link; // wlr_scene_render_workers.queue
+};
+
+enum scene_output_render_status {
+	SCENE_OUTPUT_RENDER_ERROR,
+	SCENE_OUTPUT_RENDER_DONE,
+	SCENE_OUTPUT_RENDER_PENDING,
+};
+
+static void scene_output_set_last_buffer(struct wlr_scene_output *scene_output,
+		struct wlr_buffer *buffer, struct wlr_color_transform *color_transform) {
+	wlr_buffer_unlock(scene_output->last_buffer);
+	scene_output->last_buffer = buffer != NULL ? wlr_buffer_lock(buffer) : NULL;
+
+	if (color_transform != NULL) {
+		wlr_color_transform_ref(color_transform);
+	}
+	wlr_color_transform_unref(scene_output->last_color_transform);
+	scene_output->last_color_transform = color_transform;
+}
+
+/**
+ * The damage ring accumulates all changes to the scene affecting the output
+ * since the last render. If it's empty, the last rendered buffer can be
+ * committed again as long as the output state doesn't invalidate it.
+ */
+static bool scene_output_can_reuse_last_buffer(struct wlr_scene_output *scene_output,
+		const struct wlr_output_state *state,
+		const struct wlr_scene_output_state_options *options,
+		int resolution_width, int resolution_height) {
+	struct wlr_buffer *buffer = scene_output->last_buffer;
+	if (buffer == NULL) {
+		return false;
+	}
+
+	if (state->committed & (WLR_OUTPUT_STATE_MODE |
+			WLR_OUTPUT_STATE_ENABLED |
+			WLR_OUTPUT_STATE_RENDER_FORMAT)) {
+		return false;
+	}
+
+	return options->swapchain == NULL &&
+		options->color_transform == scene_output->last_color_transform &&
+		scene_output->scene->debug_damage_option == WLR_SCENE_DEBUG_DAMAGE_NONE &&
+		buffer->width == resolution_width && buffer->height == resolution_height &&
+		!pixman_region32_not_empty(&scene_output->damage_ring.current);
+}
+
+static enum scene_output_render_status scene_output_render_begin(
+		struct scene_output_render *render, struct wlr_scene_output *scene_output,
+		struct wlr_output_state *state,
+		const struct wlr_scene_output_state_options *options) {
 	struct wlr_scene_output_state_options default_options = {0};
 	if (!options) {
 		options = &default_options;
@@ -1726,50 +1860,78 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 
 	if ((state->committed & WLR_OUTPUT_STATE_ENABLED) && !state->enabled) {
 		// if the state is being disabled, do nothing.
-		return true;
+		scene_output_set_last_buffer(scene_output, NULL, NULL);
+		return SCENE_OUTPUT_RENDER_DONE;
 	}
 
 	struct wlr_output *output = scene_output->output;
 	enum wlr_scene_debug_damage_option debug_damage =
 		scene_output->scene->debug_damage_option;
 
-	struct render_data render_data = {
-		.transform = output->transform,
-		.scale = output->scale,
-		.logical = { .x = scene_output->x, .y = scene_output->y },
-		.output = scene_output,
+	*render = (struct scene_output_render){
+		.data = {
+			.transform = output->transform,
+			.scale = output->scale,
+			.logical = { .x = scene_output->x, .y = scene_output->y },
+			.output = scene_output,
+		},
+		.state = state,
 	};
+	struct render_data *render_data = &render->data;
 
 	int resolution_width, resolution_height;
 	output_pending_resolution(output, state,
 		&resolution_width, &resolution_height);
 
 	if (state->committed & WLR_OUTPUT_STATE_TRANSFORM) {
-		if (render_data.transform != state->transform) {
+		if (render_data->transform != state->transform) {
 			wlr_damage_ring_add_whole(&scene_output->damage_ring);
 		}
 
-		render_data.transform = state->transform;
+		render_data->transform = state->transform;
 	}
 
 	if (state->committed & WLR_OUTPUT_STATE_SCALE) {
-		if (render_data.scale != state->scale) {
+		if (render_data->scale != state->scale) {
 			wlr_damage_ring_add_whole(&scene_output->damage_ring);
 		}
 
-		render_data.scale = state->scale;
+		render_data->scale = state->scale;
 	}
 
-	render_data.trans_width = resolution_width;
-	render_data.trans_height = resolution_height;
-	wlr_output_transform_coords(render_data.transform,
-		&render_data.trans_width, &render_data.trans_height);
+	render_data->trans_width = resolution_width;
+	render_data->trans_height = resolution_height;
+	wlr_output_transform_coords(render_data->transform,
+		&render_data->trans_width, &render_data->trans_height);
+
+	render_data->logical.width = render_data->trans_width / render_data->scale;
+	render_data->logical.height = render_data->trans_height / render_data->scale;
+
+	wlr_damage_ring_set_bounds(&scene_output->damage_ring,
+		render_data->trans_width, render_data->trans_height);
+
+	if (debug_damage == WLR_SCENE_DEBUG_DAMAGE_RERENDER) {
+		wlr_damage_ring_add_whole(&scene_output->damage_ring);
+	}
 
-	render_data.logical.width = render_data.trans_width / render_data.scale;
-	render_data.logical.height = render_data.trans_height / render_data.scale;
+	// Nothing changed since the last frame, e.g. when the output is
+	// re-committed for a gamma change or a screen capture
+	if (scene_output_can_reuse_last_buffer(scene_output, state, options,
+			resolution_width, resolution_height)) {
+		output_state_apply_damage(render_data, state);
+		wlr_output_state_set_buffer(state, scene_output->last_buffer);
+
+		if (timer) {
+			struct timespec end_time, duration;
+			clock_gettime(CLOCK_MONOTONIC, &end_time);
+			timespec_sub(&duration, &end_time, &start_time);
+			timer->pre_render_duration = timespec_to_nsec(&duration);
+		}
+		return SCENE_OUTPUT_RENDER_DONE;
+	}
 
 	struct render_list_constructor_data list_con = {
-		.box = render_data.logical,
+		.box = render_data->logical,
 		.render_list = &scene_output->render_list,
 		.calculate_visibility = scene_output->scene->calculate_visibility,
 		.highlight_transparent_region = scene_output->scene->highlight_transparent_region,
@@ -1783,17 +1945,9 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	struct render_list_entry *list_data = list_con.render_list->data;
 	int list_len = list_con.render_list->size / sizeof(*list_data);
 
-	wlr_damage_ring_set_bounds(&scene_output->damage_ring,
-		render_data.trans_width, render_data.trans_height);
-
-	if (debug_damage == WLR_SCENE_DEBUG_DAMAGE_RERENDER) {
-		wlr_damage_ring_add_whole(&scene_output->damage_ring);
-	}
-
-	struct timespec now;
 	if (debug_damage == WLR_SCENE_DEBUG_DAMAGE_HIGHLIGHT) {
 		struct wl_list *regions = &scene_output->damage_highlight_regions;
-		clock_gettime(CLOCK_MONOTONIC, &now);
+		clock_gettime(CLOCK_MONOTONIC, &render->now);
 
 		// add the current frame's damage if there is damage
 		if (pixman_region32_not_empty(&scene_output->damage_ring.current)) {
@@ -1802,7 +1956,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 				pixman_region32_init(&current_damage->region);
 				pixman_region32_copy(&current_damage->region,
 					&scene_output->damage_ring.current);
-				current_damage->when = now;
+				current_damage->when = render->now;
 				wl_list_insert(regions, &current_damage->link);
 			}
 		}
@@ -1817,7 +1971,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 
 			// if this damage is too old or has nothing in it, get rid of it
 			struct timespec time_diff;
-			timespec_sub(&time_diff, &now, &damage->when);
+			timespec_sub(&time_diff, &render->now, &damage->when);
 			if (timespec_to_msec(&time_diff) >= HIGHLIGHT_DAMAGE_FADEOUT_TIME ||
 					!pixman_region32_not_empty(&damage->region)) {
 				highlight_region_destroy(damage);
@@ -1828,7 +1982,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 		pixman_region32_fini(&acc_damage);
 	}
 
-	output_state_apply_damage(&render_data, state);
+	output_state_apply_damage(render_data, state);
 
 	// We only want to try direct scanout if:
 	// - There is only one entry in the render list
@@ -1836,7 +1990,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	// - Damage highlight debugging is not enabled
 	bool scanout = options->color_transform == NULL &&
 		list_len == 1 && debug_damage != WLR_SCENE_DEBUG_DAMAGE_HIGHLIGHT &&
-		scene_entry_try_direct_scanout(&list_data[0], state, &render_data);
+		scene_entry_try_direct_scanout(&list_data[0], state, render_data);
 
 	if (scene_output->prev_scanout != scanout) {
 		scene_output->prev_scanout = scanout;
@@ -1845,19 +1999,21 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	}
 
 	if (scanout) {
+		scene_output_set_last_buffer(scene_output, NULL, NULL);
+
 		if (timer) {
 			struct timespec end_time, duration;
 			clock_gettime(CLOCK_MONOTONIC, &end_time);
 			timespec_sub(&duration, &end_time, &start_time);
 			timer->pre_render_duration = timespec_to_nsec(&duration);
 		}
-		return true;
+		return SCENE_OUTPUT_RENDER_DONE;
 	}
 
 	struct wlr_swapchain *swapchain = options->swapchain;
 	if (!swapchain) {
 		if (!wlr_output_configure_primary_swapchain(output, state, &output->swapchain)) {
-			return false;
+			return SCENE_OUTPUT_RENDER_ERROR;
 		}
 
 		swapchain = output->swapchain;
@@ -1865,7 +2021,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 
 	struct wlr_buffer *buffer = wlr_swapchain_acquire(swapchain, NULL);
 	if (buffer == NULL) {
-		return false;
+		return SCENE_OUTPUT_RENDER_ERROR;
 	}
 
 	assert(buffer->width == resolution_width && buffer->height == resolution_height);
@@ -1882,22 +2038,54 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	struct wlr_render_pass *render_pass = wlr_renderer_begin_buffer_pass(output->renderer, buffer,
 			&(struct wlr_buffer_pass_options){
 		.timer = timer ? timer->render_timer : NULL,
+		.profiler = options->profiler,
 		.color_transform = options->color_transform,
 	});
 	if (render_pass == NULL) {
 		wlr_buffer_unlock(buffer);
-		return false;
+		return SCENE_OUTPUT_RENDER_ERROR;
 	}
 
-	render_data.render_pass = render_pass;
+	render->buffer = buffer;
+	render->color_transform = options->color_transform;
+	render->cacheable = options->swapchain == NULL &&
+		debug_damage == WLR_SCENE_DEBUG_DAMAGE_NONE;
+	render_data->render_pass = render_pass;
+	render_data->profiler = options->profiler;
 
-	pixman_region32_init(&render_data.damage);
+	pixman_region32_init(&render_data->damage);
 	wlr_damage_ring_rotate_buffer(&scene_output->damage_ring, buffer,
-		&render_data.damage);
+		&render_data->damage);
+
+	// Textures may need to be imported, which isn't safe to do while
+	// recording the render pass
+	for (int i = 0; i < list_len; i++) {
+		struct render_list_entry *entry = &list_data[i];
+		if (entry->node->type == WLR_SCENE_NODE_BUFFER) {
+			struct wlr_scene_buffer *scene_buffer =
+				wlr_scene_buffer_from_node(entry->node);
+			if (!scene_buffer->is_single_pixel_buffer) {
+				entry->texture = scene_buffer_get_texture(scene_buffer, output->renderer);
+			}
+		}
+	}
+
+	return SCENE_OUTPUT_RENDER_PENDING;
+}
+
+static void scene_output_render_record(struct scene_output_render *render) {
+	struct render_data *render_data = &render->data;
+	struct wlr_scene_output *scene_output = render_data->output;
+	struct wlr_output *output = scene_output->output;
+	struct wlr_render_pass *render_pass = render_data->render_pass;
+	struct wlr_buffer *buffer = render->buffer;
+
+	struct render_list_entry *list_data = scene_output->render_list.data;
+	int list_len = scene_output->render_list.size / sizeof(*list_data);
 
 	pixman_region32_t background;
 	pixman_region32_init(&background);
-	pixman_region32_copy(&background, &render_data.damage);
+	pixman_region32_copy(&background, &render_data->damage);
 
 	// Cull areas of the background that are occluded by opaque regions of
 	// scene nodes above. Those scene nodes will just render atop having us
@@ -1917,21 +2105,24 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 			pixman_region32_intersect(&opaque, &opaque, &entry->node->visible);
 
 			pixman_region32_translate(&opaque, -scene_output->x, -scene_output->y);
-			wlr_region_scale(&opaque, &opaque, render_data.scale);
+			wlr_region_scale(&opaque, &opaque, render_data->scale);
 			pixman_region32_subtract(&background, &background, &opaque);
 			pixman_region32_fini(&opaque);
 		}
 
-		if (floor(render_data.scale) != render_data.scale) {
+		if (floor(render_data->scale) != render_data->scale) {
 			wlr_region_expand(&background, &background, 1);
 
 			// reintersect with the damage because we never want to render
 			// outside of the damage region
-			pixman_region32_intersect(&background, &background, &render_data.damage);
+			pixman_region32_intersect(&background, &background, &render_data->damage);
 		}
 	}
 
-	transform_output_damage(&background, &render_data);
+	transform_output_damage(&background, render_data);
+	if (render_data->profiler != NULL) {
+		wlr_render_profiler_set_label(render_data->profiler, "background");
+	}
 	wlr_render_pass_add_rect(render_pass, &(struct wlr_render_rect_options){
 		.box = { .width = buffer->width, .height = buffer->height },
 		.color = { .r = 0, .g = 0, .b = 0, .a = 1 },
@@ -1941,27 +2132,18 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 
 	for (int i = list_len - 1; i >= 0; i--) {
 		struct render_list_entry *entry = &list_data[i];
-		scene_entry_render(entry, &render_data);
-
-		if (entry->node->type == WLR_SCENE_NODE_BUFFER) {
-			struct wlr_scene_buffer *buffer = wlr_scene_buffer_from_node(entry->node);
-
-			if (buffer->primary_output == scene_output && !entry->sent_dmabuf_feedback) {
-				struct wlr_linux_dmabuf_feedback_v1_init_options options = {
-					.main_renderer = output->renderer,
-					.scanout_primary_output = NULL,
-				};
+		scene_entry_render(entry, render_data);
+	}
 
-				scene_buffer_send_dmabuf_feedback(scene_output->scene, buffer, &options);
-			}
+	if (scene_output->scene->debug_damage_option == WLR_SCENE_DEBUG_DAMAGE_HIGHLIGHT) {
+		if (render_data->profiler != NULL) {
+			wlr_render_profiler_set_label(render_data->profiler, "damage highlight");
 		}
-	}
 
-	if (debug_damage == WLR_SCENE_DEBUG_DAMAGE_HIGHLIGHT) {
 		struct highlight_region *damage;
 		wl_list_for_each(damage, &scene_output->damage_highlight_regions, link) {
 			struct timespec time_diff;
-			timespec_sub(&time_diff, &now, &damage->when);
+			timespec_sub(&time_diff, &render->now, &damage->when);
 			int64_t time_diff_ms = timespec_to_msec(&time_diff);
 			float alpha = 1.0 - (double)time_diff_ms / HIGHLIGHT_DAMAGE_FADEOUT_TIME;
 
@@ -1973,12 +2155,56 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 		}
 	}
 
-	wlr_output_add_software_cursors_to_render_pass(output, render_pass, &render_data.damage);
+	if (render_data->profiler != NULL) {
+		wlr_render_profiler_set_label(render_data->profiler, "software cursors");
+	}
+	wlr_output_add_software_cursors_to_render_pass(output, render_pass, &render_data->damage);
 
-	pixman_region32_fini(&render_data.damage);
+	pixman_region32_fini(&render_data->damage);
+}
 
-	if (!wlr_render_pass_submit(render_pass)) {
-		wlr_buffer_unlock(buffer);
+static bool scene_output_render_end(struct scene_output_render *render) {
+	struct wlr_scene_output *scene_output = render->data.output;
+	struct wlr_output *output = scene_output->output;
+
+	// Submitting releases resources owned by the rest of the compositor, so
+	// it's never done from worker threads
+	render->submitted = wlr_render_pass_submit(render->data.render_pass);
+
+	struct render_list_entry *list_data = scene_output->render_list.data;
+	int list_len = scene_output->render_list.size / sizeof(*list_data);
+
+	for (int i = list_len - 1; i >= 0; i--) {
+		struct render_list_entry *entry = &list_data[i];
+		if (entry->node->type != WLR_SCENE_NODE_BUFFER) {
+			continue;
+		}
+
+		struct wlr_scene_buffer *buffer = wlr_scene_buffer_from_node(entry->node);
+
+		if (entry->rendered) {
+			entry->rendered = false;
+
+			struct wlr_scene_output_sample_event sample_event = {
+				.output = scene_output,
+				.direct_scanout = false,
+			};
+			wl_signal_emit_mutable(&buffer->events.output_sample, &sample_event);
+		}
+
+		if (buffer->primary_output == scene_output && !entry->sent_dmabuf_feedback) {
+			struct wlr_linux_dmabuf_feedback_v1_init_options options = {
+				.main_renderer = output->renderer,
+				.scanout_primary_output = NULL,
+			};
+
+			scene_buffer_send_dmabuf_feedback(scene_output->scene, buffer, &options);
+		}
+	}
+
+	if (!render->submitted) {
+		wlr_buffer_unlock(render->buffer);
+		scene_output_set_last_buffer(scene_output, NULL, NULL);
 
 		// if we failed to render the buffer, it will have undefined contents
 		// Trash the damage ring
@@ -1986,12 +2212,252 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 		return false;
 	}
 
-	wlr_output_state_set_buffer(state, buffer);
-	wlr_buffer_unlock(buffer);
+	if (render->cacheable) {
+		scene_output_set_last_buffer(scene_output, render->buffer,
+			render->color_transform);
+	} else {
+		scene_output_set_last_buffer(scene_output, NULL, NULL);
+	}
+
+	wlr_output_state_set_buffer(render->state, render->buffer);
+	wlr_buffer_unlock(render->buffer);
 
 	return true;
 }
 
+bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
+		struct wlr_output_state *state, const struct wlr_scene_output_state_options *options) {
+	struct scene_output_render render;
+	switch (scene_output_render_begin(&render, scene_output, state, options)) {
+	case SCENE_OUTPUT_RENDER_ERROR:
+		return false;
+	case SCENE_OUTPUT_RENDER_DONE:
+		return true;
+	case SCENE_OUTPUT_RENDER_PENDING:
+		break;
+	}
+
+	scene_output_render_record(&render);
+	return scene_output_render_end(&render);
+}
+
+/**
+ * Threads recording the render passes of wlr_scene_output_build_states().
+ * They're kept around between frames and wait for jobs to be queued.
+ */
+struct wlr_scene_render_workers {
+	pthread_mutex_t lock;
+	pthread_cond_t queued; // signalled when jobs are queued or on exit
+	pthread_cond_t done; // signalled when the last pending job is done
+	struct wl_list queue; // scene_output_render.worker_link
+	size_t pending; // queued or being recorded
+	bool exit;
+
+	pthread_t *threads;
+	size_t threads_len;
+};
+
+static void *scene_render_worker_run(void *data) {
+	struct wlr_scene_render_workers *workers = data;
+
+	pthread_mutex_lock(&workers->lock);
+	while (true) {
+		while (!workers->exit && wl_list_empty(&workers->queue)) {
+			pthread_cond_wait(&workers->queued, &workers->lock);
+		}
+		if (workers->exit) {
+			break;
+		}
+
+		struct scene_output_render *render =
+			wl_container_of(workers->queue.next, render, worker_link);
+		wl_list_remove(&render->worker_link);
+
+		pthread_mutex_unlock(&workers->lock);
+		scene_output_render_record(render);
+		pthread_mutex_lock(&workers->lock);
+
+		workers->pending--;
+		if (workers->pending == 0) {
+			pthread_cond_signal(&workers->done);
+		}
+	}
+	pthread_mutex_unlock(&workers->lock);
+
+	return NULL;
+}
+
+static struct wlr_scene_render_workers *scene_render_workers_create(void) {
+	struct wlr_scene_render_workers *workers = calloc(1, sizeof(*workers));
+	if (workers == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	pthread_mutex_init(&workers->lock, NULL);
+	pthread_cond_init(&workers->queued, NULL);
+	pthread_cond_init(&workers->done, NULL);
+	wl_list_init(&workers->queue);
+	return workers;
+}
+
+static void scene_render_workers_destroy(struct wlr_scene_render_workers *workers) {
+	if (workers == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&workers->lock);
+	assert(workers->pending == 0);
+	workers->exit = true;
+	pthread_cond_broadcast(&workers->queued);
+	pthread_mutex_unlock(&workers->lock);
+
+	for (size_t i = 0; i < workers->threads_len; i++) {
+		pthread_join(workers->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&workers->done);
+	pthread_cond_destroy(&workers->queued);
+	pthread_mutex_destroy(&workers->lock);
+	free(workers->threads);
+	free(workers);
+}
+
+/**
+ * Make sure at least the specified number of worker threads is running.
+ * Returns the number of running threads, which may be lower on error.
+ */
+static size_t scene_render_workers_reserve(struct wlr_scene_render_workers *workers,
+		size_t threads_len) {
+	if (threads_len <= workers->threads_len) {
+		return workers->threads_len;
+	}
+
+	pthread_t *threads = realloc(workers->threads, threads_len * sizeof(*threads));
+	if (threads == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return workers->threads_len;
+	}
+	workers->threads = threads;
+
+	// Signals are handled by the event loop thread, through signalfd
+	sigset_t mask, prev_mask;
+	sigfillset(&mask);
+	pthread_sigmask(SIG_SETMASK, &mask, &prev_mask);
+
+	while (workers->threads_len < threads_len) {
+		int ret = pthread_create(&workers->threads[workers->threads_len], NULL,
+			scene_render_worker_run, workers);
+		if (ret != 0) {
+			wlr_log(WLR_ERROR, "pthread_create failed: %s", strerror(ret));
+			break;
+		}
+		workers->threads_len++;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+
+	return workers->threads_len;
+}
+
+bool wlr_scene_output_build_states(struct wlr_scene_output_state_job *jobs,
+		size_t jobs_len) {
+	if (jobs_len == 0) {
+		return true;
+	}
+
+	struct scene_output_render *renders = calloc(jobs_len, sizeof(*renders));
+	if (renders == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+
+	struct wlr_scene *scene = jobs[0].scene_output->scene;
+
+	// A render pass is pending for a job if its buffer is set
+	size_t pending_len = 0;
+	bool concurrent = true;
+	for (size_t i = 0; i < jobs_len; i++) {
+		struct wlr_scene_output_state_job *job = &jobs[i];
+		assert(job->scene_output->scene == scene);
+		for (size_t j = 0; j < i; j++) {
+			assert(jobs[j].scene_output != job->scene_output);
+		}
+
+		enum scene_output_render_status status = scene_output_render_begin(
+			&renders[i], job->scene_output, job->state, job->options);
+		job->success = status != SCENE_OUTPUT_RENDER_ERROR;
+		if (status == SCENE_OUTPUT_RENDER_PENDING) {
+			struct wlr_renderer *renderer = job->scene_output->output->renderer;
+			concurrent = concurrent && renderer->features.concurrent_buffer_passes;
+			pending_len++;
+		}
+	}
+
+	// Queue all pending passes but one for the worker threads if the
+	// renderers allow it, and record the rest from this thread. The scene
+	// graph isn't modified until all of them are recorded since this thread
+	// is busy.
+	size_t queue_len = 0;
+	if (concurrent && pending_len > 1) {
+		if (scene->render_workers == NULL) {
+			scene->render_workers = scene_render_workers_create();
+		}
+		if (scene->render_workers != NULL) {
+			queue_len = scene_render_workers_reserve(scene->render_workers,
+				pending_len - 1);
+			if (queue_len > pending_len - 1) {
+				queue_len = pending_len - 1;
+			}
+		}
+	}
+
+	struct wlr_scene_render_workers *workers = scene->render_workers;
+	if (queue_len > 0) {
+		pthread_mutex_lock(&workers->lock);
+		for (size_t i = 0; i < jobs_len && workers->pending < queue_len; i++) {
+			if (renders[i].buffer == NULL) {
+				continue;
+			}
+			wl_list_insert(workers->queue.prev, &renders[i].worker_link);
+			workers->pending++;
+		}
+		pthread_cond_broadcast(&workers->queued);
+		pthread_mutex_unlock(&workers->lock);
+	}
+
+	size_t queued = 0;
+	for (size_t i = 0; i < jobs_len; i++) {
+		if (renders[i].buffer == NULL) {
+			continue;
+		}
+		if (queued < queue_len) {
+			queued++;
+			continue;
+		}
+		scene_output_render_record(&renders[i]);
+	}
+
+	if (queue_len > 0) {
+		pthread_mutex_lock(&workers->lock);
+		while (workers->pending > 0) {
+			pthread_cond_wait(&workers->done, &workers->lock);
+		}
+		pthread_mutex_unlock(&workers->lock);
+	}
+
+	bool ok = true;
+	for (size_t i = 0; i < jobs_len; i++) {
+		if (renders[i].buffer != NULL) {
+			jobs[i].success = scene_output_render_end(&renders[i]);
+		}
+		ok = ok && jobs[i].success;
+	}
+
+	free(renders);
+	return ok;
+}
+
 int64_t wlr_scene_timer_get_duration_ns(struct wlr_scene_timer *timer) {
 	int64_t pre_render = timer->pre_render_duration;
 	if (!timer->render_timer) {
@@ -106,6 +106,7 @@ static void seat_client_destroy(struct wlr_seat_client *client) {
 	}
 
 	wl_list_remove(&client->link);
+	wl_list_remove(&client->bucket_link);
 	free(client);
 }
 
@@ -137,6 +138,13 @@ static const struct wl_seat_interface seat_impl = {
 	.release = seat_handle_release,
 };
 
+static struct wl_list *seat_client_bucket(struct wlr_seat *seat,
+		struct wl_client *client) {
+	// Fibonacci hashing, the low bits of a heap pointer carry little entropy
+	uint64_t hash = (uint64_t)(uintptr_t)client * 0x9E3779B97F4A7C15;
+	return &seat->client_buckets[(hash >> 32) % WLR_SEAT_CLIENT_BUCKETS];
+}
+
 static struct wlr_seat_client *seat_client_create(struct wlr_seat *wlr_seat,
 		struct wl_client *client, struct wl_resource *wl_resource) {
 	struct wlr_seat_client *seat_client = calloc(1, sizeof(*seat_client));
@@ -154,6 +162,8 @@ static struct wlr_seat_client *seat_client_create(struct wlr_seat *wlr_seat,
 	wl_signal_init(&seat_client->events.destroy);
 
 	wl_list_insert(&wlr_seat->clients, &seat_client->link);
+	wl_list_insert(seat_client_bucket(wlr_seat, client),
+		&seat_client->bucket_link);
 
 	struct wlr_surface *pointer_focus =
 		wlr_seat->pointer_state.focused_surface;
@@ -318,6 +328,9 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 	seat->display = display;
 	seat->name = strdup(name);
 	wl_list_init(&seat->clients);
+	for (size_t i = 0; i < WLR_SEAT_CLIENT_BUCKETS; i++) {
+		wl_list_init(&seat->client_buckets[i]);
+	}
 	wl_list_init(&seat->selection_offers);
 	wl_list_init(&seat->drag_offers);
 
@@ -350,8 +363,9 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 
 struct wlr_seat_client *wlr_seat_client_for_wl_client(struct wlr_seat *wlr_seat,
 		struct wl_client *wl_client) {
+	struct wl_list *bucket = seat_client_bucket(wlr_seat, wl_client);
 	struct wlr_seat_client *seat_client;
-	wl_list_for_each(seat_client, &wlr_seat->clients, link) {
+	wl_list_for_each(seat_client, bucket, bucket_link) {
 		if (seat_client->client == wl_client) {
 			return seat_client;
 		}
@@ -122,6 +122,7 @@ void wlr_seat_set_keyboard(struct wlr_seat *seat,
 		return;
 	}
 
+	struct wlr_keyboard *prev_keyboard = seat->keyboard_state.keyboard;
 	if (seat->keyboard_state.keyboard) {
 		wl_list_remove(&seat->keyboard_state.keyboard_destroy.link);
 		wl_list_remove(&seat->keyboard_state.keyboard_keymap.link);
@@ -143,9 +144,16 @@ void wlr_seat_set_keyboard(struct wlr_seat *seat,
 		seat->keyboard_state.keyboard_repeat_info.notify =
 			handle_keyboard_repeat_info;
 
+		// Keyboards with identical keymaps share the same keymap string, so
+		// clients don't need to be sent the keymap again
+		bool keymap_changed = prev_keyboard == NULL ||
+			prev_keyboard->keymap_string != keyboard->keymap_string;
+
 		struct wlr_seat_client *client;
 		wl_list_for_each(client, &seat->clients, link) {
-			seat_client_send_keymap(client, keyboard);
+			if (keymap_changed) {
+				seat_client_send_keymap(client, keyboard);
+			}
 			seat_client_send_repeat_info(client, keyboard);
 		}
 
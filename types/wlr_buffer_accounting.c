@@ -0,0 +1,208 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_buffer_accounting.h>
+#include <wlr/util/log.h>
+#include "types/wlr_buffer_accounting.h"
+
+static void client_detach_entries(struct wlr_buffer_accounting_client *client) {
+	struct wlr_buffer_accounting_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &client->entries, link) {
+		entry->client = NULL;
+		wl_list_remove(&entry->link);
+		wl_list_init(&entry->link);
+	}
+}
+
+static void client_destroy(struct wlr_buffer_accounting_client *client) {
+	client_detach_entries(client);
+	if (client->limit_idle != NULL) {
+		wl_event_source_remove(client->limit_idle);
+	}
+	wl_list_remove(&client->client_destroy.link);
+	wl_list_remove(&client->link);
+	free(client);
+}
+
+static void client_handle_client_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_buffer_accounting_client *client =
+		wl_container_of(listener, client, client_destroy);
+	// Resources are destroyed after the client destroy signal is emitted,
+	// their entries are detached and won't touch the client anymore
+	client_destroy(client);
+}
+
+static void client_handle_limit_idle(void *data) {
+	struct wlr_buffer_accounting_client *client = data;
+	client->limit_idle = NULL;
+	if (client->over_limit) {
+		wl_signal_emit_mutable(&client->accounting->events.limit_exceeded, client);
+	}
+}
+
+static void client_check_limits(struct wlr_buffer_accounting_client *client) {
+	const struct wlr_buffer_accounting_usage *limits = &client->accounting->soft_limits;
+
+	bool over_limit = false;
+	for (size_t i = 0; i < WLR_BUFFER_ACCOUNTING_KIND_COUNT; i++) {
+		if (limits->values[i] != 0 && client->usage.values[i] > limits->values[i]) {
+			over_limit = true;
+			break;
+		}
+	}
+
+	bool crossed = over_limit && !client->over_limit;
+	client->over_limit = over_limit;
+	if (!crossed || client->limit_idle != NULL) {
+		return;
+	}
+
+	// Limits are checked while resources are being set up or torn down, defer
+	// the event so that handlers don't observe (or destroy) them half-done
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(client->accounting->display);
+	client->limit_idle =
+		wl_event_loop_add_idle(loop, client_handle_limit_idle, client);
+	if (client->limit_idle == NULL) {
+		wlr_log(WLR_ERROR, "Failed to schedule buffer accounting limit event");
+	}
+}
+
+static void accounting_handle_display_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_buffer_accounting *accounting =
+		wl_container_of(listener, accounting, display_destroy);
+	wlr_buffer_accounting_destroy(accounting);
+}
+
+static struct wlr_buffer_accounting *accounting_from_display(
+		struct wl_display *display) {
+	struct wl_listener *listener = wl_display_get_destroy_listener(display,
+		accounting_handle_display_destroy);
+	if (listener == NULL) {
+		return NULL;
+	}
+	struct wlr_buffer_accounting *accounting =
+		wl_container_of(listener, accounting, display_destroy);
+	return accounting;
+}
+
+static struct wlr_buffer_accounting_client *client_get_or_create(
+		struct wlr_buffer_accounting *accounting, struct wl_client *wl_client) {
+	struct wlr_buffer_accounting_client *client =
+		wlr_buffer_accounting_get_client(accounting, wl_client);
+	if (client != NULL) {
+		return client;
+	}
+
+	client = calloc(1, sizeof(*client));
+	if (client == NULL) {
+		return NULL;
+	}
+
+	client->client = wl_client;
+	client->accounting = accounting;
+	wl_list_init(&client->entries);
+	wl_list_insert(&accounting->clients, &client->link);
+
+	client->client_destroy.notify = client_handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->client_destroy);
+
+	return client;
+}
+
+struct wlr_buffer_accounting *wlr_buffer_accounting_create(struct wl_display *display) {
+	assert(accounting_from_display(display) == NULL);
+
+	struct wlr_buffer_accounting *accounting = calloc(1, sizeof(*accounting));
+	if (accounting == NULL) {
+		return NULL;
+	}
+
+	accounting->display = display;
+	wl_list_init(&accounting->clients);
+
+	wl_signal_init(&accounting->events.limit_exceeded);
+	wl_signal_init(&accounting->events.destroy);
+
+	accounting->display_destroy.notify = accounting_handle_display_destroy;
+	wl_display_add_destroy_listener(display, &accounting->display_destroy);
+
+	return accounting;
+}
+
+void wlr_buffer_accounting_destroy(struct wlr_buffer_accounting *accounting) {
+	if (accounting == NULL) {
+		return;
+	}
+
+	wl_signal_emit_mutable(&accounting->events.destroy, NULL);
+
+	assert(wl_list_empty(&accounting->events.limit_exceeded.listener_list));
+	assert(wl_list_empty(&accounting->events.destroy.listener_list));
+
+	struct wlr_buffer_accounting_client *client, *tmp;
+	wl_list_for_each_safe(client, tmp, &accounting->clients, link) {
+		client_destroy(client);
+	}
+
+	wl_list_remove(&accounting->display_destroy.link);
+	free(accounting);
+}
+
+struct wlr_buffer_accounting_client *wlr_buffer_accounting_get_client(
+		struct wlr_buffer_accounting *accounting, struct wl_client *wl_client) {
+	struct wl_listener *listener = wl_client_get_destroy_listener(wl_client,
+		client_handle_client_destroy);
+	if (listener == NULL) {
+		return NULL;
+	}
+	struct wlr_buffer_accounting_client *client =
+		wl_container_of(listener, client, client_destroy);
+	assert(client->accounting == accounting);
+	return client;
+}
+
+void buffer_accounting_entry_init(struct wlr_buffer_accounting_entry *entry,
+		struct wl_client *wl_client, enum wlr_buffer_accounting_kind kind,
+		size_t value) {
+	*entry = (struct wlr_buffer_accounting_entry){
+		.kind = kind,
+	};
+	wl_list_init(&entry->link);
+
+	struct wlr_buffer_accounting *accounting =
+		accounting_from_display(wl_client_get_display(wl_client));
+	if (accounting == NULL) {
+		return;
+	}
+
+	entry->client = client_get_or_create(accounting, wl_client);
+	if (entry->client == NULL) {
+		return;
+	}
+
+	wl_list_insert(&entry->client->entries, &entry->link);
+	buffer_accounting_entry_update(entry, value);
+}
+
+void buffer_accounting_entry_update(struct wlr_buffer_accounting_entry *entry,
+		size_t value) {
+	struct wlr_buffer_accounting_client *client = entry->client;
+	if (client == NULL) {
+		entry->value = value;
+		return;
+	}
+
+	client->usage.values[entry->kind] -= entry->value;
+	client->usage.values[entry->kind] += value;
+	entry->value = value;
+
+	client_check_limits(client);
+}
+
+void buffer_accounting_entry_finish(struct wlr_buffer_accounting_entry *entry) {
+	buffer_accounting_entry_update(entry, 0);
+	entry->client = NULL;
+	wl_list_remove(&entry->link);
+	wl_list_init(&entry->link);
+}
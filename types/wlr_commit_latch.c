@@ -0,0 +1,258 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_commit_latch.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+#include "types/wlr_output.h"
+#include "util/time.h"
+
+#define DEFAULT_DEADLINE_NS 4000000 // 4ms
+
+struct wlr_commit_latch_commit {
+	struct wlr_commit_latch *latch;
+	struct wlr_surface *surface;
+	uint32_t seq;
+
+	struct wl_list link; // wlr_commit_latch.commits
+	struct wl_listener surface_destroy;
+};
+
+static void commit_apply(struct wlr_commit_latch_commit *commit) {
+	wl_list_remove(&commit->link);
+	wl_list_remove(&commit->surface_destroy.link);
+	wlr_surface_unlock_cached(commit->surface, commit->seq);
+	free(commit);
+}
+
+static void commit_handle_surface_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_commit_latch_commit *commit =
+		wl_container_of(listener, commit, surface_destroy);
+	commit_apply(commit);
+}
+
+static void latch_apply_commits(struct wlr_commit_latch *latch) {
+	// Applying a commit may queue new ones, these are deferred to the next
+	// deadline
+	struct wl_list commits;
+	wl_list_init(&commits);
+	wl_list_insert_list(&commits, &latch->commits);
+	wl_list_init(&latch->commits);
+
+	// Announce all unlocks first, so that buffers superseded by a later
+	// commit of the same surface aren't uploaded, then apply commits in the
+	// order they were submitted
+	struct wlr_commit_latch_commit *commit;
+	wl_list_for_each(commit, &commits, link) {
+		wlr_surface_expect_unlock_cached(commit->surface, commit->seq);
+	}
+
+	while (!wl_list_empty(&commits)) {
+		commit = wl_container_of(commits.next, commit, link);
+		commit_apply(commit);
+	}
+
+	wl_signal_emit_mutable(&latch->events.latch, NULL);
+}
+
+static int latch_handle_timer(void *data) {
+	struct wlr_commit_latch *latch = data;
+	latch->timer_armed = false;
+	latch_apply_commits(latch);
+	return 0;
+}
+
+static void latch_handle_idle(void *data) {
+	struct wlr_commit_latch *latch = data;
+	latch->idle_source = NULL;
+	latch_apply_commits(latch);
+}
+
+static void latch_apply_commits_soon(struct wlr_commit_latch *latch) {
+	if (latch->timer_armed) {
+		wl_event_source_timer_update(latch->timer, 0);
+		latch->timer_armed = false;
+	}
+	if (latch->idle_source == NULL) {
+		latch->idle_source = wl_event_loop_add_idle(latch->output->event_loop,
+			latch_handle_idle, latch);
+		if (latch->idle_source == NULL) {
+			wlr_log(WLR_ERROR, "Failed to add idle event source");
+		}
+	}
+}
+
+static void latch_schedule(struct wlr_commit_latch *latch) {
+	if (wl_list_empty(&latch->commits) || latch->idle_source != NULL) {
+		return;
+	}
+
+	if (!latch->output->enabled || latch->refresh_ns <= 0) {
+		latch_apply_commits_soon(latch);
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t now_ns = timespec_to_nsec(&now);
+
+	// Pick the first vblank whose deadline is still ahead of us
+	int64_t vblank_ns = output_predict_vblank(&latch->last_present,
+		latch->refresh_ns, now_ns, latch->deadline_ns);
+	int delay_ms = output_deadline_delay_ms(vblank_ns - latch->deadline_ns, now_ns);
+	if (delay_ms <= 0) {
+		latch_apply_commits_soon(latch);
+		return;
+	}
+
+	wl_event_source_timer_update(latch->timer, delay_ms);
+	latch->timer_armed = true;
+}
+
+static void latch_handle_output_present(struct wl_listener *listener, void *data) {
+	struct wlr_commit_latch *latch = wl_container_of(listener, latch, output_present);
+	const struct wlr_output_event_present *event = data;
+
+	if (!event->presented) {
+		return;
+	}
+
+	output_update_vblank_timings(latch->output, event,
+		&latch->last_present, &latch->refresh_ns);
+	latch_schedule(latch);
+}
+
+static void latch_handle_output_commit(struct wl_listener *listener, void *data) {
+	struct wlr_commit_latch *latch = wl_container_of(listener, latch, output_commit);
+	const struct wlr_output_event_commit *event = data;
+
+	// The vblank timings are invalidated, wait for the next present event
+	if (event->state->committed & (WLR_OUTPUT_STATE_MODE | WLR_OUTPUT_STATE_ENABLED)) {
+		latch->refresh_ns = 0;
+		latch_schedule(latch);
+	}
+}
+
+static void latch_addon_destroy(struct wlr_addon *addon) {
+	struct wlr_commit_latch *latch = wl_container_of(addon, latch, addon);
+	wlr_commit_latch_destroy(latch);
+}
+
+static const struct wlr_addon_interface latch_addon_impl = {
+	.name = "wlr_commit_latch",
+	.destroy = latch_addon_destroy,
+};
+
+struct wlr_commit_latch *wlr_commit_latch_create(struct wlr_output *output) {
+	assert(wlr_commit_latch_from_output(output) == NULL);
+
+	struct wlr_commit_latch *latch = calloc(1, sizeof(*latch));
+	if (latch == NULL) {
+		return NULL;
+	}
+
+	latch->timer = wl_event_loop_add_timer(output->event_loop,
+		latch_handle_timer, latch);
+	if (latch->timer == NULL) {
+		free(latch);
+		return NULL;
+	}
+
+	latch->output = output;
+	latch->deadline_ns = DEFAULT_DEADLINE_NS;
+	wl_list_init(&latch->commits);
+
+	wl_signal_init(&latch->events.latch);
+	wl_signal_init(&latch->events.destroy);
+
+	wlr_addon_init(&latch->addon, &output->addons, NULL, &latch_addon_impl);
+
+	latch->output_present.notify = latch_handle_output_present;
+	wl_signal_add(&output->events.present, &latch->output_present);
+	latch->output_commit.notify = latch_handle_output_commit;
+	wl_signal_add(&output->events.commit, &latch->output_commit);
+
+	return latch;
+}
+
+void wlr_commit_latch_destroy(struct wlr_commit_latch *latch) {
+	if (latch == NULL) {
+		return;
+	}
+
+	wl_signal_emit_mutable(&latch->events.destroy, NULL);
+
+	struct wlr_commit_latch_commit *commit, *tmp;
+	wl_list_for_each_safe(commit, tmp, &latch->commits, link) {
+		commit_apply(commit);
+	}
+
+	assert(wl_list_empty(&latch->events.latch.listener_list));
+	assert(wl_list_empty(&latch->events.destroy.listener_list));
+
+	wlr_addon_finish(&latch->addon);
+	wl_list_remove(&latch->output_present.link);
+	wl_list_remove(&latch->output_commit.link);
+	wl_event_source_remove(latch->timer);
+	if (latch->idle_source != NULL) {
+		wl_event_source_remove(latch->idle_source);
+	}
+	free(latch);
+}
+
+struct wlr_commit_latch *wlr_commit_latch_from_output(struct wlr_output *output) {
+	struct wlr_addon *addon =
+		wlr_addon_find(&output->addons, NULL, &latch_addon_impl);
+	if (addon == NULL) {
+		return NULL;
+	}
+	struct wlr_commit_latch *latch = wl_container_of(addon, latch, addon);
+	return latch;
+}
+
+struct wlr_commit_latch *wlr_commit_latch_from_surface(struct wlr_surface *surface) {
+	struct wlr_surface_output *surface_output;
+	wl_list_for_each(surface_output, &surface->current_outputs, link) {
+		struct wlr_commit_latch *latch =
+			wlr_commit_latch_from_output(surface_output->output);
+		if (latch != NULL) {
+			return latch;
+		}
+	}
+	return NULL;
+}
+
+void wlr_commit_latch_set_deadline(struct wlr_commit_latch *latch,
+		int64_t deadline_ns) {
+	assert(deadline_ns >= 0);
+	latch->deadline_ns = deadline_ns;
+	if (latch->timer_armed) {
+		latch_schedule(latch);
+	}
+}
+
+int64_t wlr_commit_latch_get_refresh_ns(struct wlr_commit_latch *latch) {
+	return latch->refresh_ns;
+}
+
+bool wlr_commit_latch_queue(struct wlr_commit_latch *latch,
+		struct wlr_surface *surface, uint32_t seq) {
+	struct wlr_commit_latch_commit *commit = calloc(1, sizeof(*commit));
+	if (commit == NULL) {
+		return false;
+	}
+
+	commit->latch = latch;
+	commit->surface = surface;
+	commit->seq = seq;
+	wl_list_insert(latch->commits.prev, &commit->link);
+
+	commit->surface_destroy.notify = commit_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &commit->surface_destroy);
+
+	if (!latch->timer_armed) {
+		latch_schedule(latch);
+	}
+
+	return true;
+}
@@ -0,0 +1,235 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_commit_latch.h>
+#include <wlr/types/wlr_commit_rate_limiter.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/util/addon.h>
+#include "util/time.h"
+
+struct wlr_commit_rate_limiter_surface {
+	struct wlr_commit_rate_limiter *limiter;
+	struct wlr_surface *surface;
+	struct wlr_commit_rate_limiter_client *client; // NULL if destroyed
+
+	int64_t last_buffer_ns;
+	size_t deferred; // number of buffer commits queued on a latch
+
+	struct wl_list link; // wlr_commit_rate_limiter.surfaces
+	struct wlr_addon addon;
+
+	struct wl_listener client_commit;
+	struct wl_listener commit;
+};
+
+static int64_t get_current_time_nsec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now);
+}
+
+static void client_destroy(struct wlr_commit_rate_limiter_client *client) {
+	struct wlr_commit_rate_limiter_surface *limiter_surface;
+	wl_list_for_each(limiter_surface, &client->limiter->surfaces, link) {
+		if (limiter_surface->client == client) {
+			limiter_surface->client = NULL;
+		}
+	}
+
+	wl_list_remove(&client->client_destroy.link);
+	wl_list_remove(&client->link);
+	free(client);
+}
+
+static void client_handle_client_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_commit_rate_limiter_client *client =
+		wl_container_of(listener, client, client_destroy);
+	client_destroy(client);
+}
+
+struct wlr_commit_rate_limiter_client *wlr_commit_rate_limiter_get_client(
+		struct wlr_commit_rate_limiter *limiter, struct wl_client *wl_client) {
+	struct wlr_commit_rate_limiter_client *client;
+	wl_list_for_each(client, &limiter->clients, link) {
+		if (client->client == wl_client) {
+			return client;
+		}
+	}
+	return NULL;
+}
+
+static struct wlr_commit_rate_limiter_client *client_get_or_create(
+		struct wlr_commit_rate_limiter *limiter, struct wl_client *wl_client) {
+	struct wlr_commit_rate_limiter_client *client =
+		wlr_commit_rate_limiter_get_client(limiter, wl_client);
+	if (client != NULL) {
+		return client;
+	}
+
+	client = calloc(1, sizeof(*client));
+	if (client == NULL) {
+		return NULL;
+	}
+
+	client->client = wl_client;
+	client->limiter = limiter;
+	wl_list_insert(&limiter->clients, &client->link);
+
+	client->client_destroy.notify = client_handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->client_destroy);
+
+	return client;
+}
+
+static void surface_destroy(struct wlr_commit_rate_limiter_surface *limiter_surface) {
+	wlr_addon_finish(&limiter_surface->addon);
+	wl_list_remove(&limiter_surface->client_commit.link);
+	wl_list_remove(&limiter_surface->commit.link);
+	wl_list_remove(&limiter_surface->link);
+	free(limiter_surface);
+}
+
+static void surface_addon_destroy(struct wlr_addon *addon) {
+	struct wlr_commit_rate_limiter_surface *limiter_surface =
+		wl_container_of(addon, limiter_surface, addon);
+	surface_destroy(limiter_surface);
+}
+
+static const struct wlr_addon_interface surface_addon_impl = {
+	.name = "wlr_commit_rate_limiter_surface",
+	.destroy = surface_addon_destroy,
+};
+
+static void surface_handle_client_commit(struct wl_listener *listener, void *data) {
+	struct wlr_commit_rate_limiter_surface *limiter_surface =
+		wl_container_of(listener, limiter_surface, client_commit);
+	struct wlr_surface *surface = limiter_surface->surface;
+
+	if (!(surface->pending.committed & WLR_SURFACE_STATE_BUFFER) ||
+			surface->pending.buffer == NULL) {
+		return;
+	}
+
+	struct wlr_commit_latch *latch = wlr_commit_latch_from_surface(surface);
+	if (latch == NULL) {
+		return;
+	}
+	int64_t refresh_ns = wlr_commit_latch_get_refresh_ns(latch);
+	if (refresh_ns <= 0) {
+		return;
+	}
+
+	int64_t now_ns = get_current_time_nsec();
+	if (limiter_surface->deferred == 0 &&
+			now_ns - limiter_surface->last_buffer_ns >= refresh_ns) {
+		return;
+	}
+
+	uint32_t seq = wlr_surface_lock_pending(surface);
+	if (!wlr_commit_latch_queue(latch, surface, seq)) {
+		wlr_surface_unlock_cached(surface, seq);
+		return;
+	}
+
+	// The previously deferred buffer will be replaced by this one
+	if (limiter_surface->deferred > 0 && limiter_surface->client != NULL) {
+		limiter_surface->client->dropped_buffers++;
+	}
+	limiter_surface->deferred++;
+}
+
+static void surface_handle_commit(struct wl_listener *listener, void *data) {
+	struct wlr_commit_rate_limiter_surface *limiter_surface =
+		wl_container_of(listener, limiter_surface, commit);
+	struct wlr_surface *surface = limiter_surface->surface;
+
+	if (!(surface->current.committed & WLR_SURFACE_STATE_BUFFER) ||
+			surface->current.buffer == NULL) {
+		return;
+	}
+
+	limiter_surface->last_buffer_ns = get_current_time_nsec();
+	if (limiter_surface->deferred > 0) {
+		limiter_surface->deferred--;
+	}
+}
+
+static void limiter_handle_compositor_new_surface(struct wl_listener *listener,
+		void *data) {
+	struct wlr_commit_rate_limiter *limiter =
+		wl_container_of(listener, limiter, compositor_new_surface);
+	struct wlr_surface *surface = data;
+
+	struct wlr_commit_rate_limiter_surface *limiter_surface =
+		calloc(1, sizeof(*limiter_surface));
+	if (limiter_surface == NULL) {
+		return;
+	}
+
+	struct wl_client *wl_client = wl_resource_get_client(surface->resource);
+	limiter_surface->client = client_get_or_create(limiter, wl_client);
+	if (limiter_surface->client == NULL) {
+		free(limiter_surface);
+		return;
+	}
+
+	limiter_surface->limiter = limiter;
+	limiter_surface->surface = surface;
+	wl_list_insert(&limiter->surfaces, &limiter_surface->link);
+
+	wlr_addon_init(&limiter_surface->addon, &surface->addons, limiter,
+		&surface_addon_impl);
+
+	limiter_surface->client_commit.notify = surface_handle_client_commit;
+	wl_signal_add(&surface->events.client_commit, &limiter_surface->client_commit);
+	limiter_surface->commit.notify = surface_handle_commit;
+	wl_signal_add(&surface->events.commit, &limiter_surface->commit);
+}
+
+static void limiter_handle_compositor_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_commit_rate_limiter *limiter =
+		wl_container_of(listener, limiter, compositor_destroy);
+	wlr_commit_rate_limiter_destroy(limiter);
+}
+
+struct wlr_commit_rate_limiter *wlr_commit_rate_limiter_create(
+		struct wlr_compositor *compositor) {
+	struct wlr_commit_rate_limiter *limiter = calloc(1, sizeof(*limiter));
+	if (limiter == NULL) {
+		return NULL;
+	}
+
+	wl_list_init(&limiter->clients);
+	wl_list_init(&limiter->surfaces);
+	wl_signal_init(&limiter->events.destroy);
+
+	limiter->compositor_new_surface.notify = limiter_handle_compositor_new_surface;
+	wl_signal_add(&compositor->events.new_surface, &limiter->compositor_new_surface);
+	limiter->compositor_destroy.notify = limiter_handle_compositor_destroy;
+	wl_signal_add(&compositor->events.destroy, &limiter->compositor_destroy);
+
+	return limiter;
+}
+
+void wlr_commit_rate_limiter_destroy(struct wlr_commit_rate_limiter *limiter) {
+	if (limiter == NULL) {
+		return;
+	}
+
+	wl_signal_emit_mutable(&limiter->events.destroy, NULL);
+
+	assert(wl_list_empty(&limiter->events.destroy.listener_list));
+
+	struct wlr_commit_rate_limiter_surface *limiter_surface, *surface_tmp;
+	wl_list_for_each_safe(limiter_surface, surface_tmp, &limiter->surfaces, link) {
+		surface_destroy(limiter_surface);
+	}
+	struct wlr_commit_rate_limiter_client *client, *client_tmp;
+	wl_list_for_each_safe(client, client_tmp, &limiter->clients, link) {
+		client_destroy(client);
+	}
+
+	wl_list_remove(&limiter->compositor_new_surface.link);
+	wl_list_remove(&limiter->compositor_destroy.link);
+	free(limiter);
+}
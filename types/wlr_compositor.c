@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-server-core.h>
 #include <wlr/render/interface.h>
 #include <wlr/types/wlr_buffer.h>
@@ -11,6 +12,7 @@
 #include <wlr/util/region.h>
 #include <wlr/util/transform.h>
 #include "types/wlr_buffer.h"
+#include "types/wlr_buffer_accounting.h"
 #include "types/wlr_region.h"
 #include "types/wlr_subcompositor.h"
 #include "util/array.h"
@@ -402,9 +404,45 @@ static void surface_state_move(struct wlr_surface_state *state,
 
 	state->cached_state_locks = next->cached_state_locks;
 	next->cached_state_locks = 0;
+	state->cached_state_expected_unlocks = next->cached_state_expected_unlocks;
+	next->cached_state_expected_unlocks = 0;
 }
 
-static void surface_apply_damage(struct wlr_surface *surface) {
+static void surface_clear_buffer_pool(struct wlr_surface *surface) {
+	for (size_t i = 0; i < WLR_SURFACE_BUFFER_POOL_SIZE; i++) {
+		if (surface->buffer_pool[i].buffer != NULL) {
+			wlr_buffer_unlock(&surface->buffer_pool[i].buffer->base);
+			surface->buffer_pool[i].buffer = NULL;
+		}
+		pixman_region32_clear(&surface->buffer_pool[i].damage);
+	}
+}
+
+/**
+ * Move the current client buffer to the pool slot, replacing the buffer which
+ * was there. The current client buffer is left unset.
+ */
+static void surface_pool_current_buffer(struct wlr_surface *surface, size_t i) {
+	struct wlr_client_buffer *buffer = surface->buffer;
+	surface->buffer = NULL;
+
+	if (buffer != NULL && buffer->texture != NULL &&
+			buffer->texture->references_buffer) {
+		// The texture wraps the client's buffer and can't be updated, keeping
+		// it would only prevent the client from re-using its buffer
+		wlr_buffer_unlock(&buffer->base);
+		buffer = NULL;
+	}
+
+	if (surface->buffer_pool[i].buffer != NULL) {
+		wlr_buffer_unlock(&surface->buffer_pool[i].buffer->base);
+	}
+	surface->buffer_pool[i].buffer = buffer;
+	// The pooled buffer contains the previous frame
+	pixman_region32_copy(&surface->buffer_pool[i].damage, &surface->buffer_damage);
+}
+
+static void surface_apply_damage(struct wlr_surface *surface, bool superseded) {
 	if (surface->current.buffer == NULL) {
 		// NULL commit
 		if (surface->buffer != NULL) {
@@ -412,11 +450,31 @@ static void surface_apply_damage(struct wlr_surface *surface) {
 		}
 		surface->buffer = NULL;
 		surface->opaque = false;
+		surface_clear_buffer_pool(surface);
+		pixman_region32_clear(&surface->superseded_damage);
 		return;
 	}
 
 	surface->opaque = buffer_is_opaque(surface->current.buffer);
 
+	if (superseded) {
+		// A later commit replaces the buffer before anything can be rendered,
+		// skip the upload. The buffer is released at the end of the commit.
+		pixman_region32_union(&surface->superseded_damage,
+			&surface->superseded_damage, &surface->buffer_damage);
+		return;
+	}
+
+	// Damage is relative to the last uploaded buffer
+	pixman_region32_union(&surface->buffer_damage,
+		&surface->buffer_damage, &surface->superseded_damage);
+	pixman_region32_clear(&surface->superseded_damage);
+
+	for (size_t i = 0; i < WLR_SURFACE_BUFFER_POOL_SIZE; i++) {
+		pixman_region32_union(&surface->buffer_pool[i].damage,
+			&surface->buffer_pool[i].damage, &surface->buffer_damage);
+	}
+
 	if (surface->buffer != NULL) {
 		if (wlr_client_buffer_apply_damage(surface->buffer,
 				surface->current.buffer, &surface->buffer_damage)) {
@@ -426,6 +484,25 @@ static void surface_apply_damage(struct wlr_surface *surface) {
 		}
 	}
 
+	// The current client buffer is still referenced elsewhere (e.g. by a
+	// screen capture), try to update an older one instead of uploading the
+	// whole buffer
+	for (size_t i = 0; i < WLR_SURFACE_BUFFER_POOL_SIZE; i++) {
+		struct wlr_client_buffer *buffer = surface->buffer_pool[i].buffer;
+		if (buffer == NULL || !wlr_client_buffer_apply_damage(buffer,
+				surface->current.buffer, &surface->buffer_pool[i].damage)) {
+			continue;
+		}
+
+		surface->buffer_pool[i].buffer = NULL;
+		surface_pool_current_buffer(surface, i);
+		surface->buffer = buffer;
+
+		wlr_buffer_unlock(surface->current.buffer);
+		surface->current.buffer = NULL;
+		return;
+	}
+
 	if (surface->compositor->renderer == NULL) {
 		return;
 	}
@@ -438,12 +515,40 @@ static void surface_apply_damage(struct wlr_surface *surface) {
 		return;
 	}
 
-	if (surface->buffer != NULL) {
-		wlr_buffer_unlock(&surface->buffer->base);
+	// Evict the oldest pooled buffer
+	size_t last = WLR_SURFACE_BUFFER_POOL_SIZE - 1;
+	if (surface->buffer_pool[last].buffer != NULL) {
+		wlr_buffer_unlock(&surface->buffer_pool[last].buffer->base);
 	}
+	pixman_region32_t last_damage = surface->buffer_pool[last].damage;
+	memmove(&surface->buffer_pool[1], &surface->buffer_pool[0],
+		last * sizeof(surface->buffer_pool[0]));
+	surface->buffer_pool[0].buffer = NULL;
+	surface->buffer_pool[0].damage = last_damage;
+
+	surface_pool_current_buffer(surface, 0);
 	surface->buffer = buffer;
 }
 
+static size_t client_buffer_texture_size(struct wlr_client_buffer *buffer) {
+	// Textures importing the client's buffer don't allocate memory of their
+	// own, the buffer is already accounted to the client
+	if (buffer == NULL || buffer->texture == NULL ||
+			buffer->texture->references_buffer) {
+		return 0;
+	}
+	// Assume 4 bytes per pixel, the texture format isn't exposed
+	return (size_t)buffer->base.width * buffer->base.height * 4;
+}
+
+static void surface_update_texture_accounting(struct wlr_surface *surface) {
+	size_t size = client_buffer_texture_size(surface->buffer);
+	for (size_t i = 0; i < WLR_SURFACE_BUFFER_POOL_SIZE; i++) {
+		size += client_buffer_texture_size(surface->buffer_pool[i].buffer);
+	}
+	buffer_accounting_entry_update(&surface->texture_accounting, size);
+}
+
 static void surface_update_opaque_region(struct wlr_surface *surface) {
 	if (!wlr_surface_has_buffer(surface)) {
 		pixman_region32_clear(&surface->opaque_region);
@@ -508,8 +613,13 @@ error:
 	wl_resource_post_no_memory(surface->resource);
 }
 
+/**
+ * Apply a state to the surface. If superseded is true, the state is followed
+ * by another one which will be applied right away and which attaches a new
+ * buffer, so there is no need to upload this state's buffer.
+ */
 static void surface_commit_state(struct wlr_surface *surface,
-		struct wlr_surface_state *next) {
+		struct wlr_surface_state *next, bool superseded) {
 	assert(next->cached_state_locks == 0);
 
 	bool invalid_buffer = next->committed & WLR_SURFACE_STATE_BUFFER;
@@ -531,9 +641,11 @@ static void surface_commit_state(struct wlr_surface *surface,
 	surface->previous.buffer_height = surface->current.buffer_height;
 
 	surface_state_move(&surface->current, next, surface);
+	surface_invalidate_flattened_tree(surface);
 
 	if (invalid_buffer) {
-		surface_apply_damage(surface);
+		surface_apply_damage(surface, superseded);
+		surface_update_texture_accounting(surface);
 	}
 	surface_update_opaque_region(surface);
 	surface_update_input_region(surface);
@@ -588,7 +700,7 @@ static void surface_handle_commit(struct wl_client *client,
 	if (surface->pending.cached_state_locks > 0 || !wl_list_empty(&surface->cached)) {
 		surface_cache_pending(surface);
 	} else {
-		surface_commit_state(surface, &surface->pending);
+		surface_commit_state(surface, &surface->pending, false);
 	}
 }
 
@@ -748,6 +860,13 @@ static void surface_handle_resource_destroy(struct wl_resource *resource) {
 	if (surface->buffer != NULL) {
 		wlr_buffer_unlock(&surface->buffer->base);
 	}
+	surface_clear_buffer_pool(surface);
+	for (size_t i = 0; i < WLR_SURFACE_BUFFER_POOL_SIZE; i++) {
+		pixman_region32_fini(&surface->buffer_pool[i].damage);
+	}
+	pixman_region32_fini(&surface->superseded_damage);
+	buffer_accounting_entry_finish(&surface->texture_accounting);
+	wl_array_release(&surface->flattened_tree);
 	free(surface);
 }
 
@@ -787,6 +906,14 @@ static struct wlr_surface *surface_create(struct wl_client *client,
 	pixman_region32_init(&surface->buffer_damage);
 	pixman_region32_init(&surface->opaque_region);
 	pixman_region32_init(&surface->input_region);
+	pixman_region32_init(&surface->superseded_damage);
+	wl_array_init(&surface->flattened_tree);
+	surface->flattened_tree_dirty = true;
+	buffer_accounting_entry_init(&surface->texture_accounting, client,
+		WLR_BUFFER_ACCOUNTING_TEXTURE, 0);
+	for (size_t i = 0; i < WLR_SURFACE_BUFFER_POOL_SIZE; i++) {
+		pixman_region32_init(&surface->buffer_pool[i].damage);
+	}
 	wlr_addon_set_init(&surface->addons);
 	wl_list_init(&surface->synced);
 
@@ -819,6 +946,7 @@ void wlr_surface_map(struct wlr_surface *surface) {
 	}
 	assert(wlr_surface_has_buffer(surface));
 	surface->mapped = true;
+	surface_invalidate_flattened_tree(surface);
 
 	struct wlr_subsurface *subsurface;
 	wl_list_for_each(subsurface, &surface->current.subsurfaces_below, current.link) {
@@ -836,6 +964,7 @@ void wlr_surface_unmap(struct wlr_surface *surface) {
 		return;
 	}
 	surface->mapped = false;
+	surface_invalidate_flattened_tree(surface);
 	wl_signal_emit_mutable(&surface->events.unmap, NULL);
 	if (surface->role != NULL && surface->role->unmap != NULL &&
 			(surface->role_resource != NULL || surface->role->no_object)) {
@@ -923,30 +1052,68 @@ static void surface_destroy_role_object(struct wlr_surface *surface) {
 	wl_list_init(&surface->role_resource_destroy.link);
 }
 
+/**
+ * Check whether a cached state's buffer is replaced by a following cached
+ * state which is ready to be applied as well, or which will be once the
+ * expected unlocks are done.
+ */
+static bool cached_state_is_superseded(struct wlr_surface *surface,
+		struct wlr_surface_state *state) {
+	if (!(state->committed & WLR_SURFACE_STATE_BUFFER) || state->buffer == NULL) {
+		return false;
+	}
+
+	for (struct wl_list *link = state->cached_state_link.next;
+			link != &surface->cached; link = link->next) {
+		struct wlr_surface_state *next = wl_container_of(link, next, cached_state_link);
+		if (next->cached_state_locks > next->cached_state_expected_unlocks) {
+			break;
+		}
+		if (next->committed & WLR_SURFACE_STATE_BUFFER) {
+			return next->buffer != NULL;
+		}
+	}
+
+	return false;
+}
+
 uint32_t wlr_surface_lock_pending(struct wlr_surface *surface) {
 	surface->pending.cached_state_locks++;
 	return surface->pending.seq;
 }
 
-void wlr_surface_unlock_cached(struct wlr_surface *surface, uint32_t seq) {
+static struct wlr_surface_state *surface_find_locked_state(
+		struct wlr_surface *surface, uint32_t seq) {
 	if (surface->pending.seq == seq) {
-		assert(surface->pending.cached_state_locks > 0);
-		surface->pending.cached_state_locks--;
-		return;
+		return &surface->pending;
 	}
 
-	bool found = false;
 	struct wlr_surface_state *cached;
 	wl_list_for_each(cached, &surface->cached, cached_state_link) {
 		if (cached->seq == seq) {
-			found = true;
-			break;
+			return cached;
 		}
 	}
-	assert(found);
+	abort(); // unreachable
+}
+
+void wlr_surface_expect_unlock_cached(struct wlr_surface *surface, uint32_t seq) {
+	struct wlr_surface_state *state = surface_find_locked_state(surface, seq);
+	assert(state->cached_state_expected_unlocks < state->cached_state_locks);
+	state->cached_state_expected_unlocks++;
+}
 
+void wlr_surface_unlock_cached(struct wlr_surface *surface, uint32_t seq) {
+	struct wlr_surface_state *cached = surface_find_locked_state(surface, seq);
 	assert(cached->cached_state_locks > 0);
 	cached->cached_state_locks--;
+	if (cached->cached_state_expected_unlocks > 0) {
+		cached->cached_state_expected_unlocks--;
+	}
+
+	if (cached == &surface->pending) {
+		return;
+	}
 
 	if (cached->cached_state_locks != 0) {
 		return;
@@ -965,7 +1132,7 @@ void wlr_surface_unlock_cached(struct wlr_surface *surface, uint32_t seq) {
 			break;
 		}
 
-		surface_commit_state(surface, next);
+		surface_commit_state(surface, next, cached_state_is_superseded(surface, next));
 		surface_state_destroy_cached(next, surface);
 	}
 }
@@ -1122,6 +1289,62 @@ void wlr_surface_send_frame_done(struct wlr_surface *surface,
 	}
 }
 
+struct wlr_surface_tree_entry {
+	struct wlr_surface *surface;
+	int x, y;
+};
+
+void surface_invalidate_flattened_tree(struct wlr_surface *surface) {
+	// Ancestors include this surface in their flattened tree
+	while (surface != NULL) {
+		surface->flattened_tree_dirty = true;
+
+		struct wlr_subsurface *subsurface =
+			wlr_subsurface_try_from_wlr_surface(surface);
+		surface = subsurface != NULL ? subsurface->parent : NULL;
+	}
+}
+
+static bool surface_flatten_tree(struct wlr_surface *surface, int x, int y,
+		struct wl_array *tree) {
+	struct wlr_subsurface *subsurface;
+	wl_list_for_each(subsurface, &surface->current.subsurfaces_below, current.link) {
+		if (!subsurface->surface->mapped) {
+			continue;
+		}
+
+		struct wlr_subsurface_parent_state *state = &subsurface->current;
+		if (!surface_flatten_tree(subsurface->surface,
+				x + state->x, y + state->y, tree)) {
+			return false;
+		}
+	}
+
+	struct wlr_surface_tree_entry *entry = wl_array_add(tree, sizeof(*entry));
+	if (entry == NULL) {
+		return false;
+	}
+	*entry = (struct wlr_surface_tree_entry){
+		.surface = surface,
+		.x = x,
+		.y = y,
+	};
+
+	wl_list_for_each(subsurface, &surface->current.subsurfaces_above, current.link) {
+		if (!subsurface->surface->mapped) {
+			continue;
+		}
+
+		struct wlr_subsurface_parent_state *state = &subsurface->current;
+		if (!surface_flatten_tree(subsurface->surface,
+				x + state->x, y + state->y, tree)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static void surface_for_each_surface(struct wlr_surface *surface, int x, int y,
 		wlr_surface_iterator_func_t iterator, void *user_data) {
 	struct wlr_subsurface *subsurface;
@@ -1156,7 +1379,29 @@ static void surface_for_each_surface(struct wlr_surface *surface, int x, int y,
 
 void wlr_surface_for_each_surface(struct wlr_surface *surface,
 		wlr_surface_iterator_func_t iterator, void *user_data) {
-	surface_for_each_surface(surface, 0, 0, iterator, user_data);
+	if (surface->flattened_tree_dirty) {
+		if (surface->flattened_tree_iterating > 0) {
+			// The iterator changed the tree, don't pull the array from under
+			// the outer iteration
+			surface_for_each_surface(surface, 0, 0, iterator, user_data);
+			return;
+		}
+
+		surface->flattened_tree.size = 0;
+		if (!surface_flatten_tree(surface, 0, 0, &surface->flattened_tree)) {
+			wlr_log(WLR_ERROR, "Failed to flatten surface tree");
+			surface_for_each_surface(surface, 0, 0, iterator, user_data);
+			return;
+		}
+		surface->flattened_tree_dirty = false;
+	}
+
+	surface->flattened_tree_iterating++;
+	struct wlr_surface_tree_entry *entry;
+	wl_array_for_each(entry, &surface->flattened_tree) {
+		iterator(entry->surface, entry->x, entry->y, user_data);
+	}
+	surface->flattened_tree_iterating--;
 }
 
 struct bound_acc {
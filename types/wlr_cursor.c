@@ -19,6 +19,25 @@
 #include "types/wlr_buffer.h"
 #include "types/wlr_output.h"
 
+#define CURSOR_TEXTURE_CACHE_SIZE 32
+
+/**
+ * Last position of a touch point or tablet tool, used to predict motion.
+ */
+struct wlr_cursor_motion_track {
+	double x, y;
+	uint32_t time_msec;
+	double vx, vy; // per millisecond
+	bool valid;
+};
+
+struct wlr_cursor_touch_point {
+	int32_t touch_id;
+	struct wlr_touch_motion_event pending_motion;
+	bool has_pending_motion;
+	struct wlr_cursor_motion_track track;
+};
+
 struct wlr_cursor_device {
 	struct wlr_cursor *cursor;
 	struct wlr_input_device *device;
@@ -52,6 +71,24 @@ struct wlr_cursor_device {
 	struct wl_listener tablet_tool_button;
 
 	struct wl_listener destroy;
+
+	// Relative motion waiting to be emitted, when coalescing is enabled
+	struct wlr_pointer_motion_event pending_motion;
+	bool has_pending_motion;
+	bool has_pending_frame; // deferred until the pending motion is emitted
+	uint32_t last_motion_msec; // time of the last emitted motion
+	struct wl_event_source *motion_timer;
+
+	// Touch points seen while coalescing touch motion
+	struct wl_array touch_points; // struct wlr_cursor_touch_point
+
+	// Tablet tool axis event waiting to be emitted
+	struct wlr_tablet_tool_axis_event pending_axis;
+	bool has_pending_axis;
+	struct wlr_cursor_motion_track tablet_track;
+
+	// Set to true when the device is destroyed while flushing motion
+	bool *flush_destroyed;
 };
 
 struct wlr_cursor_output_cursor {
@@ -70,6 +107,24 @@ struct wlr_cursor_output_cursor {
 	struct wl_event_source *xcursor_timer;
 };
 
+/**
+ * A texture uploaded for a cursor buffer or XCursor image.
+ */
+struct wlr_cursor_texture {
+	struct wlr_cursor_state *state;
+	struct wlr_renderer *renderer;
+	struct wlr_texture *texture;
+
+	// Exactly one of these is set
+	struct wlr_buffer *buffer; // locked
+	const struct wlr_xcursor_image *xcursor_image;
+	// The XCursor image may have been destroyed, never match it again
+	bool stale;
+
+	struct wl_list link; // wlr_cursor_state.textures
+	struct wl_listener renderer_destroy;
+};
+
 struct wlr_cursor_state {
 	struct wlr_cursor cursor;
 
@@ -101,6 +156,17 @@ struct wlr_cursor_state {
 	// only when using an XCursor as the cursor image
 	struct wlr_xcursor_manager *xcursor_manager;
 	char *xcursor_name;
+
+	// Textures of buffers and XCursor images, shared by all outputs using the
+	// same renderer. Most recently used first.
+	struct wl_list textures; // wlr_cursor_texture.link
+	size_t textures_len;
+	// XCursor manager the cached XCursor images belong to
+	struct wlr_xcursor_manager *textures_xcursor_manager;
+	struct wl_listener textures_xcursor_manager_destroy;
+
+	bool coalesce_motion;
+	struct wlr_cursor_motion_coalescing_options coalescing;
 };
 
 struct wlr_cursor *wlr_cursor_create(void) {
@@ -115,6 +181,7 @@ struct wlr_cursor *wlr_cursor_create(void) {
 
 	wl_list_init(&cur->state->devices);
 	wl_list_init(&cur->state->output_cursors);
+	wl_list_init(&cur->state->textures);
 
 	// pointer signals
 	wl_signal_init(&cur->events.motion);
@@ -146,6 +213,7 @@ struct wlr_cursor *wlr_cursor_create(void) {
 
 	wl_list_init(&cur->state->surface_destroy.link);
 	wl_list_init(&cur->state->surface_commit.link);
+	wl_list_init(&cur->state->textures_xcursor_manager_destroy.link);
 
 	cur->x = 100;
 	cur->y = 100;
@@ -153,6 +221,132 @@ struct wlr_cursor *wlr_cursor_create(void) {
 	return cur;
 }
 
+static void cursor_texture_destroy(struct wlr_cursor_texture *cursor_texture) {
+	wl_list_remove(&cursor_texture->renderer_destroy.link);
+	wl_list_remove(&cursor_texture->link);
+	cursor_texture->state->textures_len--;
+	wlr_texture_destroy(cursor_texture->texture);
+	wlr_buffer_unlock(cursor_texture->buffer);
+	free(cursor_texture);
+}
+
+static void cursor_texture_handle_renderer_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_cursor_texture *cursor_texture =
+		wl_container_of(listener, cursor_texture, renderer_destroy);
+	cursor_texture_destroy(cursor_texture);
+}
+
+static bool cursor_texture_in_use(struct wlr_cursor_texture *cursor_texture) {
+	struct wlr_cursor_output_cursor *output_cursor;
+	wl_list_for_each(output_cursor, &cursor_texture->state->output_cursors, link) {
+		if (output_cursor->output_cursor->texture == cursor_texture->texture) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void cursor_evict_textures(struct wlr_cursor_state *state) {
+	struct wlr_cursor_texture *cursor_texture, *tmp;
+	wl_list_for_each_reverse_safe(cursor_texture, tmp, &state->textures, link) {
+		if (state->textures_len <= CURSOR_TEXTURE_CACHE_SIZE) {
+			break;
+		}
+		if (!cursor_texture_in_use(cursor_texture)) {
+			cursor_texture_destroy(cursor_texture);
+		}
+	}
+
+	wl_list_for_each_safe(cursor_texture, tmp, &state->textures, link) {
+		if (cursor_texture->stale && !cursor_texture_in_use(cursor_texture)) {
+			cursor_texture_destroy(cursor_texture);
+		}
+	}
+}
+
+/**
+ * Mark the cached textures of a buffer, or of all XCursor images if buffer is
+ * NULL, as stale. Stale textures are never returned by cursor_get_texture(),
+ * and are destroyed once they aren't in use anymore.
+ */
+static void cursor_invalidate_textures(struct wlr_cursor_state *state,
+		struct wlr_buffer *buffer) {
+	struct wlr_cursor_texture *cursor_texture;
+	wl_list_for_each(cursor_texture, &state->textures, link) {
+		if (cursor_texture->buffer == buffer) {
+			cursor_texture->stale = true;
+		}
+	}
+}
+
+static void cursor_handle_textures_xcursor_manager_destroy(
+		struct wl_listener *listener, void *data) {
+	struct wlr_cursor_state *state =
+		wl_container_of(listener, state, textures_xcursor_manager_destroy);
+	// The images are about to be freed, and their addresses may be re-used
+	cursor_invalidate_textures(state, NULL);
+	wl_list_remove(&state->textures_xcursor_manager_destroy.link);
+	wl_list_init(&state->textures_xcursor_manager_destroy.link);
+	state->textures_xcursor_manager = NULL;
+}
+
+/**
+ * Get the texture of a cursor buffer or XCursor image, uploading it if it
+ * isn't cached yet. The texture is owned by the cache.
+ */
+static struct wlr_texture *cursor_get_texture(struct wlr_cursor_state *state,
+		struct wlr_renderer *renderer, struct wlr_buffer *buffer,
+		const struct wlr_xcursor_image *xcursor_image) {
+	assert((buffer == NULL) != (xcursor_image == NULL));
+
+	struct wlr_cursor_texture *cursor_texture;
+	wl_list_for_each(cursor_texture, &state->textures, link) {
+		if (cursor_texture->renderer == renderer && !cursor_texture->stale &&
+				cursor_texture->buffer == buffer &&
+				cursor_texture->xcursor_image == xcursor_image) {
+			wl_list_remove(&cursor_texture->link);
+			wl_list_insert(&state->textures, &cursor_texture->link);
+			return cursor_texture->texture;
+		}
+	}
+
+	cursor_texture = calloc(1, sizeof(*cursor_texture));
+	if (cursor_texture == NULL) {
+		return NULL;
+	}
+
+	if (buffer != NULL) {
+		cursor_texture->texture = wlr_texture_from_buffer(renderer, buffer);
+	} else {
+		struct wlr_readonly_data_buffer *ro_buffer = readonly_data_buffer_create(
+			DRM_FORMAT_ARGB8888, 4 * xcursor_image->width, xcursor_image->width,
+			xcursor_image->height, xcursor_image->buffer);
+		if (ro_buffer != NULL) {
+			cursor_texture->texture = wlr_texture_from_buffer(renderer, &ro_buffer->base);
+			wlr_buffer_drop(&ro_buffer->base);
+		}
+	}
+	if (cursor_texture->texture == NULL) {
+		free(cursor_texture);
+		return NULL;
+	}
+
+	cursor_texture->state = state;
+	cursor_texture->renderer = renderer;
+	cursor_texture->buffer = buffer != NULL ? wlr_buffer_lock(buffer) : NULL;
+	cursor_texture->xcursor_image = xcursor_image;
+
+	cursor_texture->renderer_destroy.notify = cursor_texture_handle_renderer_destroy;
+	wl_signal_add(&renderer->events.destroy, &cursor_texture->renderer_destroy);
+
+	wl_list_insert(&state->textures, &cursor_texture->link);
+	state->textures_len++;
+	cursor_evict_textures(state);
+
+	return cursor_texture->texture;
+}
+
 static void cursor_output_cursor_reset_image(struct wlr_cursor_output_cursor *output_cursor);
 
 static void output_cursor_destroy(struct wlr_cursor_output_cursor *output_cursor) {
@@ -182,7 +376,189 @@ static void cursor_detach_output_layout(struct wlr_cursor *cur) {
 	cur->state->layout = NULL;
 }
 
+static void motion_track_update(struct wlr_cursor_motion_track *track,
+		double x, double y, uint32_t time_msec) {
+	uint32_t dt = time_msec - track->time_msec;
+	if (track->valid && dt > 0) {
+		track->vx = (x - track->x) / dt;
+		track->vy = (y - track->y) / dt;
+	} else if (!track->valid) {
+		track->vx = track->vy = 0;
+	}
+	track->x = x;
+	track->y = y;
+	track->time_msec = time_msec;
+	track->valid = true;
+}
+
+static double predict_coord(double value, double velocity, uint32_t horizon_ms) {
+	// Positions are normalized, don't extrapolate past the edges
+	double predicted = value + velocity * horizon_ms;
+	if (predicted < 0) {
+		return 0;
+	} else if (predicted > 1) {
+		return 1;
+	}
+	return predicted;
+}
+
+static struct wlr_cursor_touch_point *cursor_device_get_touch_point(
+		struct wlr_cursor_device *c_device, int32_t touch_id, bool create) {
+	struct wlr_cursor_touch_point *point;
+	wl_array_for_each(point, &c_device->touch_points) {
+		if (point->touch_id == touch_id) {
+			return point;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	point = wl_array_add(&c_device->touch_points, sizeof(*point));
+	if (point == NULL) {
+		return NULL;
+	}
+	*point = (struct wlr_cursor_touch_point){ .touch_id = touch_id };
+	return point;
+}
+
+static void cursor_device_remove_touch_point(struct wlr_cursor_device *c_device,
+		int32_t touch_id) {
+	struct wlr_cursor_touch_point *point =
+		cursor_device_get_touch_point(c_device, touch_id, false);
+	if (point == NULL) {
+		return;
+	}
+	struct wlr_cursor_touch_point *last = (struct wlr_cursor_touch_point *)
+		((char *)c_device->touch_points.data + c_device->touch_points.size) - 1;
+	*point = *last;
+	c_device->touch_points.size -= sizeof(*point);
+}
+
+/**
+ * Emit the pending motion events of a device. Event handlers may destroy the
+ * device: false is returned in that case, and the device must not be accessed
+ * anymore.
+ */
+static bool cursor_device_flush_motion(struct wlr_cursor_device *c_device) {
+	struct wlr_cursor *cursor = c_device->cursor;
+	uint32_t prediction_ms = cursor->state->coalescing.prediction_ms;
+
+	if (c_device->motion_timer != NULL) {
+		wl_event_source_timer_update(c_device->motion_timer, 0);
+	}
+
+	// Take the pending events out of the device before emitting any of them
+	bool has_motion = c_device->has_pending_motion;
+	struct wlr_pointer_motion_event motion = c_device->pending_motion;
+	c_device->has_pending_motion = false;
+	if (has_motion) {
+		c_device->last_motion_msec = motion.time_msec;
+	}
+
+	struct wl_array touch_motions; // struct wlr_touch_motion_event
+	wl_array_init(&touch_motions);
+	struct wlr_cursor_touch_point *point;
+	wl_array_for_each(point, &c_device->touch_points) {
+		if (!point->has_pending_motion) {
+			continue;
+		}
+		point->has_pending_motion = false;
+		struct wlr_touch_motion_event *event =
+			wl_array_add(&touch_motions, sizeof(*event));
+		if (event == NULL) {
+			wlr_log(WLR_ERROR, "Allocation failed");
+			continue;
+		}
+		*event = point->pending_motion;
+		c_device->last_motion_msec = event->time_msec;
+		if (prediction_ms > 0) {
+			event->x = predict_coord(event->x, point->track.vx, prediction_ms);
+			event->y = predict_coord(event->y, point->track.vy, prediction_ms);
+		}
+	}
+
+	bool has_axis = c_device->has_pending_axis;
+	struct wlr_tablet_tool_axis_event axis = c_device->pending_axis;
+	c_device->has_pending_axis = false;
+	if (has_axis) {
+		c_device->last_motion_msec = axis.time_msec;
+		if (prediction_ms > 0) {
+			struct wlr_cursor_motion_track *track = &c_device->tablet_track;
+			if (axis.updated_axes & WLR_TABLET_TOOL_AXIS_X) {
+				axis.x = predict_coord(axis.x, track->vx, prediction_ms);
+			}
+			if (axis.updated_axes & WLR_TABLET_TOOL_AXIS_Y) {
+				axis.y = predict_coord(axis.y, track->vy, prediction_ms);
+			}
+		}
+	}
+
+	bool has_frame = c_device->has_pending_frame;
+	bool is_touch = c_device->device->type == WLR_INPUT_DEVICE_TOUCH;
+	c_device->has_pending_frame = false;
+
+	bool *prev_destroyed = c_device->flush_destroyed;
+	bool destroyed = false;
+	c_device->flush_destroyed = &destroyed;
+
+	if (has_motion) {
+		wl_signal_emit_mutable(&cursor->events.motion, &motion);
+	}
+	struct wlr_touch_motion_event *touch_motion;
+	wl_array_for_each(touch_motion, &touch_motions) {
+		if (destroyed) {
+			break;
+		}
+		wl_signal_emit_mutable(&cursor->events.touch_motion, touch_motion);
+	}
+	wl_array_release(&touch_motions);
+	if (has_axis && !destroyed) {
+		wl_signal_emit_mutable(&cursor->events.tablet_tool_axis, &axis);
+	}
+	if (has_frame && !destroyed) {
+		if (is_touch) {
+			wl_signal_emit_mutable(&cursor->events.touch_frame, NULL);
+		} else {
+			wl_signal_emit_mutable(&cursor->events.frame, cursor);
+		}
+	}
+
+	if (destroyed) {
+		if (prev_destroyed != NULL) {
+			*prev_destroyed = true;
+		}
+		return false;
+	}
+	c_device->flush_destroyed = prev_destroyed;
+	return true;
+}
+
+static bool cursor_device_has_pending_motion(struct wlr_cursor_device *c_device) {
+	if (c_device->has_pending_motion || c_device->has_pending_axis ||
+			c_device->has_pending_frame) {
+		return true;
+	}
+	struct wlr_cursor_touch_point *point;
+	wl_array_for_each(point, &c_device->touch_points) {
+		if (point->has_pending_motion) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int cursor_device_handle_motion_timer(void *data) {
+	struct wlr_cursor_device *c_device = data;
+	cursor_device_flush_motion(c_device);
+	return 0;
+}
+
 static void cursor_device_destroy(struct wlr_cursor_device *c_device) {
+	if (c_device->flush_destroyed != NULL) {
+		*c_device->flush_destroyed = true;
+	}
+
 	struct wlr_input_device *dev = c_device->device;
 	switch (dev->type) {
 	case WLR_INPUT_DEVICE_POINTER:
@@ -217,6 +593,11 @@ static void cursor_device_destroy(struct wlr_cursor_device *c_device) {
 		abort(); // unreachable
 	}
 
+	if (c_device->motion_timer != NULL) {
+		wl_event_source_remove(c_device->motion_timer);
+	}
+	wl_array_release(&c_device->touch_points);
+
 	wl_list_remove(&c_device->link);
 	wl_list_remove(&c_device->destroy.link);
 	free(c_device);
@@ -245,6 +626,37 @@ static void cursor_reset_image(struct wlr_cursor *cur) {
 	cur->state->xcursor_name = NULL;
 }
 
+void wlr_cursor_set_motion_coalescing(struct wlr_cursor *cur,
+		const struct wlr_cursor_motion_coalescing_options *options) {
+	struct wlr_cursor_state *state = cur->state;
+
+	// Events generated by handlers while flushing are emitted right away
+	state->coalesce_motion = false;
+
+	struct wlr_cursor_device *device;
+restart:
+	wl_list_for_each(device, &state->devices, link) {
+		if (device->motion_timer != NULL) {
+			wl_event_source_remove(device->motion_timer);
+			device->motion_timer = NULL;
+		}
+		if (cursor_device_has_pending_motion(device)) {
+			// Handlers may detach or destroy any device
+			cursor_device_flush_motion(device);
+			goto restart;
+		}
+	}
+
+	if (options == NULL) {
+		state->coalescing = (struct wlr_cursor_motion_coalescing_options){0};
+		return;
+	}
+
+	assert(options->interval_ms == 0 || options->event_loop != NULL);
+	state->coalesce_motion = true;
+	state->coalescing = *options;
+}
+
 void wlr_cursor_destroy(struct wlr_cursor *cur) {
 	cursor_reset_image(cur);
 	cursor_detach_output_layout(cur);
@@ -254,6 +666,12 @@ void wlr_cursor_destroy(struct wlr_cursor *cur) {
 		cursor_device_destroy(device);
 	}
 
+	struct wlr_cursor_texture *cursor_texture, *cursor_texture_tmp;
+	wl_list_for_each_safe(cursor_texture, cursor_texture_tmp, &cur->state->textures, link) {
+		cursor_texture_destroy(cursor_texture);
+	}
+	wl_list_remove(&cur->state->textures_xcursor_manager_destroy.link);
+
 	free(cur->state);
 }
 
@@ -444,6 +862,9 @@ void wlr_cursor_set_buffer(struct wlr_cursor *cur, struct wlr_buffer *buffer,
 	cursor_reset_image(cur);
 
 	if (buffer != NULL) {
+		// The buffer may have been modified since its textures were cached
+		cursor_invalidate_textures(cur->state, buffer);
+
 		cur->state->buffer = wlr_buffer_lock(buffer);
 		cur->state->buffer_hotspot.x = hotspot_x;
 		cur->state->buffer_hotspot.y = hotspot_y;
@@ -469,14 +890,23 @@ static int handle_xcursor_timer(void *data) {
 
 static void output_cursor_set_xcursor_image(struct wlr_cursor_output_cursor *output_cursor, size_t i) {
 	struct wlr_xcursor_image *image = output_cursor->xcursor->images[i];
+	struct wlr_output *output = output_cursor->output_cursor->output;
+	assert(output->renderer != NULL);
 
-	struct wlr_readonly_data_buffer *ro_buffer = readonly_data_buffer_create(
-		DRM_FORMAT_ARGB8888, 4 * image->width, image->width, image->height, image->buffer);
-	if (ro_buffer == NULL) {
+	struct wlr_texture *texture = cursor_get_texture(output_cursor->cursor->state,
+		output->renderer, NULL, image);
+	if (texture == NULL) {
 		return;
 	}
-	wlr_output_cursor_set_buffer(output_cursor->output_cursor, &ro_buffer->base, image->hotspot_x, image->hotspot_y);
-	wlr_buffer_drop(&ro_buffer->base);
+
+	struct wlr_fbox src_box = {
+		.width = texture->width,
+		.height = texture->height,
+	};
+	output_cursor_set_texture(output_cursor->output_cursor, texture, false,
+		&src_box, texture->width / output->scale, texture->height / output->scale,
+		WL_OUTPUT_TRANSFORM_NORMAL, image->hotspot_x / output->scale,
+		image->hotspot_y / output->scale);
 
 	output_cursor->xcursor_index = i;
 
@@ -520,7 +950,7 @@ static void cursor_output_cursor_update(struct wlr_cursor_output_cursor *output_
 		struct wlr_fbox src_box = {0};
 		int dst_width = 0, dst_height = 0;
 		if (buffer != NULL) {
-			texture = wlr_texture_from_buffer(renderer, buffer);
+			texture = cursor_get_texture(cur->state, renderer, buffer, NULL);
 			if (texture) {
 				src_box = (struct wlr_fbox){
 					.width = texture->width,
@@ -532,7 +962,7 @@ static void cursor_output_cursor_update(struct wlr_cursor_output_cursor *output_
 			}
 		}
 
-		output_cursor_set_texture(output_cursor->output_cursor, texture, true,
+		output_cursor_set_texture(output_cursor->output_cursor, texture, false,
 			&src_box, dst_width, dst_height, WL_OUTPUT_TRANSFORM_NORMAL,
 			hotspot_x, hotspot_y);
 	} else if (cur->state->surface != NULL) {
@@ -621,6 +1051,18 @@ void wlr_cursor_set_xcursor(struct wlr_cursor *cur,
 
 	cursor_reset_image(cur);
 
+	if (manager != cur->state->textures_xcursor_manager) {
+		// Only cache the images of a single manager, textures are
+		// invalidated when it's destroyed
+		cursor_invalidate_textures(cur->state, NULL);
+		wl_list_remove(&cur->state->textures_xcursor_manager_destroy.link);
+		cur->state->textures_xcursor_manager_destroy.notify =
+			cursor_handle_textures_xcursor_manager_destroy;
+		wl_signal_add(&manager->events.destroy,
+			&cur->state->textures_xcursor_manager_destroy);
+		cur->state->textures_xcursor_manager = manager;
+	}
+
 	cur->state->xcursor_manager = manager;
 	cur->state->xcursor_name = strdup(name);
 
@@ -678,7 +1120,26 @@ static void handle_pointer_motion(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_motion_event *event = data;
 	struct wlr_cursor_device *device =
 		wl_container_of(listener, device, motion);
-	wl_signal_emit_mutable(&device->cursor->events.motion, event);
+
+	if (!device->cursor->state->coalesce_motion) {
+		wl_signal_emit_mutable(&device->cursor->events.motion, event);
+		return;
+	}
+
+	// Deltas are summed so that relative motion, accelerated or not, is
+	// preserved
+	struct wlr_pointer_motion_event *pending = &device->pending_motion;
+	if (!device->has_pending_motion) {
+		*pending = *event;
+		device->has_pending_motion = true;
+		return;
+	}
+	pending->pointer = event->pointer;
+	pending->time_msec = event->time_msec;
+	pending->delta_x += event->delta_x;
+	pending->delta_y += event->delta_y;
+	pending->unaccel_dx += event->unaccel_dx;
+	pending->unaccel_dy += event->unaccel_dy;
 }
 
 static void apply_output_transform(double *x, double *y,
@@ -750,6 +1211,9 @@ static void handle_pointer_motion_absolute(struct wl_listener *listener,
 	if (output) {
 		apply_output_transform(&event->x, &event->y, output->transform);
 	}
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.motion_absolute, event);
 }
 
@@ -757,65 +1221,129 @@ static void handle_pointer_button(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_button_event *event = data;
 	struct wlr_cursor_device *device =
 		wl_container_of(listener, device, button);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.button, event);
 }
 
 static void handle_pointer_axis(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_axis_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, axis);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.axis, event);
 }
 
+/**
+ * Flush the pending motion now, or once the coalescing interval has elapsed
+ * since the last emitted motion.
+ */
+static void cursor_device_schedule_flush(struct wlr_cursor_device *device,
+		uint32_t time_msec) {
+	struct wlr_cursor_state *state = device->cursor->state;
+
+	uint32_t interval_ms = state->coalescing.interval_ms;
+	uint32_t elapsed_ms = time_msec - device->last_motion_msec;
+	if (interval_ms == 0 || elapsed_ms >= interval_ms) {
+		cursor_device_flush_motion(device);
+		return;
+	}
+
+	if (device->motion_timer == NULL) {
+		device->motion_timer = wl_event_loop_add_timer(state->coalescing.event_loop,
+			cursor_device_handle_motion_timer, device);
+		if (device->motion_timer == NULL) {
+			wlr_log(WLR_ERROR, "wl_event_loop_add_timer failed");
+			cursor_device_flush_motion(device);
+			return;
+		}
+	}
+	wl_event_source_timer_update(device->motion_timer, interval_ms - elapsed_ms);
+}
+
 static void handle_pointer_frame(struct wl_listener *listener, void *data) {
 	struct wlr_cursor_device *device = wl_container_of(listener, device, frame);
-	wl_signal_emit_mutable(&device->cursor->events.frame, device->cursor);
+
+	if (!device->has_pending_motion) {
+		wl_signal_emit_mutable(&device->cursor->events.frame, device->cursor);
+		return;
+	}
+
+	device->has_pending_frame = true;
+	cursor_device_schedule_flush(device, device->pending_motion.time_msec);
 }
 
 static void handle_pointer_swipe_begin(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_swipe_begin_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, swipe_begin);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.swipe_begin, event);
 }
 
 static void handle_pointer_swipe_update(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_swipe_update_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, swipe_update);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.swipe_update, event);
 }
 
 static void handle_pointer_swipe_end(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_swipe_end_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, swipe_end);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.swipe_end, event);
 }
 
 static void handle_pointer_pinch_begin(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_pinch_begin_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, pinch_begin);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.pinch_begin, event);
 }
 
 static void handle_pointer_pinch_update(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_pinch_update_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, pinch_update);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.pinch_update, event);
 }
 
 static void handle_pointer_pinch_end(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_pinch_end_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, pinch_end);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.pinch_end, event);
 }
 
 static void handle_pointer_hold_begin(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_hold_begin_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, hold_begin);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.hold_begin, event);
 }
 
 static void handle_pointer_hold_end(struct wl_listener *listener, void *data) {
 	struct wlr_pointer_hold_end_event *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, hold_end);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.hold_end, event);
 }
 
@@ -823,6 +1351,10 @@ static void handle_touch_up(struct wl_listener *listener, void *data) {
 	struct wlr_touch_up_event *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, touch_up);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
+	cursor_device_remove_touch_point(device, event->touch_id);
 	wl_signal_emit_mutable(&device->cursor->events.touch_up, event);
 }
 
@@ -836,6 +1368,21 @@ static void handle_touch_down(struct wl_listener *listener, void *data) {
 	if (output) {
 		apply_output_transform(&event->x, &event->y, output->transform);
 	}
+
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
+	struct wlr_cursor_state *state = device->cursor->state;
+	if (state->coalesce_motion && state->coalescing.touch) {
+		struct wlr_cursor_touch_point *point =
+			cursor_device_get_touch_point(device, event->touch_id, true);
+		if (point != NULL) {
+			point->track = (struct wlr_cursor_motion_track){0};
+			motion_track_update(&point->track, event->x, event->y,
+				event->time_msec);
+		}
+	}
+
 	wl_signal_emit_mutable(&device->cursor->events.touch_down, event);
 }
 
@@ -849,20 +1396,54 @@ static void handle_touch_motion(struct wl_listener *listener, void *data) {
 	if (output) {
 		apply_output_transform(&event->x, &event->y, output->transform);
 	}
-	wl_signal_emit_mutable(&device->cursor->events.touch_motion, event);
+
+	struct wlr_cursor_state *state = device->cursor->state;
+	struct wlr_cursor_touch_point *point = NULL;
+	if (state->coalesce_motion && state->coalescing.touch) {
+		point = cursor_device_get_touch_point(device, event->touch_id, true);
+	}
+	if (point == NULL) {
+		wl_signal_emit_mutable(&device->cursor->events.touch_motion, event);
+		return;
+	}
+
+	// Positions are absolute, only the latest one matters
+	motion_track_update(&point->track, event->x, event->y, event->time_msec);
+	point->pending_motion = *event;
+	point->has_pending_motion = true;
 }
 
 static void handle_touch_cancel(struct wl_listener *listener, void *data) {
 	struct wlr_touch_cancel_event *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, touch_cancel);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
+	cursor_device_remove_touch_point(device, event->touch_id);
 	wl_signal_emit_mutable(&device->cursor->events.touch_cancel, event);
 }
 
 static void handle_touch_frame(struct wl_listener *listener, void *data) {
 	struct wlr_cursor_device *device =
 		wl_container_of(listener, device, touch_frame);
-	wl_signal_emit_mutable(&device->cursor->events.touch_frame, NULL);
+
+	bool has_pending_motion = false;
+	uint32_t time_msec = 0;
+	struct wlr_cursor_touch_point *point;
+	wl_array_for_each(point, &device->touch_points) {
+		if (point->has_pending_motion) {
+			has_pending_motion = true;
+			time_msec = point->pending_motion.time_msec;
+		}
+	}
+	if (!has_pending_motion) {
+		wl_signal_emit_mutable(&device->cursor->events.touch_frame, NULL);
+		return;
+	}
+
+	device->has_pending_frame = true;
+	cursor_device_schedule_flush(device, time_msec);
 }
 
 static void handle_tablet_tool_tip(struct wl_listener *listener, void *data) {
@@ -875,6 +1456,9 @@ static void handle_tablet_tool_tip(struct wl_listener *listener, void *data) {
 	if (output) {
 		apply_output_transform(&event->x, &event->y, output->transform);
 	}
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.tablet_tool_tip, event);
 }
 
@@ -910,7 +1494,70 @@ static void handle_tablet_tool_axis(struct wl_listener *listener, void *data) {
 		}
 	}
 
-	wl_signal_emit_mutable(&device->cursor->events.tablet_tool_axis, event);
+	struct wlr_cursor_state *state = device->cursor->state;
+	if (!state->coalesce_motion || !state->coalescing.tablet) {
+		wl_signal_emit_mutable(&device->cursor->events.tablet_tool_axis, event);
+		return;
+	}
+
+	if (device->has_pending_axis && device->pending_axis.tool != event->tool) {
+		if (!cursor_device_flush_motion(device)) {
+			return;
+		}
+		device->tablet_track = (struct wlr_cursor_motion_track){0};
+	}
+
+	struct wlr_cursor_motion_track *track = &device->tablet_track;
+	if (event->updated_axes & (WLR_TABLET_TOOL_AXIS_X | WLR_TABLET_TOOL_AXIS_Y)) {
+		double x = event->updated_axes & WLR_TABLET_TOOL_AXIS_X ?
+			event->x : track->x;
+		double y = event->updated_axes & WLR_TABLET_TOOL_AXIS_Y ?
+			event->y : track->y;
+		motion_track_update(track, x, y, event->time_msec);
+	}
+
+	if (!device->has_pending_axis) {
+		device->pending_axis = *event;
+		device->has_pending_axis = true;
+	} else {
+		// Relative axes are summed, absolute axes keep their latest value
+		struct wlr_tablet_tool_axis_event *pending = &device->pending_axis;
+		uint32_t axes = event->updated_axes;
+		pending->time_msec = event->time_msec;
+		pending->updated_axes |= axes;
+		if (axes & WLR_TABLET_TOOL_AXIS_X) {
+			pending->x = event->x;
+			pending->dx += event->dx;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_Y) {
+			pending->y = event->y;
+			pending->dy += event->dy;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_DISTANCE) {
+			pending->distance = event->distance;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_PRESSURE) {
+			pending->pressure = event->pressure;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_TILT_X) {
+			pending->tilt_x = event->tilt_x;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_TILT_Y) {
+			pending->tilt_y = event->tilt_y;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_ROTATION) {
+			pending->rotation = event->rotation;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_SLIDER) {
+			pending->slider = event->slider;
+		}
+		if (axes & WLR_TABLET_TOOL_AXIS_WHEEL) {
+			pending->wheel_delta += event->wheel_delta;
+		}
+	}
+
+	// Tablet tools don't have frames, only the interval delays events
+	cursor_device_schedule_flush(device, event->time_msec);
 }
 
 static void handle_tablet_tool_button(struct wl_listener *listener,
@@ -918,6 +1565,9 @@ static void handle_tablet_tool_button(struct wl_listener *listener,
 	struct wlr_tablet_tool_button *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, tablet_tool_button);
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
 	wl_signal_emit_mutable(&device->cursor->events.tablet_tool_button, event);
 }
 
@@ -932,6 +1582,12 @@ static void handle_tablet_tool_proximity(struct wl_listener *listener,
 	if (output) {
 		apply_output_transform(&event->x, &event->y, output->transform);
 	}
+	if (!cursor_device_flush_motion(device)) {
+		return;
+	}
+	if (event->state == WLR_TABLET_TOOL_PROXIMITY_OUT) {
+		device->tablet_track = (struct wlr_cursor_motion_track){0};
+	}
 	wl_signal_emit_mutable(&device->cursor->events.tablet_tool_proximity, event);
 }
 
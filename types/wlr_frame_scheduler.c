@@ -0,0 +1,195 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_frame_scheduler.h>
+#include <wlr/types/wlr_output.h>
+#include "types/wlr_output.h"
+#include "util/time.h"
+
+#define DEFAULT_MARGIN_NS 1000000 // 1ms
+
+static void scheduler_send_frame(struct wlr_frame_scheduler *scheduler) {
+	if (scheduler->output->enabled) {
+		wl_signal_emit_mutable(&scheduler->events.frame, NULL);
+	}
+}
+
+static int scheduler_handle_timer(void *data) {
+	struct wlr_frame_scheduler *scheduler = data;
+	scheduler->timer_armed = false;
+	// The compositor may have committed a frame in the meantime, the
+	// backend will send a new frame event once it's done
+	if (!scheduler->output->frame_pending) {
+		scheduler_send_frame(scheduler);
+	}
+	return 0;
+}
+
+static void scheduler_handle_output_frame(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_frame);
+
+	if (scheduler->timer_armed) {
+		return;
+	}
+
+	struct wlr_frame_scheduler_prediction prediction;
+	if (!wlr_frame_scheduler_predict(scheduler, &prediction)) {
+		scheduler_send_frame(scheduler);
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	int delay_ms = output_deadline_delay_ms(timespec_to_nsec(&prediction.frame),
+		timespec_to_nsec(&now));
+	if (delay_ms <= 0) {
+		scheduler_send_frame(scheduler);
+		return;
+	}
+
+	wl_event_source_timer_update(scheduler->timer, delay_ms);
+	scheduler->timer_armed = true;
+}
+
+static void scheduler_handle_output_present(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_present);
+	const struct wlr_output_event_present *event = data;
+
+	if (!event->presented) {
+		return;
+	}
+
+	output_update_vblank_timings(scheduler->output, event,
+		&scheduler->last_present, &scheduler->refresh_ns);
+}
+
+static void scheduler_handle_output_commit(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_commit);
+	const struct wlr_output_event_commit *event = data;
+
+	// The vblank timings are invalidated, wait for the next present event
+	if (event->state->committed & (WLR_OUTPUT_STATE_MODE | WLR_OUTPUT_STATE_ENABLED)) {
+		scheduler->refresh_ns = 0;
+	}
+}
+
+static void scheduler_addon_destroy(struct wlr_addon *addon) {
+	struct wlr_frame_scheduler *scheduler = wl_container_of(addon, scheduler, addon);
+	wlr_frame_scheduler_destroy(scheduler);
+}
+
+static const struct wlr_addon_interface scheduler_addon_impl = {
+	.name = "wlr_frame_scheduler",
+	.destroy = scheduler_addon_destroy,
+};
+
+struct wlr_frame_scheduler *wlr_frame_scheduler_create(struct wlr_output *output) {
+	struct wlr_frame_scheduler *scheduler = calloc(1, sizeof(*scheduler));
+	if (scheduler == NULL) {
+		return NULL;
+	}
+
+	scheduler->timer = wl_event_loop_add_timer(output->event_loop,
+		scheduler_handle_timer, scheduler);
+	if (scheduler->timer == NULL) {
+		free(scheduler);
+		return NULL;
+	}
+
+	scheduler->output = output;
+	scheduler->margin_ns = DEFAULT_MARGIN_NS;
+
+	wl_signal_init(&scheduler->events.frame);
+	wl_signal_init(&scheduler->events.destroy);
+
+	wlr_addon_init(&scheduler->addon, &output->addons, scheduler,
+		&scheduler_addon_impl);
+
+	scheduler->output_frame.notify = scheduler_handle_output_frame;
+	wl_signal_add(&output->events.frame, &scheduler->output_frame);
+	scheduler->output_present.notify = scheduler_handle_output_present;
+	wl_signal_add(&output->events.present, &scheduler->output_present);
+	scheduler->output_commit.notify = scheduler_handle_output_commit;
+	wl_signal_add(&output->events.commit, &scheduler->output_commit);
+
+	return scheduler;
+}
+
+void wlr_frame_scheduler_destroy(struct wlr_frame_scheduler *scheduler) {
+	if (scheduler == NULL) {
+		return;
+	}
+
+	wl_signal_emit_mutable(&scheduler->events.destroy, NULL);
+
+	assert(wl_list_empty(&scheduler->events.frame.listener_list));
+	assert(wl_list_empty(&scheduler->events.destroy.listener_list));
+
+	wlr_addon_finish(&scheduler->addon);
+	wl_list_remove(&scheduler->output_frame.link);
+	wl_list_remove(&scheduler->output_present.link);
+	wl_list_remove(&scheduler->output_commit.link);
+	wl_event_source_remove(scheduler->timer);
+	free(scheduler);
+}
+
+void wlr_frame_scheduler_set_margin(struct wlr_frame_scheduler *scheduler,
+		int64_t margin_ns) {
+	assert(margin_ns >= 0);
+	scheduler->margin_ns = margin_ns;
+}
+
+void wlr_frame_scheduler_record_render_duration(
+		struct wlr_frame_scheduler *scheduler, int64_t duration_ns) {
+	if (duration_ns < 0) {
+		return;
+	}
+
+	scheduler->render_durations[scheduler->render_durations_index] = duration_ns;
+	scheduler->render_durations_index =
+		(scheduler->render_durations_index + 1) % WLR_FRAME_SCHEDULER_HISTORY_LEN;
+	if (scheduler->render_durations_len < WLR_FRAME_SCHEDULER_HISTORY_LEN) {
+		scheduler->render_durations_len++;
+	}
+}
+
+bool wlr_frame_scheduler_predict(struct wlr_frame_scheduler *scheduler,
+		struct wlr_frame_scheduler_prediction *prediction) {
+	if (!scheduler->output->enabled || scheduler->refresh_ns <= 0 ||
+			scheduler->render_durations_len == 0) {
+		return false;
+	}
+
+	// Be conservative and assume the next frame will take as long as the
+	// slowest recent one
+	int64_t render_ns = 0;
+	for (size_t i = 0; i < scheduler->render_durations_len; i++) {
+		if (scheduler->render_durations[i] > render_ns) {
+			render_ns = scheduler->render_durations[i];
+		}
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t now_ns = timespec_to_nsec(&now);
+
+	// Pick the first vblank leaving enough time to render
+	int64_t budget_ns = render_ns + scheduler->margin_ns;
+	int64_t vblank_ns = output_predict_vblank(&scheduler->last_present,
+		scheduler->refresh_ns, now_ns, budget_ns);
+	int64_t frame_ns = vblank_ns - budget_ns;
+	if (budget_ns >= scheduler->refresh_ns) {
+		// Rendering takes longer than a refresh period, start right away
+		frame_ns = now_ns;
+	}
+
+	*prediction = (struct wlr_frame_scheduler_prediction){
+		.render_duration_ns = render_ns,
+	};
+	timespec_from_nsec(&prediction->present, vblank_ns);
+	timespec_from_nsec(&prediction->frame, frame_ns);
+	return true;
+}
@@ -0,0 +1,658 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/types/wlr_input_recorder.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_tablet_tool.h>
+#include <wlr/types/wlr_touch.h>
+#include <wlr/util/log.h>
+#include "types/wlr_input_recorder.h"
+#include "util/time.h"
+
+// Records are written to the file once the buffer grows past this size
+#define RECORDER_BUFFER_SIZE (64 * 1024)
+
+struct wlr_input_recorder_device {
+	struct wlr_input_recorder *recorder;
+	struct wlr_input_device *device;
+	uint16_t id;
+	struct wl_list link; // wlr_input_recorder.devices
+
+	struct wl_listener destroy;
+
+	// Depending on the device type, only some of these are used
+	struct wl_listener motion;
+	struct wl_listener motion_absolute;
+	struct wl_listener button;
+	struct wl_listener axis;
+	struct wl_listener frame;
+	struct wl_listener swipe_begin;
+	struct wl_listener swipe_update;
+	struct wl_listener swipe_end;
+	struct wl_listener pinch_begin;
+	struct wl_listener pinch_update;
+	struct wl_listener pinch_end;
+	struct wl_listener hold_begin;
+	struct wl_listener hold_end;
+	struct wl_listener key;
+	struct wl_listener modifiers;
+	struct wl_listener down;
+	struct wl_listener up;
+	struct wl_listener cancel;
+	struct wl_listener proximity;
+	struct wl_listener tip;
+};
+
+static uint64_t get_current_time_usec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now) / 1000;
+}
+
+static bool write_all(int fd, const char *data, size_t size) {
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool wlr_input_recorder_flush(struct wlr_input_recorder *recorder) {
+	if (recorder->failed) {
+		return false;
+	}
+
+	if (!write_all(recorder->fd, recorder->buffer.data, recorder->buffer.size)) {
+		wlr_log_errno(WLR_ERROR, "Failed to write input recording");
+		recorder->failed = true;
+	}
+	recorder->buffer.size = 0;
+	return !recorder->failed;
+}
+
+static void recorder_append(struct wlr_input_recorder *recorder,
+		const void *data, size_t size) {
+	if (recorder->failed || size == 0) {
+		return;
+	}
+
+	void *dst = wl_array_add(&recorder->buffer, size);
+	if (dst == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		recorder->failed = true;
+		return;
+	}
+	memcpy(dst, data, size);
+}
+
+static void recorder_write(struct wlr_input_recorder_device *device,
+		enum input_record_type type, const void *payload, size_t size) {
+	struct wlr_input_recorder *recorder = device->recorder;
+	struct input_record_header header = {
+		.type = type,
+		.device = device->id,
+		.size = size,
+		.time_usec = get_current_time_usec(),
+	};
+	recorder_append(recorder, &header, sizeof(header));
+	recorder_append(recorder, payload, size);
+
+	if (recorder->buffer.size >= RECORDER_BUFFER_SIZE) {
+		wlr_input_recorder_flush(recorder);
+	}
+}
+
+static void handle_motion(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, motion);
+	struct wlr_pointer_motion_event *event = data;
+	struct input_record_pointer_motion record = {
+		.time_msec = event->time_msec,
+		.delta_x = event->delta_x,
+		.delta_y = event->delta_y,
+		.unaccel_dx = event->unaccel_dx,
+		.unaccel_dy = event->unaccel_dy,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_MOTION, &record, sizeof(record));
+}
+
+static void handle_motion_absolute(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, motion_absolute);
+	struct wlr_pointer_motion_absolute_event *event = data;
+	struct input_record_pointer_motion_absolute record = {
+		.time_msec = event->time_msec,
+		.x = event->x,
+		.y = event->y,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_MOTION_ABSOLUTE,
+		&record, sizeof(record));
+}
+
+static void handle_pointer_button(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, button);
+	struct wlr_pointer_button_event *event = data;
+	struct input_record_pointer_button record = {
+		.time_msec = event->time_msec,
+		.button = event->button,
+		.state = event->state,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_BUTTON, &record, sizeof(record));
+}
+
+static void handle_axis(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, axis);
+	struct wlr_pointer_axis_event *event = data;
+	struct input_record_pointer_axis record = {
+		.time_msec = event->time_msec,
+		.source = event->source,
+		.orientation = event->orientation,
+		.relative_direction = event->relative_direction,
+		.delta_discrete = event->delta_discrete,
+		.delta = event->delta,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_AXIS, &record, sizeof(record));
+}
+
+static void handle_frame(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, frame);
+	enum input_record_type type =
+		device->device->type == WLR_INPUT_DEVICE_TOUCH ?
+		INPUT_RECORD_TOUCH_FRAME : INPUT_RECORD_POINTER_FRAME;
+	recorder_write(device, type, NULL, 0);
+}
+
+static void handle_swipe_begin(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, swipe_begin);
+	struct wlr_pointer_swipe_begin_event *event = data;
+	struct input_record_gesture_begin record = {
+		.time_msec = event->time_msec,
+		.fingers = event->fingers,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_SWIPE_BEGIN,
+		&record, sizeof(record));
+}
+
+static void handle_swipe_update(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, swipe_update);
+	struct wlr_pointer_swipe_update_event *event = data;
+	struct input_record_gesture_update record = {
+		.time_msec = event->time_msec,
+		.fingers = event->fingers,
+		.dx = event->dx,
+		.dy = event->dy,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_SWIPE_UPDATE,
+		&record, sizeof(record));
+}
+
+static void handle_swipe_end(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, swipe_end);
+	struct wlr_pointer_swipe_end_event *event = data;
+	struct input_record_gesture_end record = {
+		.time_msec = event->time_msec,
+		.cancelled = event->cancelled,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_SWIPE_END,
+		&record, sizeof(record));
+}
+
+static void handle_pinch_begin(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, pinch_begin);
+	struct wlr_pointer_pinch_begin_event *event = data;
+	struct input_record_gesture_begin record = {
+		.time_msec = event->time_msec,
+		.fingers = event->fingers,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_PINCH_BEGIN,
+		&record, sizeof(record));
+}
+
+static void handle_pinch_update(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, pinch_update);
+	struct wlr_pointer_pinch_update_event *event = data;
+	struct input_record_gesture_update record = {
+		.time_msec = event->time_msec,
+		.fingers = event->fingers,
+		.dx = event->dx,
+		.dy = event->dy,
+		.scale = event->scale,
+		.rotation = event->rotation,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_PINCH_UPDATE,
+		&record, sizeof(record));
+}
+
+static void handle_pinch_end(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, pinch_end);
+	struct wlr_pointer_pinch_end_event *event = data;
+	struct input_record_gesture_end record = {
+		.time_msec = event->time_msec,
+		.cancelled = event->cancelled,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_PINCH_END,
+		&record, sizeof(record));
+}
+
+static void handle_hold_begin(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, hold_begin);
+	struct wlr_pointer_hold_begin_event *event = data;
+	struct input_record_gesture_begin record = {
+		.time_msec = event->time_msec,
+		.fingers = event->fingers,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_HOLD_BEGIN,
+		&record, sizeof(record));
+}
+
+static void handle_hold_end(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, hold_end);
+	struct wlr_pointer_hold_end_event *event = data;
+	struct input_record_gesture_end record = {
+		.time_msec = event->time_msec,
+		.cancelled = event->cancelled,
+	};
+	recorder_write(device, INPUT_RECORD_POINTER_HOLD_END,
+		&record, sizeof(record));
+}
+
+static void handle_key(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, key);
+	struct wlr_keyboard_key_event *event = data;
+	struct input_record_keyboard_key record = {
+		.time_msec = event->time_msec,
+		.keycode = event->keycode,
+		.state = event->state,
+		.update_state = event->update_state,
+	};
+	recorder_write(device, INPUT_RECORD_KEYBOARD_KEY, &record, sizeof(record));
+}
+
+static void handle_modifiers(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, modifiers);
+	struct wlr_keyboard *keyboard = data;
+	struct input_record_keyboard_modifiers record = {
+		.depressed = keyboard->modifiers.depressed,
+		.latched = keyboard->modifiers.latched,
+		.locked = keyboard->modifiers.locked,
+		.group = keyboard->modifiers.group,
+	};
+	recorder_write(device, INPUT_RECORD_KEYBOARD_MODIFIERS,
+		&record, sizeof(record));
+}
+
+static void handle_touch_down(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, down);
+	struct wlr_touch_down_event *event = data;
+	struct input_record_touch record = {
+		.time_msec = event->time_msec,
+		.touch_id = event->touch_id,
+		.x = event->x,
+		.y = event->y,
+	};
+	recorder_write(device, INPUT_RECORD_TOUCH_DOWN, &record, sizeof(record));
+}
+
+static void handle_touch_up(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, up);
+	struct wlr_touch_up_event *event = data;
+	struct input_record_touch record = {
+		.time_msec = event->time_msec,
+		.touch_id = event->touch_id,
+	};
+	recorder_write(device, INPUT_RECORD_TOUCH_UP, &record, sizeof(record));
+}
+
+static void handle_touch_motion(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, motion);
+	struct wlr_touch_motion_event *event = data;
+	struct input_record_touch record = {
+		.time_msec = event->time_msec,
+		.touch_id = event->touch_id,
+		.x = event->x,
+		.y = event->y,
+	};
+	recorder_write(device, INPUT_RECORD_TOUCH_MOTION, &record, sizeof(record));
+}
+
+static void handle_touch_cancel(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, cancel);
+	struct wlr_touch_cancel_event *event = data;
+	struct input_record_touch record = {
+		.time_msec = event->time_msec,
+		.touch_id = event->touch_id,
+	};
+	recorder_write(device, INPUT_RECORD_TOUCH_CANCEL, &record, sizeof(record));
+}
+
+static struct input_record_tablet_tool tablet_tool_record(
+		struct wlr_tablet_tool *tool) {
+	uint32_t caps = 0;
+	if (tool->tilt) {
+		caps |= INPUT_RECORD_TABLET_TOOL_TILT;
+	}
+	if (tool->pressure) {
+		caps |= INPUT_RECORD_TABLET_TOOL_PRESSURE;
+	}
+	if (tool->distance) {
+		caps |= INPUT_RECORD_TABLET_TOOL_DISTANCE;
+	}
+	if (tool->rotation) {
+		caps |= INPUT_RECORD_TABLET_TOOL_ROTATION;
+	}
+	if (tool->slider) {
+		caps |= INPUT_RECORD_TABLET_TOOL_SLIDER;
+	}
+	if (tool->wheel) {
+		caps |= INPUT_RECORD_TABLET_TOOL_WHEEL;
+	}
+	return (struct input_record_tablet_tool){
+		.hardware_serial = tool->hardware_serial,
+		.hardware_wacom = tool->hardware_wacom,
+		.type = tool->type,
+		.capabilities = caps,
+	};
+}
+
+static void handle_tablet_axis(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, axis);
+	struct wlr_tablet_tool_axis_event *event = data;
+	struct input_record_tablet_tool_axis record = {
+		.tool = tablet_tool_record(event->tool),
+		.time_msec = event->time_msec,
+		.updated_axes = event->updated_axes,
+		.x = event->x,
+		.y = event->y,
+		.dx = event->dx,
+		.dy = event->dy,
+		.pressure = event->pressure,
+		.distance = event->distance,
+		.tilt_x = event->tilt_x,
+		.tilt_y = event->tilt_y,
+		.rotation = event->rotation,
+		.slider = event->slider,
+		.wheel_delta = event->wheel_delta,
+	};
+	recorder_write(device, INPUT_RECORD_TABLET_TOOL_AXIS,
+		&record, sizeof(record));
+}
+
+static void handle_tablet_proximity(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, proximity);
+	struct wlr_tablet_tool_proximity_event *event = data;
+	struct input_record_tablet_tool_state record = {
+		.tool = tablet_tool_record(event->tool),
+		.time_msec = event->time_msec,
+		.state = event->state,
+		.x = event->x,
+		.y = event->y,
+	};
+	recorder_write(device, INPUT_RECORD_TABLET_TOOL_PROXIMITY,
+		&record, sizeof(record));
+}
+
+static void handle_tablet_tip(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, tip);
+	struct wlr_tablet_tool_tip_event *event = data;
+	struct input_record_tablet_tool_state record = {
+		.tool = tablet_tool_record(event->tool),
+		.time_msec = event->time_msec,
+		.state = event->state,
+		.x = event->x,
+		.y = event->y,
+	};
+	recorder_write(device, INPUT_RECORD_TABLET_TOOL_TIP,
+		&record, sizeof(record));
+}
+
+static void handle_tablet_button(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, button);
+	struct wlr_tablet_tool_button_event *event = data;
+	struct input_record_tablet_tool_button record = {
+		.tool = tablet_tool_record(event->tool),
+		.time_msec = event->time_msec,
+		.button = event->button,
+		.state = event->state,
+	};
+	recorder_write(device, INPUT_RECORD_TABLET_TOOL_BUTTON,
+		&record, sizeof(record));
+}
+
+static void recorder_device_destroy(struct wlr_input_recorder_device *device) {
+	switch (device->device->type) {
+	case WLR_INPUT_DEVICE_POINTER:
+		wl_list_remove(&device->motion.link);
+		wl_list_remove(&device->motion_absolute.link);
+		wl_list_remove(&device->button.link);
+		wl_list_remove(&device->axis.link);
+		wl_list_remove(&device->frame.link);
+		wl_list_remove(&device->swipe_begin.link);
+		wl_list_remove(&device->swipe_update.link);
+		wl_list_remove(&device->swipe_end.link);
+		wl_list_remove(&device->pinch_begin.link);
+		wl_list_remove(&device->pinch_update.link);
+		wl_list_remove(&device->pinch_end.link);
+		wl_list_remove(&device->hold_begin.link);
+		wl_list_remove(&device->hold_end.link);
+		break;
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		wl_list_remove(&device->key.link);
+		wl_list_remove(&device->modifiers.link);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		wl_list_remove(&device->down.link);
+		wl_list_remove(&device->up.link);
+		wl_list_remove(&device->motion.link);
+		wl_list_remove(&device->cancel.link);
+		wl_list_remove(&device->frame.link);
+		break;
+	case WLR_INPUT_DEVICE_TABLET:
+		wl_list_remove(&device->axis.link);
+		wl_list_remove(&device->proximity.link);
+		wl_list_remove(&device->tip.link);
+		wl_list_remove(&device->button.link);
+		break;
+	default:
+		abort(); // unreachable
+	}
+
+	wl_list_remove(&device->destroy.link);
+	wl_list_remove(&device->link);
+	free(device);
+}
+
+static void handle_device_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *device =
+		wl_container_of(listener, device, destroy);
+	recorder_write(device, INPUT_RECORD_DEVICE_REMOVE, NULL, 0);
+	recorder_device_destroy(device);
+}
+
+bool wlr_input_recorder_add_device(struct wlr_input_recorder *recorder,
+		struct wlr_input_device *wlr_device) {
+	switch (wlr_device->type) {
+	case WLR_INPUT_DEVICE_POINTER:
+	case WLR_INPUT_DEVICE_KEYBOARD:
+	case WLR_INPUT_DEVICE_TOUCH:
+	case WLR_INPUT_DEVICE_TABLET:
+		break;
+	default:
+		return false;
+	}
+
+	struct wlr_input_recorder_device *device;
+	wl_list_for_each(device, &recorder->devices, link) {
+		if (device->device == wlr_device) {
+			return true;
+		}
+	}
+
+	device = calloc(1, sizeof(*device));
+	if (device == NULL) {
+		return false;
+	}
+
+	device->recorder = recorder;
+	device->device = wlr_device;
+	device->id = recorder->next_device_id++;
+
+	switch (wlr_device->type) {
+	case WLR_INPUT_DEVICE_POINTER:;
+		struct wlr_pointer *pointer = wlr_pointer_from_input_device(wlr_device);
+		device->motion.notify = handle_motion;
+		wl_signal_add(&pointer->events.motion, &device->motion);
+		device->motion_absolute.notify = handle_motion_absolute;
+		wl_signal_add(&pointer->events.motion_absolute, &device->motion_absolute);
+		device->button.notify = handle_pointer_button;
+		wl_signal_add(&pointer->events.button, &device->button);
+		device->axis.notify = handle_axis;
+		wl_signal_add(&pointer->events.axis, &device->axis);
+		device->frame.notify = handle_frame;
+		wl_signal_add(&pointer->events.frame, &device->frame);
+		device->swipe_begin.notify = handle_swipe_begin;
+		wl_signal_add(&pointer->events.swipe_begin, &device->swipe_begin);
+		device->swipe_update.notify = handle_swipe_update;
+		wl_signal_add(&pointer->events.swipe_update, &device->swipe_update);
+		device->swipe_end.notify = handle_swipe_end;
+		wl_signal_add(&pointer->events.swipe_end, &device->swipe_end);
+		device->pinch_begin.notify = handle_pinch_begin;
+		wl_signal_add(&pointer->events.pinch_begin, &device->pinch_begin);
+		device->pinch_update.notify = handle_pinch_update;
+		wl_signal_add(&pointer->events.pinch_update, &device->pinch_update);
+		device->pinch_end.notify = handle_pinch_end;
+		wl_signal_add(&pointer->events.pinch_end, &device->pinch_end);
+		device->hold_begin.notify = handle_hold_begin;
+		wl_signal_add(&pointer->events.hold_begin, &device->hold_begin);
+		device->hold_end.notify = handle_hold_end;
+		wl_signal_add(&pointer->events.hold_end, &device->hold_end);
+		break;
+	case WLR_INPUT_DEVICE_KEYBOARD:;
+		struct wlr_keyboard *keyboard = wlr_keyboard_from_input_device(wlr_device);
+		device->key.notify = handle_key;
+		wl_signal_add(&keyboard->events.key, &device->key);
+		device->modifiers.notify = handle_modifiers;
+		wl_signal_add(&keyboard->events.modifiers, &device->modifiers);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:;
+		struct wlr_touch *touch = wlr_touch_from_input_device(wlr_device);
+		device->down.notify = handle_touch_down;
+		wl_signal_add(&touch->events.down, &device->down);
+		device->up.notify = handle_touch_up;
+		wl_signal_add(&touch->events.up, &device->up);
+		device->motion.notify = handle_touch_motion;
+		wl_signal_add(&touch->events.motion, &device->motion);
+		device->cancel.notify = handle_touch_cancel;
+		wl_signal_add(&touch->events.cancel, &device->cancel);
+		device->frame.notify = handle_frame;
+		wl_signal_add(&touch->events.frame, &device->frame);
+		break;
+	case WLR_INPUT_DEVICE_TABLET:;
+		struct wlr_tablet *tablet = wlr_tablet_from_input_device(wlr_device);
+		device->axis.notify = handle_tablet_axis;
+		wl_signal_add(&tablet->events.axis, &device->axis);
+		device->proximity.notify = handle_tablet_proximity;
+		wl_signal_add(&tablet->events.proximity, &device->proximity);
+		device->tip.notify = handle_tablet_tip;
+		wl_signal_add(&tablet->events.tip, &device->tip);
+		device->button.notify = handle_tablet_button;
+		wl_signal_add(&tablet->events.button, &device->button);
+		break;
+	default:
+		abort(); // unreachable
+	}
+
+	device->destroy.notify = handle_device_destroy;
+	wl_signal_add(&wlr_device->events.destroy, &device->destroy);
+
+	wl_list_insert(&recorder->devices, &device->link);
+
+	const char *name = wlr_device->name != NULL ? wlr_device->name : "";
+	size_t name_len = strlen(name);
+	struct input_record_device_add record = {
+		.type = wlr_device->type,
+		.name_len = name_len,
+	};
+	struct input_record_header header = {
+		.type = INPUT_RECORD_DEVICE_ADD,
+		.device = device->id,
+		.size = sizeof(record) + name_len,
+		.time_usec = get_current_time_usec(),
+	};
+	recorder_append(recorder, &header, sizeof(header));
+	recorder_append(recorder, &record, sizeof(record));
+	recorder_append(recorder, name, name_len);
+
+	return true;
+}
+
+struct wlr_input_recorder *wlr_input_recorder_create(int fd) {
+	struct wlr_input_recorder *recorder = calloc(1, sizeof(*recorder));
+	if (recorder == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	recorder->fd = fd;
+	wl_array_init(&recorder->buffer);
+	wl_list_init(&recorder->devices);
+	wl_signal_init(&recorder->events.destroy);
+
+	struct input_recording_header header = {
+		.version = INPUT_RECORDING_VERSION,
+	};
+	memcpy(header.magic, INPUT_RECORDING_MAGIC, sizeof(header.magic));
+	recorder_append(recorder, &header, sizeof(header));
+
+	return recorder;
+}
+
+void wlr_input_recorder_destroy(struct wlr_input_recorder *recorder) {
+	if (recorder == NULL) {
+		return;
+	}
+
+	wl_signal_emit_mutable(&recorder->events.destroy, NULL);
+
+	assert(wl_list_empty(&recorder->events.destroy.listener_list));
+
+	struct wlr_input_recorder_device *device, *tmp;
+	wl_list_for_each_safe(device, tmp, &recorder->devices, link) {
+		recorder_device_destroy(device);
+	}
+
+	wlr_input_recorder_flush(recorder);
+	close(recorder->fd);
+	wl_array_release(&recorder->buffer);
+	free(recorder);
+}
@@ -67,13 +67,31 @@ bool keyboard_modifier_update(struct wlr_keyboard *keyboard) {
 
 void keyboard_key_update(struct wlr_keyboard *keyboard,
 		struct wlr_keyboard_key_event *event) {
-	if (event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
-		set_add(keyboard->keycodes, &keyboard->num_keycodes,
-			WLR_KEYBOARD_KEYS_CAP, event->keycode);
+	uint32_t keycode = event->keycode;
+	if (keycode >= WLR_KEYBOARD_KEYCODE_MAX) {
+		if (event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+			set_add(keyboard->keycodes, &keyboard->num_keycodes,
+				WLR_KEYBOARD_KEYS_CAP, keycode);
+		}
+		if (event->state == WL_KEYBOARD_KEY_STATE_RELEASED) {
+			set_remove(keyboard->keycodes, &keyboard->num_keycodes,
+				WLR_KEYBOARD_KEYS_CAP, keycode);
+		}
+		return;
 	}
-	if (event->state == WL_KEYBOARD_KEY_STATE_RELEASED) {
+
+	uint64_t *word = &keyboard->pressed_keys[keycode / 64];
+	uint64_t bit = (uint64_t)1 << (keycode % 64);
+	if (event->state == WL_KEYBOARD_KEY_STATE_PRESSED && !(*word & bit)) {
+		if (set_append(keyboard->keycodes, &keyboard->num_keycodes,
+				WLR_KEYBOARD_KEYS_CAP, keycode) >= 0) {
+			*word |= bit;
+		}
+	}
+	if (event->state == WL_KEYBOARD_KEY_STATE_RELEASED && (*word & bit)) {
 		set_remove(keyboard->keycodes, &keyboard->num_keycodes,
-			WLR_KEYBOARD_KEYS_CAP, event->keycode);
+			WLR_KEYBOARD_KEYS_CAP, keycode);
+		*word &= ~bit;
 	}
 
 	assert(keyboard->num_keycodes <= WLR_KEYBOARD_KEYS_CAP);
@@ -137,17 +155,120 @@ void wlr_keyboard_init(struct wlr_keyboard *kb,
 	wl_signal_init(&kb->events.repeat_info);
 }
 
+/**
+ * A serialized keymap, shared by all keyboards with an identical keymap.
+ */
+struct wlr_keyboard_keymap_file {
+	char *string;
+	size_t size; // including the NUL terminator
+	uint32_t hash;
+	int fd; // sealed or read-only
+	size_t n_refs;
+	struct wl_list link; // keymap_files
+};
+
+// Keyboards aren't tied to a display, so the registry is global: files are
+// shared by keyboards of all displays in the process. The registry isn't
+// thread-safe, keymaps must be set from a single thread.
+static struct wl_list keymap_files = { &keymap_files, &keymap_files };
+
+static uint32_t keymap_string_hash(const char *str) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (const char *c = str; *c != '\0'; c++) {
+		hash ^= (uint8_t)*c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void keymap_file_unref(struct wlr_keyboard_keymap_file *file) {
+	if (file == NULL) {
+		return;
+	}
+	assert(file->n_refs > 0);
+	file->n_refs--;
+	if (file->n_refs > 0) {
+		return;
+	}
+	wl_list_remove(&file->link);
+	close(file->fd);
+	free(file->string);
+	free(file);
+}
+
+static int keymap_file_create_read_only(const char *str, size_t size) {
+	int rw_fd = -1, ro_fd = -1;
+	if (!allocate_shm_file_pair(size, &rw_fd, &ro_fd)) {
+		wlr_log(WLR_ERROR, "Failed to allocate shm file for keymap");
+		return -1;
+	}
+
+	void *dst = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, rw_fd, 0);
+	close(rw_fd);
+	if (dst == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "mmap failed");
+		close(ro_fd);
+		return -1;
+	}
+
+	memcpy(dst, str, size);
+	munmap(dst, size);
+	return ro_fd;
+}
+
+/**
+ * Get a keymap file for the string, taking ownership of it.
+ */
+static struct wlr_keyboard_keymap_file *keymap_file_get(char *str) {
+	uint32_t hash = keymap_string_hash(str);
+	size_t size = strlen(str) + 1;
+
+	struct wlr_keyboard_keymap_file *file;
+	wl_list_for_each(file, &keymap_files, link) {
+		if (file->hash == hash && file->size == size &&
+				memcmp(file->string, str, size) == 0) {
+			free(str);
+			file->n_refs++;
+			return file;
+		}
+	}
+
+	// The file is sent to every client of every keyboard using the keymap,
+	// none of them may be able to modify it
+	int fd = allocate_sealed_shm_file(str, size);
+	if (fd < 0) {
+		fd = keymap_file_create_read_only(str, size);
+		if (fd < 0) {
+			return NULL;
+		}
+	}
+
+	file = calloc(1, sizeof(*file));
+	if (file == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	file->string = str;
+	file->size = size;
+	file->hash = hash;
+	file->fd = fd;
+	file->n_refs = 1;
+	wl_list_insert(&keymap_files, &file->link);
+
+	return file;
+}
+
 static void keyboard_unset_keymap(struct wlr_keyboard *kb) {
 	xkb_keymap_unref(kb->keymap);
 	kb->keymap = NULL;
 	xkb_state_unref(kb->xkb_state);
 	kb->xkb_state = NULL;
-	free(kb->keymap_string);
+	keymap_file_unref(kb->keymap_file);
+	kb->keymap_file = NULL;
 	kb->keymap_string = NULL;
 	kb->keymap_size = 0;
-	if (kb->keymap_fd >= 0) {
-		close(kb->keymap_fd);
-	}
 	kb->keymap_fd = -1;
 }
 
@@ -200,31 +321,18 @@ bool wlr_keyboard_set_keymap(struct wlr_keyboard *kb, struct xkb_keymap *keymap)
 		wlr_log(WLR_ERROR, "Failed to get string version of keymap");
 		goto error_xkb_state;
 	}
-	size_t keymap_size = strlen(keymap_str) + 1;
-
-	int rw_fd = -1, ro_fd = -1;
-	if (!allocate_shm_file_pair(keymap_size, &rw_fd, &ro_fd)) {
-		wlr_log(WLR_ERROR, "Failed to allocate shm file for keymap");
-		goto error_keymap_str;
-	}
-
-	void *dst = mmap(NULL, keymap_size, PROT_READ | PROT_WRITE, MAP_SHARED, rw_fd, 0);
-	close(rw_fd);
-	if (dst == MAP_FAILED) {
-		wlr_log_errno(WLR_ERROR, "mmap failed");
-		close(ro_fd);
+	struct wlr_keyboard_keymap_file *keymap_file = keymap_file_get(keymap_str);
+	if (keymap_file == NULL) {
 		goto error_keymap_str;
 	}
 
-	memcpy(dst, keymap_str, keymap_size);
-	munmap(dst, keymap_size);
-
 	keyboard_unset_keymap(kb);
 	kb->keymap = xkb_keymap_ref(keymap);
 	kb->xkb_state = xkb_state;
-	kb->keymap_string = keymap_str;
-	kb->keymap_size = keymap_size;
-	kb->keymap_fd = ro_fd;
+	kb->keymap_file = keymap_file;
+	kb->keymap_string = keymap_file->string;
+	kb->keymap_size = keymap_file->size;
+	kb->keymap_fd = keymap_file->fd;
 
 	const char *led_names[WLR_LED_COUNT] = {
 		XKB_LED_NAME_NUM,
@@ -298,6 +406,9 @@ bool wlr_keyboard_keymaps_match(struct xkb_keymap *km1,
 	if (!km1 || !km2) {
 		return false;
 	}
+	if (km1 == km2) {
+		return true;
+	}
 	char *km1_str = xkb_keymap_get_as_string(km1, XKB_KEYMAP_FORMAT_TEXT_V1);
 	char *km2_str = xkb_keymap_get_as_string(km2, XKB_KEYMAP_FORMAT_TEXT_V1);
 	bool result = strcmp(km1_str, km2_str) == 0;
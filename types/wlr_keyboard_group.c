@@ -66,10 +66,8 @@ struct wlr_keyboard_group *wlr_keyboard_group_from_wlr_keyboard(
 	return group;
 }
 
-static bool process_key(struct keyboard_group_device *group_device,
+static bool process_key_list(struct wlr_keyboard_group *group,
 		struct wlr_keyboard_key_event *event) {
-	struct wlr_keyboard_group *group = group_device->keyboard->group;
-
 	struct keyboard_group_key *key, *tmp;
 	wl_list_for_each_safe(key, tmp, &group->keys, link) {
 		if (key->keycode != event->keycode) {
@@ -104,6 +102,27 @@ static bool process_key(struct keyboard_group_device *group_device,
 	return true;
 }
 
+/**
+ * Update the group's key state. Returns true if the key state of the group
+ * changed, in which case the event needs to be passed on.
+ */
+static bool process_key(struct keyboard_group_device *group_device,
+		struct wlr_keyboard_key_event *event) {
+	struct wlr_keyboard_group *group = group_device->keyboard->group;
+	if (event->keycode >= WLR_KEYBOARD_KEYCODE_MAX) {
+		return process_key_list(group, event);
+	}
+
+	uint32_t *count = &group->key_counts[event->keycode];
+	if (event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+		return (*count)++ == 0;
+	}
+	if (event->state == WL_KEYBOARD_KEY_STATE_RELEASED && *count > 0) {
+		return --(*count) == 0;
+	}
+	return true;
+}
+
 static void handle_keyboard_key(struct wl_listener *listener, void *data) {
 	struct keyboard_group_device *group_device =
 		wl_container_of(listener, group_device, key);
@@ -182,11 +201,13 @@ static void refresh_state(struct keyboard_group_device *device,
 	struct wl_array keys;
 	wl_array_init(&keys);
 
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint32_t time_msec = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+
 	for (size_t i = 0; i < device->keyboard->num_keycodes; i++) {
-		struct timespec now;
-		clock_gettime(CLOCK_MONOTONIC, &now);
 		struct wlr_keyboard_key_event event = {
-			.time_msec = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000,
+			.time_msec = time_msec,
 			.keycode = device->keyboard->keycodes[i],
 			.update_state = true,
 			.state = state
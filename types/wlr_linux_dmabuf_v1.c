@@ -2,7 +2,9 @@
 #include <drm_fourcc.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <wlr/backend.h>
 #include <wlr/config.h>
@@ -15,6 +17,7 @@
 #include <xf86drm.h>
 #include "linux-dmabuf-v1-protocol.h"
 #include "render/drm_format_set.h"
+#include "types/wlr_buffer_accounting.h"
 #include "util/shm.h"
 
 #if WLR_HAS_DRM_BACKEND
@@ -36,8 +39,18 @@ struct wlr_linux_dmabuf_feedback_v1_compiled_tranche {
 	struct wl_array indices; // uint16_t
 };
 
+/**
+ * Compiled feedbacks are shared by all surfaces with the same feedback: they
+ * are de-duplicated by the content of the feedback they were compiled from
+ * and destroyed on last unref.
+ */
 struct wlr_linux_dmabuf_feedback_v1_compiled {
+	size_t n_refs;
+	uint32_t hash; // of the source feedback
+	struct wl_list link; // wlr_linux_dmabuf_v1.compiled_feedbacks
+
 	dev_t main_device;
+	struct wl_array table; // struct wlr_linux_dmabuf_feedback_v1_table_entry
 	int table_fd;
 	size_t table_size;
 
@@ -107,6 +120,8 @@ static void buffer_destroy(struct wlr_buffer *wlr_buffer) {
 	}
 	wlr_dmabuf_attributes_finish(&buffer->attributes);
 	wl_list_remove(&buffer->release.link);
+	buffer_accounting_entry_finish(&buffer->accounting_bytes);
+	buffer_accounting_entry_finish(&buffer->accounting_buffers);
 	free(buffer);
 }
 
@@ -226,6 +241,34 @@ static bool check_import_dmabuf(struct wlr_dmabuf_attributes *attribs, void *dat
 	return true;
 }
 
+static size_t dmabuf_attributes_get_size(const struct wlr_dmabuf_attributes *attribs) {
+	size_t total = 0;
+	struct stat stats[WLR_DMABUF_MAX_PLANES] = {0};
+	for (int i = 0; i < attribs->n_planes; i++) {
+		// Planes often share the same DMA-BUF, only count it once
+		bool shared = false;
+		if (fstat(attribs->fd[i], &stats[i]) == 0) {
+			for (int j = 0; j < i; j++) {
+				if (stats[j].st_ino == stats[i].st_ino &&
+						stats[j].st_dev == stats[i].st_dev) {
+					shared = true;
+					break;
+				}
+			}
+		}
+		if (shared) {
+			continue;
+		}
+
+		off_t size = lseek(attribs->fd[i], 0, SEEK_END);
+		if (size == -1) {
+			size = attribs->offset[i] + (off_t)attribs->stride[i] * attribs->height;
+		}
+		total += size;
+	}
+	return total;
+}
+
 static void params_create_common(struct wl_resource *params_resource,
 		uint32_t buffer_id, int32_t width, int32_t height, uint32_t format,
 		uint32_t flags) {
@@ -372,6 +415,11 @@ static void params_create_common(struct wl_resource *params_resource,
 	buffer->release.notify = buffer_handle_release;
 	wl_signal_add(&buffer->base.events.release, &buffer->release);
 
+	buffer_accounting_entry_init(&buffer->accounting_bytes, client,
+		WLR_BUFFER_ACCOUNTING_DMABUF, dmabuf_attributes_get_size(&attribs));
+	buffer_accounting_entry_init(&buffer->accounting_buffers, client,
+		WLR_BUFFER_ACCOUNTING_BUFFERS, 1);
+
 	/* send 'created' event when the request is not for an immediate
 	 * import, that is buffer_id is zero */
 	if (buffer_id == 0) {
@@ -507,6 +555,9 @@ static ssize_t get_drm_format_set_index(const struct wlr_drm_format_set *set,
 	return -1;
 }
 
+static void compiled_feedback_destroy(
+	struct wlr_linux_dmabuf_feedback_v1_compiled *feedback);
+
 static struct wlr_linux_dmabuf_feedback_v1_compiled *feedback_compile(
 		const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
 	const struct wlr_linux_dmabuf_feedback_v1_tranche *tranches = feedback->tranches.data;
@@ -531,25 +582,23 @@ static struct wlr_linux_dmabuf_feedback_v1_compiled *feedback_compile(
 	}
 	assert(table_len > 0);
 
-	size_t table_size =
-		table_len * sizeof(struct wlr_linux_dmabuf_feedback_v1_table_entry);
-	int rw_fd, ro_fd;
-	if (!allocate_shm_file_pair(table_size, &rw_fd, &ro_fd)) {
-		wlr_log(WLR_ERROR, "Failed to allocate shm file for format table");
-		return NULL;
+	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = calloc(1, sizeof(*compiled) +
+		tranches_len * sizeof(struct wlr_linux_dmabuf_feedback_v1_compiled_tranche));
+	if (compiled == NULL) {
+		goto err_all_formats;
 	}
 
+	compiled->table_fd = -1;
+	wl_array_init(&compiled->table);
+	size_t table_size =
+		table_len * sizeof(struct wlr_linux_dmabuf_feedback_v1_table_entry);
 	struct wlr_linux_dmabuf_feedback_v1_table_entry *table =
-		mmap(NULL, table_size, PROT_READ | PROT_WRITE, MAP_SHARED, rw_fd, 0);
-	if (table == MAP_FAILED) {
-		wlr_log_errno(WLR_ERROR, "mmap failed");
-		close(rw_fd);
-		close(ro_fd);
-		goto err_all_formats;
+		wl_array_add(&compiled->table, table_size);
+	if (table == NULL) {
+		wlr_log(WLR_ERROR, "Failed to allocate format table");
+		goto error_compiled;
 	}
 
-	close(rw_fd);
-
 	size_t n = 0;
 	for (size_t i = 0; i < all_formats.len; i++) {
 		const struct wlr_drm_format *fmt = &all_formats.formats[i];
@@ -564,18 +613,8 @@ static struct wlr_linux_dmabuf_feedback_v1_compiled *feedback_compile(
 	}
 	assert(n == table_len);
 
-	munmap(table, table_size);
-
-	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = calloc(1, sizeof(*compiled) +
-		tranches_len * sizeof(struct wlr_linux_dmabuf_feedback_v1_compiled_tranche));
-	if (compiled == NULL) {
-		close(ro_fd);
-		goto err_all_formats;
-	}
-
 	compiled->main_device = feedback->main_device;
 	compiled->tranches_len = tranches_len;
-	compiled->table_fd = ro_fd;
 	compiled->table_size = table_size;
 
 	// Build the indices lists for all tranches
@@ -619,25 +658,173 @@ static struct wlr_linux_dmabuf_feedback_v1_compiled *feedback_compile(
 	return compiled;
 
 error_compiled:
-	close(compiled->table_fd);
-	free(compiled);
+	compiled_feedback_destroy(compiled);
 err_all_formats:
 	wlr_drm_format_set_finish(&all_formats);
 	return NULL;
 }
 
-static void compiled_feedback_destroy(
+static bool compiled_feedback_create_table_fd(
 		struct wlr_linux_dmabuf_feedback_v1_compiled *feedback) {
-	if (feedback == NULL) {
-		return;
+	int rw_fd, ro_fd;
+	if (!allocate_shm_file_pair(feedback->table_size, &rw_fd, &ro_fd)) {
+		wlr_log(WLR_ERROR, "Failed to allocate shm file for format table");
+		return false;
 	}
+
+	void *table = mmap(NULL, feedback->table_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, rw_fd, 0);
+	if (table == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "mmap failed");
+		close(rw_fd);
+		close(ro_fd);
+		return false;
+	}
+
+	close(rw_fd);
+
+	memcpy(table, feedback->table.data, feedback->table_size);
+	munmap(table, feedback->table_size);
+
+	feedback->table_fd = ro_fd;
+	return true;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t size) {
+	// FNV-1a
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static uint32_t feedback_hash(const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
+	uint32_t hash = 2166136261;
+	hash = hash_bytes(hash, &feedback->main_device, sizeof(feedback->main_device));
+	const struct wlr_linux_dmabuf_feedback_v1_tranche *tranche;
+	wl_array_for_each(tranche, &feedback->tranches) {
+		hash = hash_bytes(hash, &tranche->target_device, sizeof(tranche->target_device));
+		hash = hash_bytes(hash, &tranche->flags, sizeof(tranche->flags));
+		for (size_t i = 0; i < tranche->formats.len; i++) {
+			const struct wlr_drm_format *fmt = &tranche->formats.formats[i];
+			hash = hash_bytes(hash, &fmt->format, sizeof(fmt->format));
+			hash = hash_bytes(hash, fmt->modifiers, fmt->len * sizeof(fmt->modifiers[0]));
+		}
+	}
+	return hash;
+}
+
+/**
+ * Check whether a compiled feedback has been compiled from a feedback with
+ * the same content. Tranche formats are compared through the format table, so
+ * that the feedback doesn't need to be compiled.
+ */
+static bool compiled_feedback_matches(
+		const struct wlr_linux_dmabuf_feedback_v1_compiled *compiled,
+		const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
+	const struct wlr_linux_dmabuf_feedback_v1_tranche *tranches = feedback->tranches.data;
+	size_t tranches_len = feedback->tranches.size / sizeof(struct wlr_linux_dmabuf_feedback_v1_tranche);
+	if (compiled->main_device != feedback->main_device ||
+			compiled->tranches_len != tranches_len) {
+		return false;
+	}
+
+	const struct wlr_linux_dmabuf_feedback_v1_table_entry *table = compiled->table.data;
+	for (size_t i = 0; i < tranches_len; i++) {
+		const struct wlr_linux_dmabuf_feedback_v1_tranche *tranche = &tranches[i];
+		const struct wlr_linux_dmabuf_feedback_v1_compiled_tranche *compiled_tranche =
+			&compiled->tranches[i];
+		if (compiled_tranche->target_device != tranche->target_device ||
+				compiled_tranche->flags != tranche->flags) {
+			return false;
+		}
+
+		const uint16_t *indices = compiled_tranche->indices.data;
+		size_t indices_len = compiled_tranche->indices.size / sizeof(uint16_t);
+		size_t n = 0;
+		for (size_t j = 0; j < tranche->formats.len; j++) {
+			const struct wlr_drm_format *fmt = &tranche->formats.formats[j];
+			for (size_t k = 0; k < fmt->len; k++) {
+				if (n >= indices_len) {
+					return false;
+				}
+				const struct wlr_linux_dmabuf_feedback_v1_table_entry *entry =
+					&table[indices[n]];
+				if (entry->format != fmt->format ||
+						entry->modifier != fmt->modifiers[k]) {
+					return false;
+				}
+				n++;
+			}
+		}
+		if (n != indices_len) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void compiled_feedback_destroy(
+		struct wlr_linux_dmabuf_feedback_v1_compiled *feedback) {
 	for (size_t i = 0; i < feedback->tranches_len; i++) {
 		wl_array_release(&feedback->tranches[i].indices);
 	}
-	close(feedback->table_fd);
+	wl_array_release(&feedback->table);
+	if (feedback->table_fd >= 0) {
+		close(feedback->table_fd);
+	}
 	free(feedback);
 }
 
+/**
+ * Compile a feedback, or return a reference to an identical compiled feedback
+ * if any. The format table file is shared in the latter case.
+ */
+static struct wlr_linux_dmabuf_feedback_v1_compiled *feedback_compile_shared(
+		struct wlr_linux_dmabuf_v1 *linux_dmabuf,
+		const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
+	uint32_t hash = feedback_hash(feedback);
+
+	struct wlr_linux_dmabuf_feedback_v1_compiled *existing;
+	wl_list_for_each(existing, &linux_dmabuf->compiled_feedbacks, link) {
+		if (existing->hash == hash && compiled_feedback_matches(existing, feedback)) {
+			existing->n_refs++;
+			return existing;
+		}
+	}
+
+	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = feedback_compile(feedback);
+	if (compiled == NULL) {
+		return NULL;
+	}
+	compiled->hash = hash;
+
+	if (!compiled_feedback_create_table_fd(compiled)) {
+		compiled_feedback_destroy(compiled);
+		return NULL;
+	}
+
+	compiled->n_refs = 1;
+	wl_list_insert(&linux_dmabuf->compiled_feedbacks, &compiled->link);
+	return compiled;
+}
+
+static void compiled_feedback_unref(
+		struct wlr_linux_dmabuf_feedback_v1_compiled *feedback) {
+	if (feedback == NULL) {
+		return;
+	}
+	assert(feedback->n_refs > 0);
+	feedback->n_refs--;
+	if (feedback->n_refs > 0) {
+		return;
+	}
+	wl_list_remove(&feedback->link);
+	compiled_feedback_destroy(feedback);
+}
+
 static void feedback_tranche_send(
 		const struct wlr_linux_dmabuf_feedback_v1_compiled_tranche *tranche,
 		struct wl_resource *resource) {
@@ -696,7 +883,7 @@ static void surface_destroy(struct wlr_linux_dmabuf_v1_surface *surface) {
 		wl_list_init(link);
 	}
 
-	compiled_feedback_destroy(surface->feedback);
+	compiled_feedback_unref(surface->feedback);
 
 	wlr_addon_finish(&surface->addon);
 	wl_list_remove(&surface->link);
@@ -865,7 +1052,8 @@ static void linux_dmabuf_v1_destroy(struct wlr_linux_dmabuf_v1 *linux_dmabuf) {
 		surface_destroy(surface);
 	}
 
-	compiled_feedback_destroy(linux_dmabuf->default_feedback);
+	compiled_feedback_unref(linux_dmabuf->default_feedback);
+	assert(wl_list_empty(&linux_dmabuf->compiled_feedbacks));
 	wlr_drm_format_set_finish(&linux_dmabuf->default_formats);
 	if (linux_dmabuf->main_device_fd >= 0) {
 		close(linux_dmabuf->main_device_fd);
@@ -885,7 +1073,8 @@ static void handle_display_destroy(struct wl_listener *listener, void *data) {
 
 static bool set_default_feedback(struct wlr_linux_dmabuf_v1 *linux_dmabuf,
 		const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
-	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = feedback_compile(feedback);
+	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled =
+		feedback_compile_shared(linux_dmabuf, feedback);
 	if (compiled == NULL) {
 		return false;
 	}
@@ -927,7 +1116,7 @@ static bool set_default_feedback(struct wlr_linux_dmabuf_v1 *linux_dmabuf,
 		}
 	}
 
-	compiled_feedback_destroy(linux_dmabuf->default_feedback);
+	compiled_feedback_unref(linux_dmabuf->default_feedback);
 	linux_dmabuf->default_feedback = compiled;
 
 	if (linux_dmabuf->main_device_fd >= 0) {
@@ -943,7 +1132,7 @@ static bool set_default_feedback(struct wlr_linux_dmabuf_v1 *linux_dmabuf,
 error_formats:
 	wlr_drm_format_set_finish(&formats);
 error_compiled:
-	compiled_feedback_destroy(compiled);
+	compiled_feedback_unref(compiled);
 	return false;
 }
 
@@ -959,6 +1148,7 @@ struct wlr_linux_dmabuf_v1 *wlr_linux_dmabuf_v1_create(struct wl_display *displa
 	linux_dmabuf->main_device_fd = -1;
 
 	wl_list_init(&linux_dmabuf->surfaces);
+	wl_list_init(&linux_dmabuf->compiled_feedbacks);
 	wl_signal_init(&linux_dmabuf->events.destroy);
 
 	linux_dmabuf->global = wl_global_create(display, &zwp_linux_dmabuf_v1_interface,
@@ -1023,15 +1213,22 @@ bool wlr_linux_dmabuf_v1_set_surface_feedback(
 
 	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = NULL;
 	if (feedback != NULL) {
-		compiled = feedback_compile(feedback);
+		compiled = feedback_compile_shared(linux_dmabuf, feedback);
 		if (compiled == NULL) {
 			return false;
 		}
 	}
 
-	compiled_feedback_destroy(surface->feedback);
+	const struct wlr_linux_dmabuf_feedback_v1_compiled *prev =
+		surface_get_feedback(surface);
+	compiled_feedback_unref(surface->feedback);
 	surface->feedback = compiled;
 
+	// Compiled feedbacks are shared, the same pointer means the same content
+	if (surface_get_feedback(surface) == prev) {
+		return true;
+	}
+
 	struct wl_resource *resource;
 	wl_resource_for_each(resource, &surface->feedback_resources) {
 		feedback_send(surface_get_feedback(surface), resource);
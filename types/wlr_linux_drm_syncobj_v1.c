@@ -4,6 +4,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <wlr/render/drm_syncobj.h>
+#include <wlr/types/wlr_commit_latch.h>
 #include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_linux_drm_syncobj_v1.h>
 #include <wlr/util/log.h>
@@ -191,18 +192,30 @@ static struct wlr_linux_drm_syncobj_surface_v1 *surface_from_wlr_surface(
 	return surface;
 }
 
-static void surface_commit_destroy(struct wlr_linux_drm_syncobj_surface_v1_commit *commit) {
-	wlr_surface_unlock_cached(commit->surface->surface, commit->cached_seq);
+static void surface_commit_finish(struct wlr_linux_drm_syncobj_surface_v1_commit *commit) {
 	wl_list_remove(&commit->surface_destroy.link);
 	wl_list_remove(&commit->waiter_ready.link);
 	wlr_drm_syncobj_timeline_waiter_finish(&commit->waiter);
 	free(commit);
 }
 
+static void surface_commit_destroy(struct wlr_linux_drm_syncobj_surface_v1_commit *commit) {
+	wlr_surface_unlock_cached(commit->surface->surface, commit->cached_seq);
+	surface_commit_finish(commit);
+}
+
 static void surface_commit_handle_waiter_ready(struct wl_listener *listener, void *data) {
 	struct wlr_linux_drm_syncobj_surface_v1_commit *commit =
 		wl_container_of(listener, commit, waiter_ready);
-	surface_commit_destroy(commit);
+
+	// Hand the commit over to the output's latch, if any
+	struct wlr_surface *wlr_surface = commit->surface->surface;
+	struct wlr_commit_latch *latch = wlr_commit_latch_from_surface(wlr_surface);
+	if (latch != NULL && wlr_commit_latch_queue(latch, wlr_surface, commit->cached_seq)) {
+		surface_commit_finish(commit);
+	} else {
+		surface_commit_destroy(commit);
+	}
 }
 
 static void surface_commit_handle_surface_destroy(struct wl_listener *listener,
@@ -212,15 +225,26 @@ static void surface_commit_handle_surface_destroy(struct wl_listener *listener,
 	surface_commit_destroy(commit);
 }
 
-// Block the surface commit until the fence materializes
+// Block the surface commit until the fence materializes. If the surface is
+// displayed on an output with a commit latch, block until the fence signals
+// instead, and then until the latch deadline.
 static bool lock_surface_commit(struct wlr_linux_drm_syncobj_surface_v1 *surface,
 		struct wlr_drm_syncobj_timeline *timeline, uint64_t point) {
-	uint32_t flags = DRM_SYNCOBJ_WAIT_FLAGS_WAIT_AVAILABLE;
+	struct wlr_commit_latch *latch = wlr_commit_latch_from_surface(surface->surface);
+	uint32_t flags = latch != NULL ? 0 : DRM_SYNCOBJ_WAIT_FLAGS_WAIT_AVAILABLE;
 
 	bool already_materialized = false;
 	if (!wlr_drm_syncobj_timeline_check(timeline, point, flags, &already_materialized)) {
 		return false;
 	} else if (already_materialized) {
+		if (latch == NULL) {
+			return true;
+		}
+		uint32_t seq = wlr_surface_lock_pending(surface->surface);
+		if (!wlr_commit_latch_queue(latch, surface->surface, seq)) {
+			wlr_surface_unlock_cached(surface->surface, seq);
+			return false;
+		}
 		return true;
 	}
 
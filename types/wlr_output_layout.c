@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <float.h>
 #include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_output.h>
@@ -35,6 +36,8 @@ struct wlr_output_layout *wlr_output_layout_create(struct wl_display *display) {
 
 static void output_layout_output_destroy(
 		struct wlr_output_layout_output *l_output) {
+	// The index references the output, stop using it until it's rebuilt
+	l_output->layout->index.valid = false;
 	wl_signal_emit_mutable(&l_output->events.destroy, l_output);
 	wlr_output_destroy_global(l_output->output);
 	wl_list_remove(&l_output->commit.link);
@@ -56,6 +59,9 @@ void wlr_output_layout_destroy(struct wlr_output_layout *layout) {
 	}
 
 	wl_list_remove(&layout->display_destroy.link);
+	free(layout->index.xs);
+	free(layout->index.ys);
+	free(layout->index.cells);
 	free(layout);
 }
 
@@ -68,6 +74,167 @@ static void output_layout_output_get_box(
 		&box->width, &box->height);
 }
 
+// Above this number of cells, lookups fall back to walking the output list
+#define INDEX_MAX_CELLS 65536
+
+static int compare_int(const void *_a, const void *_b) {
+	const int *a = _a, *b = _b;
+	return (*a > *b) - (*a < *b);
+}
+
+static size_t sort_unique_edges(int *edges, size_t len) {
+	if (len == 0) {
+		return 0;
+	}
+	qsort(edges, len, sizeof(edges[0]), compare_int);
+	size_t n = 1;
+	for (size_t i = 1; i < len; i++) {
+		if (edges[i] != edges[n - 1]) {
+			edges[n++] = edges[i];
+		}
+	}
+	return n;
+}
+
+static size_t find_edge(const int *edges, size_t len, int value) {
+	const int *edge = bsearch(&value, edges, len, sizeof(edges[0]), compare_int);
+	assert(edge != NULL);
+	return edge - edges;
+}
+
+/**
+ * Find the slab [edges[i], edges[i + 1]) containing the value.
+ */
+static bool find_slab(const int *edges, size_t len, double value, size_t *slab) {
+	// Also rejects NaN
+	if (len < 2 || !(value >= edges[0] && value < edges[len - 1])) {
+		return false;
+	}
+	size_t lo = 0, hi = len - 1; // edges[lo] <= value < edges[hi]
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (edges[mid] <= value) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	*slab = lo;
+	return true;
+}
+
+static void output_layout_update_index(struct wlr_output_layout *layout) {
+	free(layout->index.xs);
+	free(layout->index.ys);
+	free(layout->index.cells);
+	layout->index.valid = false;
+	layout->index.xs = layout->index.ys = NULL;
+	layout->index.xs_len = layout->index.ys_len = 0;
+	layout->index.cells = NULL;
+
+	size_t n_outputs = wl_list_length(&layout->outputs);
+	int *xs = calloc(2 * n_outputs + 1, sizeof(*xs));
+	int *ys = calloc(2 * n_outputs + 1, sizeof(*ys));
+	if (xs == NULL || ys == NULL) {
+		goto error;
+	}
+
+	size_t n_edges = 0;
+	struct wlr_output_layout_output *l_output;
+	wl_list_for_each(l_output, &layout->outputs, link) {
+		struct wlr_box box;
+		output_layout_output_get_box(l_output, &box);
+		if (wlr_box_empty(&box)) {
+			continue;
+		}
+		xs[n_edges] = box.x;
+		ys[n_edges] = box.y;
+		n_edges++;
+		xs[n_edges] = box.x + box.width;
+		ys[n_edges] = box.y + box.height;
+		n_edges++;
+	}
+
+	size_t xs_len = sort_unique_edges(xs, n_edges);
+	size_t ys_len = sort_unique_edges(ys, n_edges);
+	size_t cols = xs_len > 0 ? xs_len - 1 : 0;
+	size_t rows = ys_len > 0 ? ys_len - 1 : 0;
+	if (cols > 0 && rows > INDEX_MAX_CELLS / cols) {
+		goto error;
+	}
+
+	struct wlr_output_layout_output **cells = NULL;
+	if (cols * rows > 0) {
+		cells = calloc(cols * rows, sizeof(*cells));
+		if (cells == NULL) {
+			goto error;
+		}
+	}
+
+	// Walk the outputs backwards, so that the first output in the list wins
+	// when several ones overlap, as with a linear search
+	wl_list_for_each_reverse(l_output, &layout->outputs, link) {
+		struct wlr_box box;
+		output_layout_output_get_box(l_output, &box);
+		if (wlr_box_empty(&box)) {
+			continue;
+		}
+		size_t x1 = find_edge(xs, xs_len, box.x);
+		size_t x2 = find_edge(xs, xs_len, box.x + box.width);
+		size_t y1 = find_edge(ys, ys_len, box.y);
+		size_t y2 = find_edge(ys, ys_len, box.y + box.height);
+		for (size_t y = y1; y < y2; y++) {
+			for (size_t x = x1; x < x2; x++) {
+				cells[y * cols + x] = l_output;
+			}
+		}
+	}
+
+	layout->index.valid = true;
+	layout->index.xs = xs;
+	layout->index.ys = ys;
+	layout->index.xs_len = xs_len;
+	layout->index.ys_len = ys_len;
+	layout->index.cells = cells;
+	return;
+
+error:
+	free(xs);
+	free(ys);
+}
+
+static void output_layout_update_extents(struct wlr_output_layout *layout) {
+	int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+	if (!wl_list_empty(&layout->outputs)) {
+		min_x = min_y = INT_MAX;
+		max_x = max_y = INT_MIN;
+		struct wlr_output_layout_output *l_output;
+		wl_list_for_each(l_output, &layout->outputs, link) {
+			struct wlr_box output_box;
+			output_layout_output_get_box(l_output, &output_box);
+			if (output_box.x < min_x) {
+				min_x = output_box.x;
+			}
+			if (output_box.y < min_y) {
+				min_y = output_box.y;
+			}
+			if (output_box.x + output_box.width > max_x) {
+				max_x = output_box.x + output_box.width;
+			}
+			if (output_box.y + output_box.height > max_y) {
+				max_y = output_box.y + output_box.height;
+			}
+		}
+	}
+
+	layout->extents = (struct wlr_box){
+		.x = min_x,
+		.y = min_y,
+		.width = max_x - min_x,
+		.height = max_y - min_y,
+	};
+}
+
 /**
  * This must be called whenever the layout changes to reconfigure the auto
  * configured outputs and emit the `changed` event.
@@ -112,6 +279,9 @@ static void output_layout_reconfigure(struct wlr_output_layout *layout) {
 		max_x += output_box.width;
 	}
 
+	output_layout_update_extents(layout);
+	output_layout_update_index(layout);
+
 	wl_signal_emit_mutable(&layout->events.change, layout);
 }
 
@@ -279,6 +449,17 @@ bool wlr_output_layout_intersects(struct wlr_output_layout *layout,
 
 struct wlr_output *wlr_output_layout_output_at(struct wlr_output_layout *layout,
 		double lx, double ly) {
+	if (layout->index.valid) {
+		size_t x, y;
+		if (!find_slab(layout->index.xs, layout->index.xs_len, lx, &x) ||
+				!find_slab(layout->index.ys, layout->index.ys_len, ly, &y)) {
+			return NULL;
+		}
+		struct wlr_output_layout_output *l_output =
+			layout->index.cells[y * (layout->index.xs_len - 1) + x];
+		return l_output != NULL ? l_output->output : NULL;
+	}
+
 	struct wlr_output_layout_output *l_output;
 	wl_list_for_each(l_output, &layout->outputs, link) {
 		struct wlr_box output_box;
@@ -296,13 +477,11 @@ void wlr_output_layout_output_coords(struct wlr_output_layout *layout,
 	double src_x = *lx;
 	double src_y = *ly;
 
-	struct wlr_output_layout_output *l_output;
-	wl_list_for_each(l_output, &layout->outputs, link) {
-		if (l_output->output == reference) {
-			*lx = src_x - (double)l_output->x;
-			*ly = src_y - (double)l_output->y;
-			return;
-		}
+	struct wlr_output_layout_output *l_output =
+		wlr_output_layout_get(layout, reference);
+	if (l_output != NULL) {
+		*lx = src_x - (double)l_output->x;
+		*ly = src_y - (double)l_output->y;
 	}
 }
 
@@ -315,6 +494,21 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 
 	double min_x = lx, min_y = ly, min_distance = DBL_MAX;
 	struct wlr_output_layout_output *l_output;
+
+	// Fast path: the point is already inside an output
+	struct wlr_output *output_at = reference != NULL ? reference :
+		wlr_output_layout_output_at(layout, lx, ly);
+	l_output = output_at != NULL ? wlr_output_layout_get(layout, output_at) : NULL;
+	if (l_output != NULL) {
+		double output_x, output_y;
+		struct wlr_box output_box;
+		output_layout_output_get_box(l_output, &output_box);
+		wlr_box_closest_point(&output_box, lx, ly, &output_x, &output_y);
+		if (output_x == lx && output_y == ly) {
+			goto out;
+		}
+	}
+
 	wl_list_for_each(l_output, &layout->outputs, link) {
 		if (reference != NULL && reference != l_output->output) {
 			continue;
@@ -340,6 +534,7 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 		}
 	}
 
+out:
 	if (dest_lx) {
 		*dest_lx = min_x;
 	}
@@ -362,32 +557,7 @@ void wlr_output_layout_get_box(struct wlr_output_layout *layout,
 		}
 	} else {
 		// layout extents
-		int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
-		if (!wl_list_empty(&layout->outputs)) {
-			min_x = min_y = INT_MAX;
-			max_x = max_y = INT_MIN;
-			wl_list_for_each(l_output, &layout->outputs, link) {
-				struct wlr_box output_box;
-				output_layout_output_get_box(l_output, &output_box);
-				if (output_box.x < min_x) {
-					min_x = output_box.x;
-				}
-				if (output_box.y < min_y) {
-					min_y = output_box.y;
-				}
-				if (output_box.x + output_box.width > max_x) {
-					max_x = output_box.x + output_box.width;
-				}
-				if (output_box.y + output_box.height > max_y) {
-					max_y = output_box.y + output_box.height;
-				}
-			}
-		}
-
-		dest_box->x = min_x;
-		dest_box->y = min_y;
-		dest_box->width = max_x - min_x;
-		dest_box->height = max_y - min_y;
+		*dest_box = layout->extents;
 	}
 }
 
@@ -1,11 +1,14 @@
 #undef _POSIX_C_SOURCE
-#define _DEFAULT_SOURCE // for MAP_ANONYMOUS
+#define _GNU_SOURCE // for MAP_ANONYMOUS and F_GET_SEALS
 #include <assert.h>
 #include <drm_fourcc.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <wayland-server-protocol.h>
 #include <wlr/interfaces/wlr_buffer.h>
@@ -14,6 +17,7 @@
 #include <wlr/types/wlr_shm.h>
 #include <wlr/util/log.h>
 #include "render/pixel_format.h"
+#include "types/wlr_buffer_accounting.h"
 
 #ifdef __STDC_NO_ATOMICS__
 #error "C11 atomics are required"
@@ -30,6 +34,8 @@ struct wlr_shm_pool {
 	struct wl_list buffers; // wlr_shm_buffer.link
 	int fd;
 	struct wlr_shm_mapping *mapping;
+
+	struct wlr_buffer_accounting_entry accounting;
 };
 
 /**
@@ -44,11 +50,14 @@ struct wlr_shm_mapping {
 	void *data;
 	size_t size;
 	bool dropped; // false while a wlr_shm_pool references this mapping
+	// The file is sealed against shrinking, so accessing the mapping can't
+	// trigger SIGBUS
+	bool sealed;
+	size_t accesses; // number of buffers accessing the mapping
 };
 
 struct wlr_shm_sigbus_data {
 	struct wlr_shm_mapping *mapping;
-	struct sigaction prev_action;
 	struct wlr_shm_sigbus_data *_Atomic next;
 };
 
@@ -64,10 +73,18 @@ struct wlr_shm_buffer {
 	struct wl_listener release;
 
 	struct wlr_shm_sigbus_data sigbus_data;
+	struct wlr_buffer_accounting_entry accounting;
 };
 
-// Needs to be a lock-free atomic because it's accessed from a signal handler
-static struct wlr_shm_sigbus_data *_Atomic sigbus_data = NULL;
+// Accesses to unsealed mappings from the current thread. SIGBUS is delivered
+// to the faulting thread, so the handler only needs to look at its own list.
+// Needs to be a lock-free atomic because it's accessed from a signal handler.
+static _Thread_local struct wlr_shm_sigbus_data *_Atomic sigbus_data = NULL;
+// Buffers may be accessed from render threads, this protects the SIGBUS
+// handler installation and the lifetime of mappings
+static pthread_mutex_t sigbus_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool sigbus_handler_installed = false;
+static struct sigaction sigbus_prev_action;
 
 static const struct wl_buffer_interface wl_buffer_impl;
 static const struct wl_shm_pool_interface pool_impl;
@@ -98,6 +115,26 @@ static struct wlr_shm *shm_from_resource(struct wl_resource *resource) {
 	return wl_resource_get_user_data(resource);
 }
 
+/**
+ * Check whether the client can't shrink the file below the mapped size.
+ */
+static bool fd_is_sealed(int fd, size_t size) {
+#ifdef F_GET_SEALS
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals == -1 || !(seals & F_SEAL_SHRINK)) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return false;
+	}
+	return st.st_size >= 0 && (size_t)st.st_size >= size;
+#else
+	return false;
+#endif
+}
+
 static struct wlr_shm_mapping *mapping_create(int fd, size_t size) {
 	void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
 	if (data == MAP_FAILED) {
@@ -113,20 +150,16 @@ static struct wlr_shm_mapping *mapping_create(int fd, size_t size) {
 
 	mapping->data = data;
 	mapping->size = size;
+	mapping->sealed = fd_is_sealed(fd, size);
 	return mapping;
 }
 
+// Needs to be called with sigbus_lock held
 static void mapping_consider_destroy(struct wlr_shm_mapping *mapping) {
-	if (!mapping->dropped) {
+	if (!mapping->dropped || mapping->accesses > 0) {
 		return;
 	}
 
-	for (struct wlr_shm_sigbus_data *cur = sigbus_data; cur != NULL; cur = cur->next) {
-		if (cur->mapping == mapping) {
-			return;
-		}
-	}
-
 	munmap(mapping->data, mapping->size);
 	free(mapping);
 }
@@ -141,8 +174,10 @@ static void mapping_drop(struct wlr_shm_mapping *mapping) {
 		return;
 	}
 
+	pthread_mutex_lock(&sigbus_lock);
 	mapping->dropped = true;
 	mapping_consider_destroy(mapping);
+	pthread_mutex_unlock(&sigbus_lock);
 }
 
 static const struct wlr_buffer_resource_interface buffer_resource_interface = {
@@ -158,6 +193,7 @@ static void buffer_destroy(struct wlr_buffer *wlr_buffer) {
 	assert(buffer->resource == NULL);
 	wl_list_remove(&buffer->release.link);
 	wl_list_remove(&buffer->link);
+	buffer_accounting_entry_finish(&buffer->accounting);
 	pool_consider_destroy(buffer->pool);
 	free(buffer);
 }
@@ -177,9 +213,6 @@ static bool buffer_get_shm(struct wlr_buffer *wlr_buffer,
 }
 
 static void handle_sigbus(int sig, siginfo_t *info, void *context) {
-	assert(sigbus_data != NULL);
-	struct sigaction prev_action = sigbus_data->prev_action;
-
 	// Check whether the offending address is inside of the wl_shm_pool's mapped
 	// space
 	uintptr_t addr = (uintptr_t)info->si_addr;
@@ -207,11 +240,38 @@ static void handle_sigbus(int sig, siginfo_t *info, void *context) {
 	return;
 
 reraise:
-	if (prev_action.sa_flags & SA_SIGINFO) {
-		prev_action.sa_sigaction(sig, info, context);
+	if (sigbus_prev_action.sa_flags & SA_SIGINFO) {
+		sigbus_prev_action.sa_sigaction(sig, info, context);
+	} else if (sigbus_prev_action.sa_handler == SIG_DFL ||
+			sigbus_prev_action.sa_handler == SIG_IGN) {
+		// The faulting instruction will be executed again on return, and
+		// trigger the default action
+		struct sigaction default_action = { .sa_handler = SIG_DFL };
+		sigaction(SIGBUS, &default_action, NULL);
 	} else {
-		prev_action.sa_handler(sig);
+		sigbus_prev_action.sa_handler(sig);
+	}
+}
+
+// Needs to be called with sigbus_lock held
+static bool sigbus_handler_install(void) {
+	if (sigbus_handler_installed) {
+		return true;
+	}
+
+	// The handler is installed once and kept around, to avoid two sigaction()
+	// calls per access
+	struct sigaction new_action = {
+		.sa_sigaction = handle_sigbus,
+		.sa_flags = SA_SIGINFO | SA_NODEFER,
+	};
+	if (sigaction(SIGBUS, &new_action, &sigbus_prev_action) != 0) {
+		wlr_log_errno(WLR_ERROR, "sigaction failed");
+		return false;
 	}
+
+	sigbus_handler_installed = true;
+	return true;
 }
 
 static bool buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
@@ -223,30 +283,27 @@ static bool buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
 		return false;
 	}
 
-	// Install a SIGBUS handler. SIGBUS is triggered if the client shrinks the
-	// backing file, and then we try to access the mapping.
-	struct sigaction prev_action;
-	if (sigbus_data == NULL) {
-		struct sigaction new_action = {
-			.sa_sigaction = handle_sigbus,
-			.sa_flags = SA_SIGINFO | SA_NODEFER,
-		};
-		if (sigaction(SIGBUS, &new_action, &prev_action) != 0) {
-			wlr_log_errno(WLR_ERROR, "sigaction failed");
-			return false;
-		}
-	} else {
-		prev_action = sigbus_data->prev_action;
+	struct wlr_shm_mapping *mapping = buffer->pool->mapping;
+
+	pthread_mutex_lock(&sigbus_lock);
+
+	// SIGBUS is triggered if the client shrinks the backing file, and then we
+	// try to access the mapping
+	if (!mapping->sealed && !sigbus_handler_install()) {
+		pthread_mutex_unlock(&sigbus_lock);
+		return false;
 	}
+	mapping->accesses++;
 
-	struct wlr_shm_mapping *mapping = buffer->pool->mapping;
+	pthread_mutex_unlock(&sigbus_lock);
 
 	buffer->sigbus_data = (struct wlr_shm_sigbus_data){
 		.mapping = mapping,
-		.prev_action = prev_action,
-		.next = sigbus_data,
 	};
-	sigbus_data = &buffer->sigbus_data;
+	if (!mapping->sealed) {
+		buffer->sigbus_data.next = sigbus_data;
+		sigbus_data = &buffer->sigbus_data;
+	}
 
 	*data = (char *)mapping->data + buffer->offset;
 	*format = buffer->drm_format;
@@ -256,25 +313,28 @@ static bool buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
 
 static void buffer_end_data_ptr_access(struct wlr_buffer *wlr_buffer) {
 	struct wlr_shm_buffer *buffer = wl_container_of(wlr_buffer, buffer, base);
-
-	if (sigbus_data == &buffer->sigbus_data) {
-		sigbus_data = buffer->sigbus_data.next;
-	} else {
-		for (struct wlr_shm_sigbus_data *cur = sigbus_data; cur != NULL; cur = cur->next) {
-			if (cur->next == &buffer->sigbus_data) {
-				cur->next = buffer->sigbus_data.next;
-				break;
+	struct wlr_shm_mapping *mapping = buffer->sigbus_data.mapping;
+
+	// Accesses to unsealed mappings are tracked per thread, so they need to
+	// end on the thread which started them
+	if (!mapping->sealed) {
+		if (sigbus_data == &buffer->sigbus_data) {
+			sigbus_data = buffer->sigbus_data.next;
+		} else {
+			for (struct wlr_shm_sigbus_data *cur = sigbus_data; cur != NULL; cur = cur->next) {
+				if (cur->next == &buffer->sigbus_data) {
+					cur->next = buffer->sigbus_data.next;
+					break;
+				}
 			}
 		}
 	}
 
-	if (sigbus_data == NULL) {
-		if (sigaction(SIGBUS, &buffer->sigbus_data.prev_action, NULL) != 0) {
-			wlr_log_errno(WLR_ERROR, "sigaction failed");
-		}
-	}
-
-	mapping_consider_destroy(buffer->sigbus_data.mapping);
+	pthread_mutex_lock(&sigbus_lock);
+	assert(mapping->accesses > 0);
+	mapping->accesses--;
+	mapping_consider_destroy(mapping);
+	pthread_mutex_unlock(&sigbus_lock);
 }
 
 static const struct wlr_buffer_impl buffer_impl = {
@@ -367,6 +427,9 @@ static void pool_handle_create_buffer(struct wl_client *client,
 
 	buffer->release.notify = buffer_handle_release;
 	wl_signal_add(&buffer->base.events.release, &buffer->release);
+
+	buffer_accounting_entry_init(&buffer->accounting, client,
+		WLR_BUFFER_ACCOUNTING_BUFFERS, 1);
 }
 
 static void pool_handle_resize(struct wl_client *client,
@@ -389,6 +452,7 @@ static void pool_handle_resize(struct wl_client *client,
 
 	mapping_drop(pool->mapping);
 	pool->mapping = mapping;
+	buffer_accounting_entry_update(&pool->accounting, mapping->size);
 }
 
 static const struct wl_shm_pool_interface pool_impl = {
@@ -402,6 +466,7 @@ static void pool_consider_destroy(struct wlr_shm_pool *pool) {
 		return;
 	}
 
+	buffer_accounting_entry_finish(&pool->accounting);
 	mapping_drop(pool->mapping);
 	close(pool->fd);
 	free(pool);
@@ -450,6 +515,8 @@ static void shm_handle_create_pool(struct wl_client *client,
 	pool->shm = shm;
 	pool->fd = fd;
 	wl_list_init(&pool->buffers);
+	buffer_accounting_entry_init(&pool->accounting, client,
+		WLR_BUFFER_ACCOUNTING_SHM, mapping->size);
 	return;
 
 error_pool:
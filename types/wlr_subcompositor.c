@@ -34,6 +34,7 @@ static void subsurface_destroy(struct wlr_subsurface *subsurface) {
 	wl_signal_emit_mutable(&subsurface->events.destroy, subsurface);
 
 	wlr_surface_synced_finish(&subsurface->parent_synced);
+	surface_invalidate_flattened_tree(subsurface->parent);
 
 	wl_list_remove(&subsurface->surface_client_commit.link);
 	wl_list_remove(&subsurface->parent_destroy.link);
@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wlr/types/wlr_xcursor_manager.h>
@@ -13,6 +14,7 @@ struct wlr_xcursor_manager *wlr_xcursor_manager_create(const char *name,
 	}
 	manager->size = size;
 	wl_list_init(&manager->scaled_themes);
+	wl_signal_init(&manager->events.destroy);
 	return manager;
 }
 
@@ -20,6 +22,10 @@ void wlr_xcursor_manager_destroy(struct wlr_xcursor_manager *manager) {
 	if (manager == NULL) {
 		return;
 	}
+
+	wl_signal_emit_mutable(&manager->events.destroy, NULL);
+	assert(wl_list_empty(&manager->events.destroy.listener_list));
+
 	struct wlr_xcursor_manager_theme *theme, *tmp;
 	wl_list_for_each_safe(theme, tmp, &manager->scaled_themes, link) {
 		wl_list_remove(&theme->link);
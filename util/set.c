@@ -6,6 +6,10 @@ ssize_t set_add(uint32_t values[], size_t *len, size_t cap, uint32_t target) {
 			return i;
 		}
 	}
+	return set_append(values, len, cap, target);
+}
+
+ssize_t set_append(uint32_t values[], size_t *len, size_t cap, uint32_t target) {
 	if (*len == cap) {
 		return -1;
 	}
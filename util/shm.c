@@ -1,3 +1,5 @@
+#undef _POSIX_C_SOURCE
+#define _GNU_SOURCE // for memfd_create and F_ADD_SEALS
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
@@ -95,3 +97,40 @@ bool allocate_shm_file_pair(size_t size, int *rw_fd_ptr, int *ro_fd_ptr) {
 	*ro_fd_ptr = ro_fd;
 	return true;
 }
+
+int allocate_sealed_shm_file(const void *data, size_t size) {
+#ifdef MFD_ALLOW_SEALING
+	int fd = memfd_create("wlroots", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		return -1;
+	}
+
+	int ret;
+	do {
+		ret = ftruncate(fd, size);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		close(fd);
+		return -1;
+	}
+
+	void *dst = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (dst == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+	memcpy(dst, data, size);
+	munmap(dst, size);
+
+	// F_SEAL_WRITE fails while writable shared mappings exist, so this must
+	// come after munmap()
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+#else
+	return -1;
+#endif
+}
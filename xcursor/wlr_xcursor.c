@@ -24,6 +24,7 @@
  */
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,6 +32,12 @@
 #include <wlr/xcursor.h>
 #include "xcursor/xcursor.h"
 
+struct wlr_xcursor_theme_file {
+	char *name;
+	char *path;
+	bool tried; // the file has been loaded, or failed to
+};
+
 static void xcursor_destroy(struct wlr_xcursor *cursor) {
 	for (size_t i = 0; i < cursor->image_count; i++) {
 		free(cursor->images[i]->buffer);
@@ -169,32 +176,76 @@ static struct wlr_xcursor *xcursor_create_from_xcursor_images(
 	return cursor;
 }
 
-static struct wlr_xcursor *xcursor_theme_get_cursor(struct wlr_xcursor_theme *theme,
-	const char *name);
-
-static void load_callback(struct xcursor_images *images, void *data) {
+static void scan_callback(const char *name, const char *path, void *data) {
 	struct wlr_xcursor_theme *theme = data;
 
-	if (xcursor_theme_get_cursor(theme, images->name)) {
-		xcursor_images_destroy(images);
+	if (theme->files_len == theme->files_cap) {
+		size_t cap = theme->files_cap == 0 ? 64 : 2 * theme->files_cap;
+		struct wlr_xcursor_theme_file *files =
+			realloc(theme->files, cap * sizeof(*files));
+		if (files == NULL) {
+			return;
+		}
+		theme->files = files;
+		theme->files_cap = cap;
+	}
+
+	struct wlr_xcursor_theme_file *file = &theme->files[theme->files_len];
+	file->name = strdup(name);
+	file->path = strdup(path);
+	file->tried = false;
+	if (file->name == NULL || file->path == NULL) {
+		free(file->name);
+		free(file->path);
 		return;
 	}
+	theme->files_len++;
+}
+
+static bool theme_add_cursor(struct wlr_xcursor_theme *theme,
+		struct wlr_xcursor *cursor) {
+	struct wlr_xcursor **cursors = realloc(theme->cursors,
+		(theme->cursor_count + 1) * sizeof(theme->cursors[0]));
+	if (cursors == NULL) {
+		return false;
+	}
+	theme->cursors = cursors;
+	theme->cursors[theme->cursor_count] = cursor;
+	theme->cursor_count++;
+	return true;
+}
 
-	struct wlr_xcursor *cursor = xcursor_create_from_xcursor_images(images, theme);
-	if (cursor) {
-		theme->cursor_count++;
-		struct wlr_xcursor **cursors = realloc(theme->cursors,
-			theme->cursor_count * sizeof(theme->cursors[0]));
-		if (cursors == NULL) {
-			theme->cursor_count--;
+static struct wlr_xcursor *theme_load_cursor(struct wlr_xcursor_theme *theme,
+		const char *name) {
+	// Files are in lookup order, fall back to the next one with the same
+	// name if a file can't be loaded
+	for (size_t i = 0; i < theme->files_len; i++) {
+		struct wlr_xcursor_theme_file *file = &theme->files[i];
+		if (file->tried || strcmp(file->name, name) != 0) {
+			continue;
+		}
+		file->tried = true;
+
+		struct xcursor_images *images =
+			xcursor_load_images(file->path, file->name, theme->size);
+		if (images == NULL) {
+			continue;
+		}
+
+		struct wlr_xcursor *cursor = xcursor_create_from_xcursor_images(images, theme);
+		xcursor_images_destroy(images);
+		if (cursor == NULL) {
+			continue;
+		}
+
+		if (!theme_add_cursor(theme, cursor)) {
 			xcursor_destroy(cursor);
-		} else {
-			theme->cursors = cursors;
-			theme->cursors[theme->cursor_count - 1] = cursor;
+			return NULL;
 		}
+		return cursor;
 	}
 
-	xcursor_images_destroy(images);
+	return NULL;
 }
 
 struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
@@ -215,14 +266,16 @@ struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
 	theme->cursor_count = 0;
 	theme->cursors = NULL;
 
-	xcursor_load_theme(name, size, load_callback, theme);
+	xcursor_scan_theme(name, scan_callback, theme);
 
-	if (theme->cursor_count == 0) {
+	size_t available = theme->files_len;
+	if (available == 0) {
 		load_default_theme(theme);
+		available = theme->cursor_count;
 	}
 
-	wlr_log(WLR_DEBUG, "Loaded cursor theme '%s' at size %d (%d available cursors)",
-			theme->name, size, theme->cursor_count);
+	wlr_log(WLR_DEBUG, "Loaded cursor theme '%s' at size %d (%zu available cursors)",
+			theme->name, size, available);
 
 	return theme;
 
@@ -236,6 +289,12 @@ void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
 		xcursor_destroy(theme->cursors[i]);
 	}
 
+	for (size_t i = 0; i < theme->files_len; i++) {
+		free(theme->files[i].name);
+		free(theme->files[i].path);
+	}
+	free(theme->files);
+
 	free(theme->name);
 	free(theme->cursors);
 	free(theme);
@@ -249,7 +308,7 @@ static struct wlr_xcursor *xcursor_theme_get_cursor(struct wlr_xcursor_theme *th
 		}
 	}
 
-	return NULL;
+	return theme_load_cursor(theme, name);
 }
 
 struct wlr_xcursor *wlr_xcursor_theme_get_cursor(struct wlr_xcursor_theme *theme,
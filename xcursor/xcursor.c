@@ -426,13 +426,19 @@ xcursor_read_image(FILE *file,
 	image->xhot = head.xhot;
 	image->yhot = head.yhot;
 	image->delay = head.delay;
+	/* read all pixels at once, then convert from little endian */
 	n = image->width * image->height;
+	if (fread(image->pixels, sizeof(uint32_t), n, file) != (size_t)n) {
+		xcursor_image_destroy(image);
+		return NULL;
+	}
 	p = image->pixels;
 	while (n--) {
-		if (!xcursor_read_uint(file, p)) {
-			xcursor_image_destroy(image);
-			return NULL;
-		}
+		unsigned char *bytes = (unsigned char *)p;
+		*p = ((uint32_t)(bytes[0]) << 0) |
+			 ((uint32_t)(bytes[1]) << 8) |
+			 ((uint32_t)(bytes[2]) << 16) |
+			 ((uint32_t)(bytes[3]) << 24);
 		p++;
 	}
 	return image;
@@ -678,15 +684,13 @@ xcursor_theme_inherits(const char *full)
 }
 
 static void
-load_all_cursors_from_dir(const char *path, int size,
-			  void (*load_callback)(struct xcursor_images *, void *),
-			  void *user_data)
+scan_cursors_in_dir(const char *path,
+		    void (*scan_callback)(const char *, const char *, void *),
+		    void *user_data)
 {
-	FILE *f;
 	DIR *dir = opendir(path);
 	struct dirent *ent;
 	char *full;
-	struct xcursor_images *images;
 
 	if (!dir)
 		return;
@@ -703,20 +707,7 @@ load_all_cursors_from_dir(const char *path, int size,
 		if (!full)
 			continue;
 
-		f = fopen(full, "r");
-		if (!f) {
-			free(full);
-			continue;
-		}
-
-		images = xcursor_xc_file_load_images(f, size);
-
-		if (images) {
-			images->name = strdup(ent->d_name);
-			load_callback(images, user_data);
-		}
-
-		fclose(f);
+		scan_callback(ent->d_name, full, user_data);
 		free(full);
 	}
 
@@ -740,9 +731,8 @@ nodelist_contains(struct xcursor_nodelist *nodelist, const char *s, size_t ss) {
 }
 
 static void
-xcursor_load_theme_protected(const char *theme,
-			     int size,
-			     void (*load_callback)(struct xcursor_images *, void *),
+xcursor_scan_theme_protected(const char *theme,
+			     void (*scan_callback)(const char *, const char *, void *),
 			     void *user_data,
 			     struct xcursor_nodelist *visited_nodes)
 {
@@ -771,8 +761,7 @@ xcursor_load_theme_protected(const char *theme,
 
 		full = xcursor_build_fullname(dir, "cursors", "");
 		if (full) {
-			load_all_cursors_from_dir(full, size, load_callback,
-						  user_data);
+			scan_cursors_in_dir(full, scan_callback, user_data);
 			free(full);
 		}
 
@@ -789,35 +778,60 @@ xcursor_load_theme_protected(const char *theme,
 		si = strlen(i);
 		if (nodelist_contains(visited_nodes, i, si))
 			continue;
-		xcursor_load_theme_protected(i, size, load_callback, user_data, visited_nodes);
+		xcursor_scan_theme_protected(i, scan_callback, user_data, visited_nodes);
 	}
 
 	free(inherits);
 	free(xcursor_path);
 }
 
-/** Load all the cursor of a theme
+/** Scan the cursor files of a theme
  *
- * This function loads all the cursor images of a given theme and its
- * inherited themes. Each cursor is loaded into an struct xcursor_images object
- * which is passed to the caller's load callback. If a cursor appears
- * more than once across all the inherited themes, the load callback
- * will be called multiple times, with possibly different struct xcursor_images
- * object which have the same name. The user is expected to destroy the
- * struct xcursor_images objects passed to the callback with
- * xcursor_images_destroy().
+ * This function lists the cursor files of a given theme and its
+ * inherited themes, without reading them. The scan callback is called
+ * for each file, in lookup order: if a cursor appears more than once
+ * across all the inherited themes, the first file takes precedence.
+ * Files can then be loaded with xcursor_load_images().
  *
- * \param theme The name of theme that should be loaded
- * \param size The desired size of the cursor images
- * \param load_callback A callback function that will be called
- * for each cursor loaded. The first parameter is the struct xcursor_images
- * object representing the loaded cursor and the second is a pointer
+ * \param theme The name of theme that should be scanned
+ * \param scan_callback A callback function that will be called
+ * for each cursor file. The first parameter is the name of the cursor,
+ * the second is the path to the file and the third is a pointer
  * to data provided by the user.
- * \param user_data The data that should be passed to the load callback
+ * \param user_data The data that should be passed to the scan callback
  */
 void
-xcursor_load_theme(const char *theme, int size,
-		   void (*load_callback)(struct xcursor_images *, void *),
+xcursor_scan_theme(const char *theme,
+		   void (*scan_callback)(const char *, const char *, void *),
 		   void *user_data) {
-	return xcursor_load_theme_protected(theme, size, load_callback, user_data, NULL);
+	xcursor_scan_theme_protected(theme, scan_callback, user_data, NULL);
+}
+
+/** Load the images of a cursor file
+ *
+ * Loads the images closest to the desired size. The returned
+ * struct xcursor_images object must be destroyed with
+ * xcursor_images_destroy(). Returns NULL on error.
+ */
+struct xcursor_images *
+xcursor_load_images(const char *path, const char *name, int size)
+{
+	struct xcursor_images *images;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	images = xcursor_xc_file_load_images(f, size);
+	fclose(f);
+	if (!images)
+		return NULL;
+
+	images->name = strdup(name);
+	if (!images->name) {
+		xcursor_images_destroy(images);
+		return NULL;
+	}
+	return images;
 }